@@ -57,6 +57,7 @@ struct BinaryExpr {
   Expr left;
   Token op;
   Expr right;
+  std::size_t site = 0; // slot of the type feedback the interpreter keeps for this operator
 
   bool operator==(const BinaryExpr &) const = default;
 };
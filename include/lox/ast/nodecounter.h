@@ -0,0 +1,53 @@
+#pragma once
+
+#include "lox/ast/expr.h"
+#include "lox/ast/stmt.h"
+
+#include <boost/variant/static_visitor.hpp>
+
+#include <cstddef>
+#include <vector>
+
+namespace lox {
+
+// Counts the statements and expressions of a tree; blank placeholders (a missing else branch, a bare return) don't
+// count. Methods count as function statements.
+class NodeCounter : public boost::static_visitor<void> {
+private:
+  std::size_t m_statements = 0;
+  std::size_t m_expressions = 0;
+
+public:
+  void count(const std::vector<Stmt> &statements);
+  void count(const Stmt &stmt);
+  void count(const Expr &expr);
+
+  std::size_t statements() const;
+  std::size_t expressions() const;
+  std::size_t nodes() const;
+
+  void operator()(const BlockStmt &stmt);
+  void operator()(const ClassStmt &stmt);
+  void operator()(const ExpressionStmt &stmt);
+  void operator()(const FunctionStmt &stmt);
+  void operator()(const IfStmt &stmt);
+  void operator()(const PrintStmt &stmt);
+  void operator()(const ReturnStmt &stmt);
+  void operator()(const VariableStmt &stmt);
+  void operator()(const WhileStmt &stmt);
+  void operator()(const YieldStmt &stmt);
+
+  void operator()(const AssignExpr &expr);
+  void operator()(const BinaryExpr &expr);
+  void operator()(const CallExpr &expr);
+  void operator()(const GetExpr &expr);
+  void operator()(const GroupingExpr &expr);
+  void operator()(const LogicalExpr &expr);
+  void operator()(const SetExpr &expr);
+  void operator()(const UnaryExpr &expr);
+
+  // Leaves: literals, variables, this and super.
+  void operator()(const auto & /*unused*/) {}
+};
+
+}
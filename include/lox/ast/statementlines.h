@@ -0,0 +1,40 @@
+#pragma once
+
+#include "lox/ast/stmt.h"
+
+#include <boost/variant/static_visitor.hpp>
+
+#include <cstddef>
+#include <vector>
+
+namespace lox {
+
+// The line each statement of a tree starts on, indexed by the number the parser gave the statement (see Stmt).
+// Numbers that aren't in the tree, 0 among them, map to line 0.
+class StatementLines : public boost::static_visitor<void> {
+private:
+  std::vector<std::size_t> m_lines;
+
+public:
+  explicit StatementLines(const std::vector<Stmt> &statements);
+
+  const std::vector<std::size_t> &lines() const;
+
+  void operator()(const BlockStmt &stmt);
+  void operator()(const ClassStmt &stmt);
+  void operator()(const FunctionStmt &stmt);
+  void operator()(const IfStmt &stmt);
+  void operator()(const WhileStmt &stmt);
+  void operator()(const blank & /*unused*/) {}
+
+  // Statements without statements of their own.
+  void operator()(const auto &stmt) {
+    record(stmt.id, stmt.line);
+  }
+
+private:
+  void add(const std::vector<Stmt> &statements);
+  void record(std::size_t id, std::size_t line);
+};
+
+}
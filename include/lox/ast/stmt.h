@@ -3,9 +3,13 @@
 #include "lox/primitives/token.h"
 #include "lox/ast/expr.h"
 
+#include <boost/variant/apply_visitor.hpp>
 #include <boost/variant/variant.hpp>
 #include <boost/variant/recursive_wrapper.hpp>
 
+#include <cstddef>
+#include <type_traits>
+
 namespace lox {
 
 struct BlockStmt;
@@ -17,6 +21,7 @@ struct PrintStmt;
 struct ReturnStmt;
 struct VariableStmt;
 struct WhileStmt;
+struct YieldStmt;
 
 using boost::blank;
 using boost::recursive_wrapper;
@@ -32,52 +37,95 @@ using Stmt = variant<blank,
                      recursive_wrapper<PrintStmt>, 
                      recursive_wrapper<ReturnStmt>, 
                      recursive_wrapper<VariableStmt>,
-                     recursive_wrapper<WhileStmt>>;
+                     recursive_wrapper<WhileStmt>,
+                     recursive_wrapper<YieldStmt>>;
 // clang-format on
 
+// Every statement carries the number the parser gave it, dense from 1 in the order the parser completes them, and the
+// line it starts on. Statements the optimizer makes up have number 0; copies keep the number of their original.
+
 struct BlockStmt {
   std::vector<Stmt> statements;
+  std::size_t id = 0;
+  std::size_t line = 0;
 };
 
 struct ClassStmt {
   Token name;
-  //  VariableExpr superClass;
+  Expr superClass; // a VariableExpr, blank if the class doesn't inherit
   std::vector<FunctionStmt> methods;
+  std::size_t id = 0;
+  std::size_t line = 0;
 };
 
 struct ExpressionStmt {
   Expr expression;
+  std::size_t id = 0;
+  std::size_t line = 0;
 };
 
 struct FunctionStmt {
   Token name;
   std::vector<Token> params;
   std::vector<Stmt> body;
+  bool isCoroutine = false; // the body yields, so calls create a coroutine instead of running it
+  std::size_t id = 0;
+  std::size_t line = 0;
 };
 
 struct IfStmt {
   Expr condition;
   Stmt thenBranch;
   Stmt elseBranch;
+  std::size_t id = 0;
+  std::size_t line = 0;
 };
 
 struct PrintStmt {
   Expr expression;
+  std::size_t id = 0;
+  std::size_t line = 0;
 };
 
 struct ReturnStmt {
   Token keyword;
   Expr value;
+  std::size_t id = 0;
+  std::size_t line = 0;
 };
 
 struct VariableStmt {
   Token name;
   Expr initializer;
+  std::size_t id = 0;
+  std::size_t line = 0;
 };
 
 struct WhileStmt {
   Expr condition;
   Stmt body;
+  Token keyword; // `while`, or `for` if the loop was desugared from one
+  std::size_t id = 0;
+  std::size_t line = 0;
+};
+
+struct YieldStmt {
+  Token keyword;
+  Expr value;
+  std::size_t id = 0;
+  std::size_t line = 0;
 };
 
+// 0 for a blank statement.
+inline std::size_t statementId(const Stmt &stmt) {
+  return boost::apply_visitor(
+      [](const auto &node) -> std::size_t {
+        if constexpr (std::is_same_v<std::decay_t<decltype(node)>, blank>)
+          return 0;
+        else
+          return node.id;
+      },
+      stmt);
+}
+
 }
@@ -34,6 +34,7 @@ public:
   std::string operator()(const ReturnStmt &stmt) const;
   std::string operator()(const VariableStmt &stmt) const;
   std::string operator()(const WhileStmt &stmt) const;
+  std::string operator()(const YieldStmt &stmt) const;
 
   std::string visit(const Expr &expr) const;
 
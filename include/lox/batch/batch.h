@@ -0,0 +1,49 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <filesystem>
+#include <vector>
+
+namespace lox {
+
+// Runs many scripts concurrently on a ThreadPool. Every script is loaded, compiled and run by one task, in an isolated
+// interpreter of its own. What a script prints and the errors it reports are captured and written out in the order of
+// the scripts, as soon as every script before it has been written.
+class Batch {
+public:
+  struct Options {
+    std::size_t threads = 0; // 0: one per hardware thread
+    bool optimize = false;
+  };
+
+  struct Statistics {
+    std::size_t scripts = 0;
+    std::size_t failed = 0; // scripts that couldn't be read or reported an error
+    std::size_t threads = 0;
+    std::size_t steals = 0;
+    std::chrono::nanoseconds wall{};
+
+    // Summed over every script, so each one can exceed the wall time.
+    std::chrono::nanoseconds load{};
+    std::chrono::nanoseconds compile{};
+    std::chrono::nanoseconds run{};
+
+    double scriptsPerSecond() const;
+  };
+
+private:
+  std::vector<std::filesystem::path> m_scripts;
+  Options m_options;
+
+public:
+  Batch(std::vector<std::filesystem::path> scripts, const Options &options);
+
+  // The *.lox files under a directory, in lexicographic order, or else the paths listed in a file, one per line.
+  static std::vector<std::filesystem::path> collect(const std::filesystem::path &directoryOrList);
+
+  Statistics run(std::FILE *output, std::FILE *errors) const;
+};
+
+}
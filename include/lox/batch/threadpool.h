@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+namespace lox {
+
+// Runs tasks on a fixed set of threads. Every worker has a deque of its own: submitted tasks are dealt to the deques in
+// turn, a worker takes its work from the front of its own deque and, once that runs dry, steals from the back of the
+// others'. An uneven mix of long and short tasks so still keeps every thread busy until the very end.
+//
+// Idle workers and wait() block on atomic waits; there is no lock beyond those of the deques. Tasks must not throw.
+class ThreadPool {
+public:
+  using Task = std::function<void()>;
+
+private:
+  struct Queue {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+
+  std::vector<std::unique_ptr<Queue>> m_queues;
+  std::vector<std::thread> m_workers;
+
+  std::atomic<std::uint64_t> m_signals = 0; // bumped whenever a task is queued or the pool stops; idle workers wait on it
+  std::atomic<std::size_t> m_pending = 0;   // submitted and not finished yet; wait() waits on it
+  std::atomic<bool> m_stopping = false;
+
+  std::atomic<std::size_t> m_next = 0; // deque the next submitted task goes to
+  std::atomic<std::size_t> m_steals = 0;
+
+public:
+  explicit ThreadPool(const std::size_t threads = std::thread::hardware_concurrency());
+
+  // Runs the tasks still queued and joins the workers.
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  void submit(Task task);
+
+  // Blocks until every task submitted so far has run.
+  void wait();
+
+  std::size_t threads() const;
+
+  // Tasks a worker took from another worker's deque.
+  std::size_t steals() const;
+
+private:
+  void work(const std::size_t index);
+  std::optional<Task> take(const std::size_t index);
+};
+
+}
@@ -2,6 +2,7 @@
 
 #include "lox/callable/class/class.h"
 #include "lox/callable/function/function.h"
+#include "lox/callable/native/native.h"
 
 #include <variant>
 #include <cstdint>
@@ -11,10 +12,11 @@ namespace lox {
 
 class Class;
 class Function;
+class Native;
 
 class Callable {
 public:
-  using callable_t = std::variant<std::monostate, Class, Function>;
+  using callable_t = std::variant<std::monostate, Class, Function, Native>;
 
 private:
   callable_t m_callable;
@@ -23,10 +25,13 @@ public:
   Callable() = default;
   Callable(const Class &klass);
   Callable(const Function &function);
+  Callable(const Native &native);
 
-  std::any call(const Interpreter &interpreter, const std::vector<Literal> &arguments) const;
+  std::any call(const Interpreter &interpreter, const std::vector<std::any> &arguments) const;
   std::size_t arity() const;
   operator std::string() const;
+
+  const Function *function() const;
 };
 
 }
@@ -7,24 +7,37 @@
 #include <vector>
 #include <any>
 #include <cstdint> // for std::size_t
+#include <memory>
 #include <unordered_map>
 #include <optional>
 
 namespace lox {
 class Interpreter;
 
+// Classes are values like any other; copies share the method table and the superclass, so copying one is cheap and
+// copies compare equal.
 class Class {
 private:
   std::string m_name;
-  std::unordered_map<std::string, Function> m_methods;
+  std::shared_ptr<const Class> m_superclass;
+  std::shared_ptr<const std::unordered_map<std::string, Function>> m_methods;
 
 public:
-  explicit Class(const std::string &name, const std::unordered_map<std::string, Function> &methods);
+  explicit Class(const std::string &name, const std::optional<Class> &superclass,
+                 const std::unordered_map<std::string, Function> &methods);
 
+  // Looks the method up in the class and then along its superclasses.
   std::optional<Function> findMethod(const std::string &name) const;
-  std::any call(const Interpreter &interpreter, const std::vector<Literal> &arguments) const;
+
+  // Creates an instance and runs its initializer, if the class (or a superclass) has one.
+  std::any call(const Interpreter &interpreter, const std::vector<std::any> &arguments) const;
   std::size_t arity() const;
+  const std::string &name() const;
+  const std::unordered_map<std::string, Function> &methods() const; // of this class, not of its superclasses
+  const Class *superclass() const;
   operator std::string() const;
+
+  bool operator==(const Class &other) const;
 };
 
 }
@@ -2,23 +2,74 @@
 #include <unordered_map>
 #include <string>
 #include <any>
+#include <memory>
+#include <memory_resource>
+#include <cstddef>
 
 #include "lox/callable/class/class.h"
+#include "lox/memory/memory.h"
 
 namespace lox {
 struct Token;
+class Instance;
 
-class Instance {
+// The live instances of an interpreter, for heap snapshots. Instances link themselves in when they are made and out
+// when they are destroyed, which costs a few pointer writes. Like its interpreter, a registry is only used by one
+// thread at a time, so it takes no lock. Instances that outlive it are let go when it is destroyed.
+class InstanceRegistry {
+  Instance *m_first = nullptr;
+  std::size_t m_size = 0;
+
+  friend class Instance;
+
+public:
+  InstanceRegistry() = default;
+  ~InstanceRegistry();
+
+  InstanceRegistry(const InstanceRegistry &) = delete;
+  InstanceRegistry &operator=(const InstanceRegistry &) = delete;
+
+  // Calls visit with every live instance, so visit must neither make nor destroy an instance.
+  template <class Visit>
+  void forEach(Visit visit);
+
+  std::size_t size() const;
+};
+
+// Instances have identity: the interpreter passes them around as std::shared_ptr<Instance>, so every reference sees
+// the same fields.
+class Instance : public std::enable_shared_from_this<Instance> {
 private:
-  std::unordered_map<std::string, std::any> m_fields;
+  std::pmr::unordered_map<std::string, std::any> m_fields{memory::resource(memory::Tag::Objects)};
   Class m_klass;
 
+  InstanceRegistry *m_registry;
+  Instance *m_previous = nullptr;
+  Instance *m_next = nullptr;
+
+  friend class InstanceRegistry;
+
 public:
-  explicit Instance(const Class &klass);
+  // Registered with the registry, if any, for as long as it lives.
+  explicit Instance(const Class &klass, InstanceRegistry *registry = nullptr);
+  ~Instance();
 
+  Instance(const Instance &) = delete;
+  Instance &operator=(const Instance &) = delete;
+
+  // A field, or else a method bound to this instance.
   std::any get(const Token &name);
   void set(const Token &name, const std::any &val);
+  void clearFields();
+  const Class &klass() const;
+  const std::pmr::unordered_map<std::string, std::any> &fields() const;
   operator std::string() const;
 };
 
+template <class Visit>
+void InstanceRegistry::forEach(Visit visit) {
+  for (Instance *instance = m_first; instance != nullptr; instance = instance->m_next)
+    visit(*instance);
+}
+
 }
@@ -5,22 +5,53 @@
 #include "lox/environment/environment.h"
 
 #include <vector>
-#include <variant>
+#include <memory>
+#include <any>
 
 namespace lox {
 class Interpreter;
+class Instance;
 
 class Function {
 private:
-  FunctionStmt m_declaration;
-  Environment m_closure;
+  const FunctionStmt *m_declaration;
+  std::shared_ptr<Environment> m_closure;
+  bool m_isInitializer;
 
 public:
-  Function(const FunctionStmt &declaration, const Environment &closure);
+  Function(const FunctionStmt &declaration, const std::shared_ptr<Environment> &closure, const bool isInitializer = false);
 
-  std::any call(const Interpreter &interpreter, const std::vector<Literal> &arguments) const;
+  std::any call(const Interpreter &interpreter, const std::vector<std::any> &arguments) const;
   std::size_t arity() const;
   operator std::string() const;
+
+  const FunctionStmt &declaration() const;
+  const std::vector<Stmt> &body() const;
+  const std::shared_ptr<Environment> &closure() const;
+  std::shared_ptr<Environment> environment(const std::vector<std::any> &arguments) const;
+
+  // The method with `this` bound to the instance.
+  Function bind(const std::shared_ptr<Instance> &instance) const;
+
+  // Calling a function whose body yields creates a Coroutine instead of running it.
+  bool isCoroutine() const;
+
+  // An initializer always returns the instance it was bound to.
+  bool isInitializer() const;
+  std::any instance() const;
+
+  bool operator==(const Function &other) const;
+
+private:
+  std::any invoke(const Interpreter &interpreter, const std::vector<std::any> &arguments) const;
+  bool isGlobal(const Interpreter &interpreter) const;
+};
+
+// Returned by a call in tail position in place of its result. Function::call() makes the call once the frame of the
+// caller is gone, so tail recursion runs in constant stack space.
+struct TailCall {
+  Function function;
+  std::vector<std::any> arguments;
 };
 
 }
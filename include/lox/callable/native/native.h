@@ -0,0 +1,52 @@
+#pragma once
+
+#include <any>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <string>
+
+namespace lox {
+
+// Thrown by the callback of a native function to fail the call with a runtime error at the call site.
+class NativeError : public std::runtime_error {
+public:
+  using std::runtime_error::runtime_error;
+};
+
+// A function implemented in C++. It has a fixed arity, or takes up to maxArity arguments if it is variadic, and
+// receives its arguments as a view of the values the caller already evaluated, so calling it doesn't copy them into a
+// container of their own.
+class Native {
+public:
+  using Callback = std::function<std::any(std::span<const std::any> arguments)>;
+
+  static constexpr std::size_t maxArity = 8;
+  static constexpr std::size_t variadic = static_cast<std::size_t>(-1);
+
+private:
+  struct Definition {
+    std::string name;
+    std::size_t arity;
+    Callback callback;
+  };
+
+  // Shared, so that copying the value around (variables hold natives by value) costs a reference count.
+  std::shared_ptr<const Definition> m_definition;
+
+public:
+  // Throws std::invalid_argument for an arity above maxArity (other than `variadic`) or an empty callback.
+  Native(const std::string &name, const std::size_t arity, Callback callback);
+
+  std::any call(std::span<const std::any> arguments) const;
+  std::size_t arity() const;
+  bool isVariadic() const;
+  const std::string &name() const;
+  operator std::string() const;
+
+  bool operator==(const Native &other) const;
+};
+
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "lox/concurrency/message.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <string>
+
+namespace lox {
+
+// A bounded queue of messages between isolates. send() blocks while the channel is full and receive() while it is
+// empty; a blocked thread sleeps on an atomic wait rather than spinning. A closed channel refuses new messages but
+// still hands out those it holds. trySend() and tryReceive() never block, for a coroutine to park on instead.
+class Channel {
+private:
+  std::mutex m_mutex;
+  std::deque<Message> m_messages;
+  std::size_t m_capacity;
+  bool m_closed = false;
+
+  std::atomic<std::uint64_t> m_version = 0; // bumped by every change; blocked threads wait on it
+
+public:
+  enum class Attempt : std::uint8_t { Done, WouldWait, Closed };
+
+  explicit Channel(const std::size_t capacity);
+
+  Channel(const Channel &) = delete;
+  Channel &operator=(const Channel &) = delete;
+
+  // False, without sending, if the channel is closed.
+  bool send(Message message);
+
+  // Empty once the channel is closed and drained.
+  std::optional<Message> receive();
+
+  // Moves the message only when Done.
+  Attempt trySend(Message &message);
+  // Closed once the channel is closed and drained.
+  Attempt tryReceive(std::optional<Message> &message);
+
+  void close();
+
+  std::size_t capacity() const;
+  operator std::string() const;
+
+private:
+  void changed();
+};
+
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <memory>
+
+namespace lox {
+class Interpreter;
+
+// Lets the Lox code of an interpreter use more than one thread, through native functions:
+//
+//   spawn(fn, args...)  runs a function declared at the top level in a new isolate (see Interpreter::isolate()) on a
+//                       thread of its own; returns a channel that receives the result of the function, or is closed
+//                       without one if the function fails
+//   channel(capacity)   a channel holding up to `capacity` values
+//   send(ch, value)     copies the value into the channel (see Message), waiting while it is full
+//   receive(ch)         the next value, waiting while the channel is empty; nil once it is closed and drained
+//   close(ch)
+//
+// Arguments and results travel like messages. The calling isolate flushes its output before it spawns, sends or
+// receives, so output printed before a value is handed over comes before output printed after it has been received.
+// Inside a coroutine, send and receive don't wait on the thread: they park the coroutine (see Parked), so the
+// scheduler runs the others until the channel has room or a value.
+//
+// The destructor waits for the threads spawned so far, which in turn wait for the ones they spawned.
+class Concurrency {
+private:
+  struct Threads;
+  std::shared_ptr<Threads> m_threads;
+
+public:
+  explicit Concurrency(Interpreter &interpreter);
+  ~Concurrency();
+
+  Concurrency(const Concurrency &) = delete;
+  Concurrency &operator=(const Concurrency &) = delete;
+};
+
+}
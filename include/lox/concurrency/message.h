@@ -0,0 +1,43 @@
+#pragma once
+
+#include "lox/environment/environment.h"
+#include "lox/primitives/literal.h"
+
+#include <any>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace lox {
+class Channel;
+class InstanceRegistry;
+
+// A value on its way from one isolate to another. Literals and channels cross as they are; instances are copied
+// deeply, fields and all, keeping cycles and shared objects intact, and become instances of the global class of the
+// same name in the receiving isolate. Functions, classes and natives belong to their isolate and can't be sent.
+class Message {
+public:
+  using Value = std::variant<Literal, std::shared_ptr<Channel>, std::size_t>; // an index into the copied objects
+
+private:
+  struct Object {
+    std::string klass;
+    std::vector<std::pair<std::string, Value>> fields;
+  };
+
+  Value m_value;
+  std::vector<Object> m_objects;
+
+public:
+  // Throws NativeError for a value that can't be sent.
+  static Message pack(const std::any &value);
+
+  // Throws NativeError if the class of a copied instance isn't a global class of the receiving isolate. The copies
+  // are registered with the registry, that of the receiving interpreter.
+  std::any unpack(const Environment &globals, InstanceRegistry *registry = nullptr) const;
+};
+
+}
@@ -2,34 +2,46 @@
 
 #include "lox/primitives/token.h"
 #include "lox/primitives/literal.h"
+#include "lox/memory/memory.h"
 
 #include <unordered_map>
 #include <memory>
+#include <memory_resource>
 #include <any>
 
 namespace lox {
 
-class Environment : public std::enable_shared_from_this<Environment> {
+class Environment {
 private:
-  std::unordered_map<std::string, std::any> m_values;
+  std::pmr::unordered_map<std::string, std::any> m_values{memory::resource(memory::Tag::Environments)};
   std::shared_ptr<Environment> m_enclosing = nullptr;
 
 public:
   Environment() = default;
   explicit Environment(const std::shared_ptr<Environment> &enclosing);
+  // With the values allocated from the resource, a memory::FrameArena for instance.
+  Environment(const std::shared_ptr<Environment> &enclosing, std::pmr::memory_resource *resource);
 
   void define(const Token &token, const std::any &value);
 
   std::any get(const Token &token) const;
   std::any getAt(const Token &token, const std::size_t distance) const;
+  const std::any &at(const Token &token, const std::size_t distance) const;
+  const std::any *find(const Token &token) const;
 
   void assign(const Token &token, const std::any &value);
   void assignAt(const Token &token, const std::size_t distance, const std::any &value);
 
+  // Drops every value, and with them the references they hold.
+  void clear();
+
+  const std::pmr::unordered_map<std::string, std::any> &values() const;
+  const std::shared_ptr<Environment> &enclosing() const;
+
 private:
   bool isGlobalEnvironment() const;
-  std::shared_ptr<Environment> ancestor(const std::size_t distance);
-  std::shared_ptr<const Environment> ancestor(const std::size_t distance) const;
+  Environment *ancestor(const std::size_t distance);
+  const Environment *ancestor(const std::size_t distance) const;
 };
 
 }
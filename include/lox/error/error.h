@@ -2,6 +2,7 @@
 
 #include "lox/primitives/token.h"
 
+#include <cstdio>
 #include <exception>
 #include <string_view>
 #include <string>
@@ -17,6 +18,14 @@ void error(const std::size_t line, const std::string_view message);
 ParseError error(const Token &token, const std::string_view message);
 void runtimeError(const RuntimeError &error);
 
+// How many errors have been reported on the calling thread so far. Reports themselves are written one message per
+// call, so reports from different threads don't interleave within a line.
+std::size_t reportedErrors();
+
+// Where the calling thread reports errors: stderr, unless redirected.
+std::FILE *errorStream();
+void setErrorStream(std::FILE *stream);
+
 class RuntimeError : public std::exception {
 private:
   Token m_token;
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "lox/callable/function/function.h"
+#include "lox/environment/environment.h"
+#include "lox/interpreter/machine.h"
+
+#include <any>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace lox {
+class Interpreter;
+
+// Returned by a native function instead of a value to park the coroutine calling it: the coroutine suspends as if it
+// yielded nil and makes the same call again when it is resumed. Only a native called while Interpreter::coroutine()
+// isn't null may return it; channels park a coroutine rather than block its thread.
+struct Parked {};
+
+// A call of a function that yields. Creating one runs nothing; each resume() runs the call on a machine of its own up
+// to the next yield statement and returns the value yielded, or to the end of the call and returns its result. While
+// suspended the call is nothing but the machine's stacks on the heap, so waiting coroutines take no native stack and
+// thousands of them fit on one thread.
+class Coroutine {
+public:
+  enum class State : std::uint8_t { Suspended, Running, Done };
+
+private:
+  Interpreter &m_interpreter;
+  Machine m_machine;
+  const FunctionStmt *m_declaration;
+  std::shared_ptr<Environment> m_environment; // the environment the call was in when it yielded
+  State m_state = State::Suspended;
+
+public:
+  // The arity has to be checked by the caller.
+  Coroutine(Interpreter &interpreter, const Function &function, const std::vector<std::any> &arguments);
+
+  Coroutine(const Coroutine &) = delete;
+  Coroutine &operator=(const Coroutine &) = delete;
+
+  // Throws NativeError for a coroutine that is running or done. A runtime error in the call ends the coroutine and
+  // propagates.
+  std::any resume();
+
+  State state() const;
+  bool isParked() const; // suspended by a native call rather than a yield, see Parked
+  operator std::string() const;
+
+  // Adds the environments the call holds on to, for a heap snapshot; see Machine::environments().
+  void environments(std::vector<const Environment *> &roots) const;
+};
+
+// Runs coroutines round-robin on the thread of their interpreter: every turn resumes the first one in line up to its
+// next yield and, unless it is done, puts it back at the end. The values they yield are dropped. Once every coroutine
+// in line has parked in a row, waiting for another thread, the scheduler yields its thread before the next round.
+class Scheduler {
+private:
+  std::deque<std::shared_ptr<Coroutine>> m_ready;
+  std::size_t m_switches = 0;
+
+public:
+  void schedule(std::shared_ptr<Coroutine> coroutine);
+  void clear();
+
+  // Returns once every scheduled coroutine is done. A runtime error in one of them propagates and leaves the others
+  // scheduled.
+  void run();
+
+  std::size_t scheduled() const;
+  const std::deque<std::shared_ptr<Coroutine>> &ready() const;
+  std::size_t switches() const; // resumptions so far
+};
+
+}
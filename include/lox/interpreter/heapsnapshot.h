@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace lox {
+class Environment;
+class InstanceRegistry;
+
+// How many objects of each kind an interpreter holds and how many bytes they take, by name: instances by the name of
+// their class, classes and functions by their own, strings and environments all under one entry. The bytes of an
+// object are its own, estimated from the sizes of the C++ objects and tables that make it up; what it refers to counts
+// under the kind of that, so the entries add up to the heap of the interpreter.
+//
+// Snapshots are written as text, one entry per line, so that two of them taken apart in time can be compared to find
+// what grows; see since().
+class HeapSnapshot {
+public:
+  enum class Kind : std::uint8_t { Instance, Class, Function, String, Environment };
+
+  struct Entry {
+    std::size_t count = 0;
+    std::size_t bytes = 0;
+
+    bool operator==(const Entry &) const = default;
+  };
+
+  using Entries = std::map<std::pair<Kind, std::string>, Entry>;
+
+  // Of an entry from one snapshot to the next.
+  struct Change {
+    Kind kind;
+    std::string name;
+    std::int64_t count;
+    std::int64_t bytes;
+  };
+
+private:
+  Entries m_entries;
+
+public:
+  HeapSnapshot() = default;
+  explicit HeapSnapshot(Entries entries);
+
+  // Every live instance of the registry, whether anything still reaches it or not (instances in a reference cycle
+  // outlive the last variable that held them), and everything reachable from those and from the roots. Takes as long
+  // as the heap is big, and has to run on the thread that runs the interpreter, between two statements.
+  static HeapSnapshot take(std::span<const Environment *const> roots, InstanceRegistry &instances);
+
+  const Entries &entries() const;
+  Entry entry(Kind kind, const std::string &name = {}) const;
+  Entry total(Kind kind) const;
+  Entry total() const;
+
+  void write(std::ostream &out) const;
+
+  // Throws std::runtime_error if the text isn't a snapshot.
+  static HeapSnapshot read(std::istream &in);
+
+  // What changed from `before` to this snapshot, the entry that grew the most bytes first.
+  std::vector<Change> since(const HeapSnapshot &before) const;
+};
+
+const char *name(HeapSnapshot::Kind kind);
+
+}
@@ -2,26 +2,200 @@
 
 #include "lox/ast/stmt.h"
 #include "lox/ast/expr.h"
+#include "lox/callable/callable.h"
+#include "lox/callable/class/instance.h"
 #include "lox/callable/function/function.h"
+#include "lox/callable/native/native.h"
+#include "lox/concurrency/channel.h"
+#include "lox/error/error.h"
 #include "lox/environment/environment.h"
+#include "lox/interpreter/coroutine.h"
+#include "lox/interpreter/heapsnapshot.h"
+#include "lox/interpreter/machine.h"
+#include "lox/jit/jit.h"
+#include "lox/memory/arena.h"
 #include "lox/primitives/literal.h"
+#include "lox/profiler/callstack.h"
+#include "lox/profiler/tracer.h"
+#include "lox/output/output.h"
+#include "lox/resolver/resolution.h"
 
 #include <boost/variant/static_visitor.hpp>
 
 #include <memory>
 #include <vector>
 #include <unordered_map>
+#include <unordered_set>
+#include <algorithm>
 #include <any>
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <utility>
 
 namespace lox {
+class Program;
+
+// Thrown when a run goes past its Budget or is interrupted. It is a RuntimeError like any other, reported at the loop or
+// function that noticed.
+class LimitError : public RuntimeError {
+public:
+  enum class Reason : std::uint8_t { Steps, Deadline, Interrupt };
+
+private:
+  Reason m_reason;
+
+public:
+  LimitError(const Token &token, const Reason reason);
+  Reason reason() const;
+};
 
 class Interpreter {
+public:
+  // Bounds the work of a run. A step is a loop iteration or a function call; the deadline and the interrupt flag are
+  // looked at every `checkInterval` steps, so they take effect within a few microseconds of interpreted code.
+  struct Budget {
+    static constexpr std::int64_t checkInterval = 1024;
+
+    std::optional<std::uint64_t> steps;
+    std::optional<std::chrono::steady_clock::time_point> deadline;
+
+    bool isLimited() const;
+  };
+
+  // Whether every statement executed is counted, see statementCounts(). Configure with -DWITH_HOTSPOTS=ON to count;
+  // otherwise the counting isn't compiled in at all.
+#ifdef LOX_HOTSPOTS
+  static constexpr bool countsStatements = true;
+#else
+  static constexpr bool countsStatements = false;
+#endif
+
+  // What a run does, counted only while a Counters is attached; see setCounters().
+  struct Counters {
+    static constexpr std::size_t depths = 8; // local lookups this many environments up or further share the last bucket
+
+    std::size_t calls = 0; // of Lox functions and methods, initializers included
+    std::size_t propertyGets = 0;
+    std::size_t propertySets = 0;
+    std::size_t stringAllocations = 0; // strings made by concatenation
+    std::size_t globalLookups = 0;
+    std::array<std::size_t, depths> localLookups{}; // of variables, by the number of environments walked up
+
+    void lookup(const std::size_t distance) {
+      ++localLookups[std::min(distance, depths - 1)];
+    }
+  };
+
+  struct QuickeningStatistics {
+    std::size_t specialized = 0; // sites that switched to a specialized operation
+    std::size_t deoptimized = 0; // specialized sites whose guard failed later
+    std::size_t generic = 0;     // sites that saw mixed or non-specializable operands while warming up
+  };
+
 private:
-  std::unordered_map<Expr, std::size_t> m_locals;
-  std::vector<Stmt> m_statements;
-  Environment m_globals;
-  Environment m_environment;
+  // Type feedback of a BinaryExpr, indexed by BinaryExpr::site. A site warms up recording the operand types it sees and
+  // then either specializes on them or stays generic for good. A specialized site checks a cheap guard and falls back
+  // to the generic path, permanently, the first time the guard fails.
+  struct BinarySite {
+    // clang-format off
+    enum class Specialization : std::uint8_t {
+      AddNumNum, SubtractNumNum, MultiplyNumNum, DivideNumNum,
+      LessNumNum, LessEqualNumNum, GreaterNumNum, GreaterEqualNumNum, EqualNumNum, NotEqualNumNum,
+      AddStrStr, EqualStrStr, NotEqualStrStr
+    };
+    // clang-format on
+    enum class State : std::uint8_t { Warming, Specialized, Generic };
+
+    static constexpr std::uint8_t warmup = 8;
+    static constexpr std::uint8_t numbers = 1U << 0U;
+    static constexpr std::uint8_t strings = 1U << 1U;
+    static constexpr std::uint8_t others = 1U << 2U;
+
+    State state = State::Warming;
+    Specialization specialization = Specialization::AddNumNum;
+    std::uint8_t samples = 0;
+    std::uint8_t seen = 0;
+  };
+
+  std::shared_ptr<const Program> m_program; // null when the caller owns the statements
+  const std::vector<Stmt> &m_statements;
+  Resolution m_ownResolution;
+  const Resolution &m_resolution;
+  // The environments of the blocks and calls no closure can keep (see Resolution::frames), rewound as they end. Only
+  // the tree walk uses it: the frames of the machine and of coroutines are not left in the order they were entered.
+  memory::FrameArena m_frames;
+  std::shared_ptr<Environment> m_globals;
+  std::shared_ptr<Environment> m_environment;
+
+  // An environment that a running block, call or coroutine replaced and puts back when it ends, linked into a list for
+  // heap snapshots for as long as it lives; the current environment alone doesn't reach those of the callers.
+  class SavedEnvironment {
+    Interpreter &m_interpreter;
+    const std::shared_ptr<Environment> &m_environment;
+    const SavedEnvironment *m_next;
+
+  public:
+    SavedEnvironment(Interpreter &interpreter, const std::shared_ptr<Environment> &environment)
+        : m_interpreter(interpreter)
+        , m_environment(environment)
+        , m_next(std::exchange(interpreter.m_saved, this)) {}
+    ~SavedEnvironment() {
+      m_interpreter.m_saved = m_next;
+    }
+
+    SavedEnvironment(const SavedEnvironment &) = delete;
+    SavedEnvironment &operator=(const SavedEnvironment &) = delete;
+
+    const Environment *environment() const {
+      return m_environment.get();
+    }
+    const SavedEnvironment *next() const {
+      return m_next;
+    }
+  };
+  const SavedEnvironment *m_saved = nullptr; // the innermost
+
+  // Set by a return statement; the enclosing blocks and loops stop as soon as they see it, up to the function.
+  std::optional<std::any> m_returnValue;
+  Output m_output;
+
+  bool m_adaptive = false;
+  std::vector<BinarySite> m_binarySites;
+  QuickeningStatistics m_quickening;
+
+  std::unique_ptr<Jit> m_jit;
+  std::unique_ptr<Machine> m_machine;
+  Scheduler m_scheduler;
+
+  // Every checkpoint takes a step from the countdown; once it runs out, refuel() checks the budget and grants the
+  // next steps, at most checkInterval at a time.
+  Budget m_budget;
+  std::int64_t m_countdown = Budget::checkInterval;
+  std::uint64_t m_stepsLeft = 0; // of a limited budget, not granted yet
+  std::atomic<bool> m_interrupted = false;
+
+  // The isolates spawned from an interpreter that are still alive, which its interrupt() and a spent budget reach too.
+  // An isolate unlinks itself from its spawner's when destroyed, on whichever thread it ran.
+  struct Isolates {
+    std::mutex mutex;
+    std::vector<Interpreter *> interpreters;
+  };
+  std::shared_ptr<Isolates> m_isolates = std::make_shared<Isolates>();
+  std::shared_ptr<Isolates> m_spawner; // the isolates of the interpreter this one was spawned from, if any
+
+  const Coroutine *m_coroutine = nullptr; // the one running, if any
+  CallStack *m_callStack = nullptr;       // kept up to date only while a profiler looks at it
+  Counters *m_counters = nullptr;
+  Tracer *m_tracer = nullptr;
+  std::unique_ptr<InstanceRegistry> m_instances = std::make_unique<InstanceRegistry>();
+  std::vector<std::uint64_t> m_statementCounts; // by statement number, only if countsStatements
 
   class ExpressionVisitor : public boost::static_visitor<std::any> {
     Interpreter &m_interpreter;
@@ -32,16 +206,48 @@ private:
     std::any evaluate(const Expr &expr) const;
 
     Literal operator()(const LiteralExpr &expr) const;
-    Literal operator()(const LogicalExpr &expr) const;
+    std::any operator()(const LogicalExpr &expr) const;
     std::any operator()(const SetExpr &expr) const;
-    Literal operator()(const GroupingExpr &expr) const;
+    std::any operator()(const GroupingExpr &expr) const;
     Literal operator()(const UnaryExpr &expr) const;
     Literal operator()(const BinaryExpr &expr) const;
     std::any operator()(const CallExpr &expr) const;
     std::any operator()(const GetExpr &expr) const;
     std::any operator()(const VariableExpr &expr) const;
-    Literal operator()(const AssignExpr &expr) const;
+    std::any operator()(const AssignExpr &expr) const;
+    std::any operator()(const ThisExpr &expr) const;
+    std::any operator()(const SuperExpr &expr) const;
     Literal operator()([[maybe_unused]] const auto & /*unused*/) const;
+
+    static Callable callable(const CallExpr &expr, const std::any &callee);
+    std::vector<std::any> arguments(const CallExpr &expr, const std::size_t arity) const;
+    static void checkArity(const CallExpr &expr, const std::size_t arity, const std::size_t count);
+    static void checkArity(const CallExpr &expr, const Native &native, const std::size_t count);
+
+    // Evaluates the arguments of a call to a native function in place and calls it.
+    std::any callNative(const CallExpr &expr, const Native &native) const;
+
+    // Calls a native function with arguments of the right count; a NativeError becomes a RuntimeError at the call.
+    static std::any invokeNative(const CallExpr &expr, const Native &native, std::span<const std::any> arguments);
+
+    // The operations of the nodes, applied to operands that are already evaluated.
+    Literal unary(const UnaryExpr &expr, const std::any &right) const;
+    Literal binary(const BinaryExpr &expr, const std::any &left, const std::any &right) const;
+    Literal binary(const BinaryExpr &expr, const Literal &left, const Literal &right) const;
+    std::any get(const GetExpr &expr, const std::any &object) const;
+    void set(const SetExpr &expr, std::any &object, const std::any &value) const;
+    static bool isShortCircuit(const LogicalExpr &expr, const std::any &left);
+
+    // Anything but a literal is truthy.
+    static bool isTruthy(const std::any &value);
+
+    // Values that aren't literals (functions, classes, instances, channels) are only equal to themselves.
+    static bool isEqual(const std::any &left, const std::any &right);
+
+  private:
+    Literal quickened(const BinaryExpr &expr) const;
+    const Literal *operand(const Expr &expr, std::any &storage) const;
+    Literal nonLiteral(const BinaryExpr &expr, const std::any &left, const std::any &right) const;
   };
 
   class StatementVisitor : public boost::static_visitor<void> {
@@ -63,20 +269,167 @@ private:
     void operator()(const WhileStmt &stmt) const;
     void operator()([[maybe_unused]] const auto & /*unused*/) const;
 
-    void executeBlock(const std::vector<Stmt> &statements, const Environment &env) const;
+    void executeBlock(const std::vector<Stmt> &statements, const std::shared_ptr<Environment> &env) const;
+    std::any executeFunction(const std::vector<Stmt> &body, const std::shared_ptr<Environment> &env) const;
+
+    // Runs a call of a function that doesn't yield, in an environment on the frame arena unless a closure can keep it.
+    std::any executeCall(const Function &function, const std::vector<std::any> &arguments) const;
+
+    // The coroutine of a call of a function that yields.
+    std::any coroutine(const Function &function, const std::vector<std::any> &arguments) const;
+
+    void print(const std::any &value) const;
+
+    // Taken at every loop iteration and function call.
+    void checkpoint(const Token &where) const {
+      if (--m_interpreter.m_countdown < 0) [[unlikely]]
+        m_interpreter.refuel(where);
+    }
   };
 
 private:
+  friend class Machine;
+  friend class Coroutine;
+
   ExpressionVisitor m_expressionVisitor;
   StatementVisitor m_statementVisitor;
 
-  std::any lookUpVariable(const Token &name, const Expr &expr) const;
+  std::any lookUpVariable(const Token &name) const;
+  void assignVariable(const Token &name, const std::any &value);
+  const std::any &variable(const Token &name) const;
+  void countStringAllocation() const;
+
+  void countStatement(const Stmt &stmt) {
+    const std::size_t id = statementId(stmt);
+    if (id >= m_statementCounts.size())
+      m_statementCounts.resize(id + 1);
+    ++m_statementCounts[id];
+  }
+  void countLookup(const decltype(Resolution::locals)::const_iterator local) const;
+
+  // An environment on the frame arena, to be dropped before the frame it was made in is left.
+  std::shared_ptr<Environment> frameEnvironment(const std::shared_ptr<Environment> &enclosing);
+
+  void defineClock();
+  void defineCoroutines();
+  void defineHeapStats();
+
+  // Throws LimitError if the run is out of budget or interrupted, otherwise grants the next steps.
+  void refuel(const Token &where);
+  void interruptIsolates();
+
+  struct IsolateOf {
+    const Interpreter &interpreter;
+  };
+  explicit Interpreter(IsolateOf parent);
+
+  static std::optional<Literal> specialized(const BinarySite::Specialization specialization, const Literal &left, const Literal &right);
+  void record(BinarySite &site, const TokenKind op, const Literal &left, const Literal &right);
 
 public:
+  // Runs statements owned by the caller, which have to be resolved into resolution() before they run.
   Interpreter(const std::vector<Stmt> &statements);
 
-  void interpret() const;
-  void resolve(const Expr &expr, const std::size_t depth);
+  // Runs a compiled program, sharing its tree and resolution with every other interpreter of the same program. Such an
+  // interpreter is an isolate: its globals, environments, instances, type feedback and compiled code are its own, so
+  // interpreters of one program can run on different threads without synchronizing. Each one must only be used by one
+  // thread at a time.
+  //
+  // Output goes to `output`, which has to outlive the interpreter.
+  explicit Interpreter(const std::shared_ptr<const Program> &program, std::FILE *output = stdout);
+
+  // Breaks the reference cycles between the globals, closures and instances, see the definition.
+  ~Interpreter();
+
+  // Another isolate of the same statements and resolution, writing to the same stream, with the same adaptive and
+  // compilation settings. Its globals are fresh, with nothing but the natives the interpreter defines itself; the
+  // statements, and the resolution if this interpreter owns it, have to outlive it.
+  //
+  // The isolate gets the deadline of this interpreter's Budget and the steps it has left, and is interrupted along with
+  // this interpreter, or once this one runs out of budget, for as long as it lives.
+  std::unique_ptr<Interpreter> isolate() const;
+
+  // Defines the functions and classes declared at the top level without running anything else.
+  void declare();
+
+  // Runs the top level of the program, reporting a runtime error instead of throwing it.
+  void interpret();
+
+  // Runs the top level of the program and lets a RuntimeError propagate.
+  void execute();
+
+  Resolution &resolution();
+
+  // Makes a C++ function callable from Lox as a global. The interpreter defines clock() itself, and the functions
+  // working with coroutines:
+  //
+  //   resume(co)    runs the coroutine up to its next yield and returns the value yielded, or the result of the call
+  //                 once it ends
+  //   done(co)      whether the call has ended
+  //   schedule(co)  hands the coroutine to the interpreter's Scheduler
+  //   run()         runs the scheduled coroutines until all of them are done
+  void defineNative(const std::string &name, const std::size_t arity, Native::Callback callback);
+
+  // Limits what runs from now on; an unlimited Budget lifts the limits. Compiled code (see setJit()) counts no steps and
+  // doesn't look at the clock, so the interpreter doesn't run any while the budget is limited.
+  void setBudget(const Budget &budget);
+  const Budget &budget() const;
+
+  // Makes the run, and those of the isolates spawned from it, throw a LimitError at their next check. Safe to call from
+  // any thread, while the interpreter runs.
+  void interrupt();
+
+  // Records the Lox functions being executed in the call stack, for a Profiler; null stops recording.
+  void setCallStack(CallStack *callStack);
+  CallStack *callStack() const;
+
+  // Counts calls, variable lookups, property accesses and string concatenations into the counters from now on; null
+  // stops counting. Compiled code (see setJit()) isn't counted.
+  void setCounters(Counters *counters);
+  Counters *counters() const;
+
+  // Records the run, the calls that take at least the tracer's threshold and the objects the program makes into the
+  // tracer; null stops tracing. Isolates spawned from now on trace into the same tracer.
+  void setTracer(Tracer *tracer);
+  Tracer *tracer() const;
+
+  // How often each statement ran, indexed by the number the parser gave it (see Stmt); statements past the end of the
+  // vector never ran. Empty unless countsStatements. Compiled code (see setJit()) isn't counted.
+  const std::vector<std::uint64_t> &statementCounts() const;
+
+  void setAdaptive(const bool adaptive);
+  const QuickeningStatistics &quickeningStatistics() const;
+
+  // Compiles hot numeric functions to machine code where the platform allows it; see Jit.
+  void setJit(const bool enabled);
+  Jit *jit() const;
+
+  const std::shared_ptr<Environment> &globals() const;
+
+  // The instances the interpreter made that are still alive, reachable or not.
+  InstanceRegistry &instances() const;
+
+  // The live instances, and everything reachable from them, the globals, the environments of the running calls and
+  // blocks and of their callers, and those of the scheduled coroutines; see HeapSnapshot.
+  // Only to be taken on the thread running the interpreter, from a native function or between two calls. Lox code
+  // takes one with the heapStats() native:
+  //
+  //   heapStats()       an instance of HeapStats, with the count and bytes of the live instances, classes, functions,
+  //                     strings and environments in fields named after them (instances, instanceBytes, ...)
+  //   heapStats(name)   the number of live instances of the class of that name
+  HeapSnapshot heapSnapshot() const;
+  const std::vector<Stmt> &statements() const;
+  Output &output();
+
+  // Runs the program on heap allocated stacks instead of the C++ stack, limiting calls to `maxDepth` nested frames;
+  // see Machine.
+  void setExplicitStack(const bool enabled, const std::size_t maxDepth = Machine::defaultMaxDepth);
+  const Machine *machine() const;
+
+  const Scheduler &scheduler() const;
+
+  // The coroutine running, whose native calls may return Parked; null while none is.
+  const Coroutine *coroutine() const;
 
   ExpressionVisitor &expressionVisitor();
   const ExpressionVisitor &expressionVisitor() const;
@@ -0,0 +1,157 @@
+#pragma once
+
+#include "lox/ast/stmt.h"
+#include "lox/ast/expr.h"
+#include "lox/callable/function/function.h"
+#include "lox/environment/environment.h"
+#include "lox/profiler/tracer.h"
+
+#include <boost/variant/static_visitor.hpp>
+
+#include <any>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace lox {
+class Interpreter;
+
+// Runs a program without recursing on the C++ stack. The pending work is a stack of tasks, each naming a node and what
+// is left to do with it; intermediate values sit on a value stack and every Lox call pushes a frame record that knows
+// how far to unwind the other stacks when the call returns. All of them live on the heap and grow as needed, so the
+// call depth is only limited by `maxDepth`, past which the call fails with a RuntimeError.
+//
+// The machine shares the state of the Interpreter (environments, resolved locals, output) and its operator
+// semantics; it only replaces the recursive visitors. Since nothing of a run is on the C++ stack, a run can also stop
+// at a yield statement and be resumed later, which is how a Coroutine runs.
+class Machine : public boost::static_visitor<void> {
+public:
+  static constexpr std::size_t defaultMaxDepth = 100'000;
+
+  struct Statistics {
+    std::size_t peakFrames = 0;
+    std::size_t peakTasks = 0;
+    std::size_t peakValues = 0;
+    std::size_t peakBytes = 0; // of the frame, task, value and saved environment stacks together
+
+    // What one Lox frame costs on the machine's own stacks at the peak. The environment of the call is a separate
+    // heap object and isn't included.
+    std::size_t bytesPerFrame() const;
+  };
+
+private:
+  enum class Operation : std::uint8_t {
+    Execute,       // node: Stmt
+    Evaluate,      // node: Expr
+    Sequence,      // node: std::vector<Stmt>, count: index of the next statement
+    ExitBlock,     // restores the environment a block saved
+    ExitFunction,  // the body ran to its end without a return
+    Discard,       // drops the value of an expression statement
+    Print,         // node: PrintStmt
+    Define,        // node: VariableStmt
+    Return,        // node: ReturnStmt
+    Yield,         // node: YieldStmt, suspends the run with the value on top of the stack
+    TailCall,      // node: CallExpr, count: number of arguments
+    Branch,        // node: IfStmt
+    Loop,          // node: WhileStmt, schedules the condition
+    LoopCondition, // node: WhileStmt, runs the body if the condition holds
+    Assign,        // node: AssignExpr
+    Unary,         // node: UnaryExpr
+    Binary,        // node: BinaryExpr
+    Logical,       // node: LogicalExpr
+    Call,          // node: CallExpr, count: number of arguments
+    Get,           // node: GetExpr
+    Set            // node: SetExpr
+  };
+
+  struct Task {
+    Operation operation;
+    std::uint32_t count = 0;
+    const void *node = nullptr;
+  };
+
+  struct Frame {
+    std::shared_ptr<Environment> caller;
+    std::size_t tasks;
+    std::size_t values;
+    std::size_t environments;
+    std::any instance; // what the call returns if it runs an initializer
+    const FunctionStmt *function;
+    Tracer::Clock::time_point started; // only while tracing
+  };
+
+  Interpreter &m_interpreter;
+  std::size_t m_maxDepth;
+
+  std::vector<Task> m_tasks;
+  std::vector<std::any> m_values;
+  std::vector<Frame> m_frames;
+  std::vector<std::shared_ptr<Environment>> m_environments; // saved by the blocks being executed
+
+  bool m_suspended = false;
+  bool m_parked = false; // suspended by a native call, see Parked
+  Statistics m_statistics;
+
+public:
+  Machine(Interpreter &interpreter, const std::size_t maxDepth = defaultMaxDepth);
+
+  void run(const std::vector<Stmt> &statements);
+
+  // Sets up a call of the function for resume() to run. The caller makes the environment of the call
+  // (Function::environment()) the current one whenever the machine runs.
+  void start(const Function &function);
+
+  // Runs until the pending work yields, returning true, or is done. Either way take() hands out the value yielded or
+  // returned.
+  bool resume();
+  std::any take();
+  bool isParked() const;
+
+  const Statistics &statistics() const;
+
+  // Adds the environments the run holds on to besides the current one, those of the callers and those the blocks being
+  // executed saved, for a heap snapshot.
+  void environments(std::vector<const Environment *> &roots) const;
+
+  // Schedule the work of a node.
+  void operator()(const BlockStmt &stmt);
+  void operator()(const ClassStmt &stmt);
+  void operator()(const ExpressionStmt &stmt);
+  void operator()(const FunctionStmt &stmt);
+  void operator()(const IfStmt &stmt);
+  void operator()(const PrintStmt &stmt);
+  void operator()(const ReturnStmt &stmt);
+  void operator()(const VariableStmt &stmt);
+  void operator()(const WhileStmt &stmt);
+  void operator()(const YieldStmt &stmt);
+
+  void operator()(const AssignExpr &expr);
+  void operator()(const BinaryExpr &expr);
+  void operator()(const CallExpr &expr);
+  void operator()(const GetExpr &expr);
+  void operator()(const GroupingExpr &expr);
+  void operator()(const LiteralExpr &expr);
+  void operator()(const LogicalExpr &expr);
+  void operator()(const SetExpr &expr);
+  void operator()(const UnaryExpr &expr);
+  void operator()(const VariableExpr &expr);
+  void operator()(const ThisExpr &expr);
+  void operator()(const SuperExpr &expr);
+  void operator()(const auto & /*unused*/);
+
+private:
+  void step(const Task task);
+
+  void push(const Operation operation, const void *node, const std::uint32_t count = 0);
+  std::any pop();
+  std::vector<std::any> popArguments(const std::size_t count);
+
+  bool callNative(const Task task);
+  void call(const CallExpr &expr, const std::any &callee, std::vector<std::any> arguments);
+  void enter(const CallExpr &expr, const Function &function, const std::vector<std::any> &arguments);
+  void leave();
+  void returnValue(std::any value);
+};
+
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <utility>
+#include <vector>
+
+namespace lox {
+
+enum class Xmm : std::uint8_t { Xmm0, Xmm1, Xmm2, Xmm3, Xmm4, Xmm5, Xmm6, Xmm7 };
+
+// Low nibble of the Jcc opcode. Above/Below are the unsigned forms, which is what ucomisd sets.
+enum class Condition : std::uint8_t {
+  Below = 0x2,
+  AboveEqual = 0x3,
+  Equal = 0x4,
+  NotEqual = 0x5,
+  BelowEqual = 0x6,
+  Above = 0x7,
+  Parity = 0xA,
+  NotParity = 0xB,
+  Greater = 0xF
+};
+
+enum class Arithmetic : std::uint8_t { Add = 0x58, Multiply = 0x59, Subtract = 0x5C, Divide = 0x5E };
+
+// Emits the handful of x86-64 instructions the baseline compiler needs. Values are doubles kept in the low xmm
+// registers, in rbp-relative frame slots or on the machine stack; rax is the only general purpose scratch register.
+// Jumps and calls take labels, which may be bound after they are used; finish() patches their displacements.
+class Assembler {
+public:
+  using Label = std::size_t;
+
+private:
+  static constexpr std::size_t unbound = static_cast<std::size_t>(-1);
+
+  std::vector<std::uint8_t> m_code;
+  std::vector<std::size_t> m_labels;
+  std::vector<std::pair<std::size_t, Label>> m_fixups; // position of a rel32 field and its target
+
+public:
+  Label newLabel();
+  void bind(const Label label);
+  std::size_t offset(const Label label) const;
+
+  // push rbp; mov rbp, rsp; sub rsp, <frame size>. Returns the position to hand to setFrameSize().
+  std::size_t enter();
+  void setFrameSize(const std::size_t position, const std::uint32_t bytes);
+  void leave();
+  void ret();
+
+  void loadLocal(const Xmm to, const std::int32_t offset);
+  void storeLocal(const std::int32_t offset, const Xmm from);
+  void loadArgument(const Xmm to, const std::uint8_t index);
+  void push(const Xmm from);
+  void pop(const Xmm to);
+  void loadConstant(const Xmm to, const double value);
+  void move(const Xmm to, const Xmm from);
+
+  void arithmetic(const Arithmetic operation, const Xmm to, const Xmm from);
+  void negate(const Xmm value, const Xmm scratch);
+  void compare(const Xmm left, const Xmm right);
+
+  void jump(const Label target);
+  void jumpIf(const Condition condition, const Label target);
+  void call(const Label target);
+
+  // Counters and flags shared with the runtime, addressed through rax.
+  void loadAddress(const void *address);
+  void increment();
+  void decrement();
+  void compareWith(const std::int32_t value);
+  void setFlag();
+  void testFlag();
+
+  std::vector<std::uint8_t> finish();
+
+private:
+  void emit(std::initializer_list<std::uint8_t> bytes);
+  void emit32(const std::uint32_t value);
+  void emit64(const std::uint64_t value);
+  void emitRelative(const Label target);
+};
+
+}
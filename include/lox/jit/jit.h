@@ -0,0 +1,83 @@
+#pragma once
+
+#include "lox/ast/stmt.h"
+
+#include <any>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+namespace lox {
+
+// Baseline compiler for hot global functions that only compute with numbers: parameters, local variables, arithmetic,
+// comparisons in conditions, if, while, return and calls to themselves. Once a function has been called `threshold`
+// times its body is translated, one template per node, to x86-64 code in an executable mapping. Everything else is
+// left to the interpreter.
+//
+// Such a function has no side effects, so a native call that can't finish (falling off the end, which would return
+// nil, or recursing past `maxDepth`) simply gives up and the interpreter runs the call again from the start. The
+// function isn't compiled code from then on.
+//
+// Compiled code counts no steps of a Budget, but it looks at the interpreter's interrupt flag on entry and at every loop
+// iteration. A raised flag makes it give up the same way, leaving the function compiled, and the interpreter runs the
+// call again up to its first checkpoint, where it throws.
+class Jit {
+public:
+  struct Statistics {
+    std::size_t compiled = 0;      // functions translated to machine code
+    std::size_t rejected = 0;      // hot functions the compiler doesn't handle
+    std::size_t guardFailures = 0; // native calls skipped because an argument wasn't a number
+    std::size_t bailouts = 0;      // native calls the interpreter had to run again
+    std::size_t codeSize = 0;      // bytes of machine code
+    std::chrono::nanoseconds compileTime{};
+  };
+
+  static constexpr std::size_t threshold = 64;
+  static constexpr std::size_t maxArity = 8; // arguments are passed in xmm0-xmm7
+  static constexpr std::int32_t maxDepth = 10'000;
+
+  class Code;
+
+private:
+  struct Entry {
+    enum class State : std::uint8_t { Cold, Compiled, Rejected };
+
+    State state = State::Cold;
+    std::size_t calls = 0;
+    std::unique_ptr<Code> code;
+  };
+
+  std::unordered_map<const FunctionStmt *, Entry> m_functions;
+  Statistics m_statistics;
+
+  // Addressed directly by the generated code.
+  std::int64_t m_depth = 0;
+  std::uint8_t m_bailout = 0;
+  const std::atomic<bool> *m_interrupted;
+
+public:
+  // `interrupted` is the interrupt flag of the interpreter, which has to outlive the Jit.
+  explicit Jit(const std::atomic<bool> &interrupted);
+  ~Jit();
+
+  Jit(const Jit &) = delete;
+  Jit &operator=(const Jit &) = delete;
+
+  static bool isSupported();
+
+  // Runs the function natively if it is hot, compiled and all arguments are numbers. An empty result means the caller
+  // has to interpret the call.
+  std::optional<double> call(const FunctionStmt &declaration, const std::vector<std::any> &arguments);
+
+  const Statistics &statistics() const;
+
+private:
+  void compile(Entry &entry, const FunctionStmt &declaration);
+};
+
+}
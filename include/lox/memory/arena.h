@@ -0,0 +1,72 @@
+#pragma once
+
+#include "lox/memory/memory.h"
+
+#include <cstddef>
+#include <memory_resource>
+#include <vector>
+
+namespace lox::memory {
+
+// Memory for what is made and dropped in LIFO order, the environments of blocks and calls: allocating bumps a pointer
+// and deallocating does nothing; leaving a Frame rewinds the arena to where it stood when the frame was entered. The
+// chunks stay once they are taken from the upstream resource, so a program that calls and loops in a steady state
+// doesn't allocate at all. Not thread-safe: an interpreter owns one and runs on one thread at a time.
+class FrameArena : public std::pmr::memory_resource {
+public:
+  static constexpr std::size_t chunkSize = 64 * 1024;
+
+  struct Mark {
+    std::size_t chunk;
+    std::size_t offset;
+  };
+
+  // Everything allocated while it is in scope has to be destroyed before it goes out of scope.
+  class Frame {
+    FrameArena &m_arena;
+    Mark m_mark;
+
+  public:
+    explicit Frame(FrameArena &arena)
+        : m_arena(arena)
+        , m_mark(arena.mark()) {}
+
+    ~Frame() {
+      m_arena.rewind(m_mark);
+    }
+
+    Frame(const Frame &) = delete;
+    Frame &operator=(const Frame &) = delete;
+  };
+
+private:
+  struct Chunk {
+    std::byte *memory;
+    std::size_t size;
+  };
+
+  std::pmr::memory_resource *m_upstream;
+  std::vector<Chunk> m_chunks;
+  std::size_t m_chunk = 0; // the chunk allocations bump through, m_chunks.size() before the first one
+  std::size_t m_offset = 0;
+
+public:
+  explicit FrameArena(std::pmr::memory_resource *upstream = resource(Tag::Environments));
+  ~FrameArena() override;
+
+  FrameArena(const FrameArena &) = delete;
+  FrameArena &operator=(const FrameArena &) = delete;
+
+  Mark mark() const;
+  void rewind(Mark mark);
+
+  // Bytes taken from upstream, in use or not.
+  std::size_t reserved() const;
+
+private:
+  void *do_allocate(std::size_t bytes, std::size_t alignment) override;
+  void do_deallocate(void *memory, std::size_t bytes, std::size_t alignment) override;
+  bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override;
+};
+
+}
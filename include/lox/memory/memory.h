@@ -0,0 +1,101 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <utility>
+
+namespace lox::memory {
+
+// What memory is for. Containers that take an allocator get a resource of their tag (see resource()); every other
+// allocation is charged to the tag of the innermost Scope of its thread, provided the program links the operator
+// new hook (the lox::memoryhook object library). Each thread counts into counters of its own without a locked
+// instruction and publishes its balance to the process-wide live and peak bytes once it has moved by `slack` bytes,
+// cheap enough to leave on in production.
+enum class Tag : std::uint8_t { Other, Scanner, Parser, Resolver, Environments, Objects, Strings };
+
+inline constexpr std::size_t tagCount = 7;
+inline constexpr std::int64_t slack = 64 * 1024;
+
+const char *name(Tag tag);
+
+struct Usage {
+  std::int64_t liveBytes = 0;
+  std::int64_t peakBytes = 0;
+  std::uint64_t allocations = 0;
+};
+
+// Of the whole process, since it started or since the last resetPeaks(). Exact while a single thread allocates and
+// frees; otherwise each other thread that does may hold back up to `slack` bytes of a tag from the peak.
+struct Statistics {
+  std::array<Usage, tagCount> tags;
+  Usage total;
+  bool hooked = false; // whether allocations outside the tagged resources are accounted for
+};
+
+Statistics statistics();
+
+// Lets every peak start over from the bytes live now, to find the peak of a stretch of the run.
+void resetPeaks();
+
+void recordAllocation(Tag tag, std::size_t bytes);
+void recordDeallocation(Tag tag, std::size_t bytes);
+
+// Called once by the operator new hook.
+void markHooked();
+
+namespace detail {
+inline thread_local Tag current = Tag::Other;
+}
+
+inline Tag currentTag() {
+  return detail::current;
+}
+
+// Charges what the thread allocates to the tag while it's in scope.
+class Scope {
+  Tag m_previous;
+
+public:
+  explicit Scope(const Tag tag)
+      : m_previous(std::exchange(detail::current, tag)) {}
+
+  ~Scope() {
+    detail::current = m_previous;
+  }
+
+  Scope(const Scope &) = delete;
+  Scope &operator=(const Scope &) = delete;
+};
+
+// Charges what it allocates to its tag, whatever the scope. It takes the memory from malloc() and not from operator
+// new, so that the hook doesn't count it a second time.
+class TaggedResource : public std::pmr::memory_resource {
+  Tag m_tag;
+
+public:
+  explicit TaggedResource(const Tag tag)
+      : m_tag(tag) {}
+
+  Tag tag() const {
+    return m_tag;
+  }
+
+private:
+  void *do_allocate(std::size_t bytes, std::size_t alignment) override;
+  void do_deallocate(void *memory, std::size_t bytes, std::size_t alignment) override;
+  bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override;
+};
+
+// The process-wide resource of the tag.
+std::pmr::memory_resource *resource(Tag tag);
+
+// std::make_shared from the resource of the tag, control block and all.
+template <class T, class... Args>
+std::shared_ptr<T> makeShared(const Tag tag, Args &&...arguments) {
+  return std::allocate_shared<T>(std::pmr::polymorphic_allocator<T>(resource(tag)), std::forward<Args>(arguments)...);
+}
+
+}
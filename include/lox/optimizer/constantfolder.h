@@ -0,0 +1,61 @@
+#pragma once
+
+#include "lox/ast/expr.h"
+#include "lox/ast/stmt.h"
+#include "lox/primitives/literal.h"
+#include "lox/optimizer/pass.h"
+
+#include <boost/variant/static_visitor.hpp>
+
+#include <cstddef>
+#include <optional>
+#include <vector>
+
+namespace lox {
+
+// Rewrites the tree in place before it is resolved: operators whose operands are all literals are replaced by their
+// result and grouping parentheses are dropped. Anything that would raise a runtime error (e.g. `-"str"`) is left as it
+// is, so the error is still reported at run time with the same line.
+class ConstantFolder : public boost::static_visitor<void> {
+private:
+  std::size_t m_foldedExpressions = 0;
+  std::size_t m_removedGroupings = 0;
+  std::size_t m_shortCircuits = 0;
+
+public:
+  void run(std::vector<Stmt> &statements);
+  PassStatistics statistics() const;
+
+  void fold(std::vector<Stmt> &statements);
+  void fold(Stmt &stmt);
+  void fold(Expr &expr);
+
+  void operator()(BlockStmt &stmt);
+  void operator()(ClassStmt &stmt);
+  void operator()(ExpressionStmt &stmt);
+  void operator()(FunctionStmt &stmt);
+  void operator()(IfStmt &stmt);
+  void operator()(PrintStmt &stmt);
+  void operator()(ReturnStmt &stmt);
+  void operator()(VariableStmt &stmt);
+  void operator()(WhileStmt &stmt);
+  void operator()(YieldStmt &stmt);
+
+  void operator()(AssignExpr &expr);
+  void operator()(BinaryExpr &expr);
+  void operator()(CallExpr &expr);
+  void operator()(GetExpr &expr);
+  void operator()(GroupingExpr &expr);
+  void operator()(LogicalExpr &expr);
+  void operator()(SetExpr &expr);
+  void operator()(UnaryExpr &expr);
+
+  void operator()(auto & /*unused*/);
+
+private:
+  std::optional<Expr> simplify(Expr &expr);
+  std::optional<Literal> evaluate(const BinaryExpr &expr) const;
+  std::optional<Literal> evaluate(const UnaryExpr &expr) const;
+};
+
+}
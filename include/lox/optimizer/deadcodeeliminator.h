@@ -0,0 +1,44 @@
+#pragma once
+
+#include "lox/ast/stmt.h"
+#include "lox/optimizer/pass.h"
+
+#include <boost/variant/static_visitor.hpp>
+
+#include <cstddef>
+#include <optional>
+#include <vector>
+
+namespace lox {
+
+// Removes statements that can never run or have no effect: everything after a statement that always returns,
+// `if`/`while` whose condition is a literal, and expression statements that are bare literals. Conditions only become
+// literals after constant folding, so this pass is meant to run after the ConstantFolder.
+class DeadCodeEliminator : public boost::static_visitor<void> {
+private:
+  std::size_t m_unreachableStatements = 0;
+  std::size_t m_foldedBranches = 0;
+  std::size_t m_removedLoops = 0;
+  std::size_t m_removedExpressions = 0;
+
+public:
+  void run(std::vector<Stmt> &statements);
+  PassStatistics statistics() const;
+
+  void eliminate(std::vector<Stmt> &statements);
+  void eliminate(Stmt &stmt);
+
+  void operator()(BlockStmt &stmt);
+  void operator()(ClassStmt &stmt);
+  void operator()(FunctionStmt &stmt);
+  void operator()(IfStmt &stmt);
+  void operator()(WhileStmt &stmt);
+
+  void operator()(auto & /*unused*/);
+
+private:
+  std::optional<Stmt> simplify(Stmt &stmt);
+  bool alwaysReturns(const Stmt &stmt) const;
+};
+
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "lox/ast/expr.h"
+#include "lox/ast/stmt.h"
+#include "lox/primitives/token.h"
+#include "lox/optimizer/pass.h"
+
+#include <boost/variant/static_visitor.hpp>
+
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace lox {
+
+// Replaces calls to small top-level functions with the expression they return. A function qualifies when its body is
+// a single `return` of a side-effect free expression (literals, variables, operators, property reads) and its global
+// binding is declared once and never assigned. Calls are expanded only where the name still refers to that global,
+// after the declaration in source order, and when doing so cannot change how often or whether an argument is
+// evaluated.
+class Inliner : public boost::static_visitor<void> {
+public:
+  static constexpr std::size_t maxInlineSize = 16; // nodes of the returned expression
+
+  // What evaluating the body does that could fail, in order: read a variable or apply an operator. An argument other
+  // than a literal has to be evaluated before any of these that a call would only run after it.
+  struct Step {
+    const std::string *variable; // null for an operator
+    bool isConditional;          // in the right operand of an `and` or `or`
+  };
+
+private:
+  struct Candidate {
+    const FunctionStmt *function;
+    const Expr *body;
+    std::unordered_map<std::string, std::size_t> variables; // name -> uses in body
+    std::vector<Step> steps;
+  };
+
+  std::unordered_map<std::string, Candidate> m_candidates;
+  std::unordered_set<std::string> m_pinned;
+  std::vector<std::unordered_set<std::string>> m_scopes;
+
+  std::size_t m_candidatesFound = 0;
+  std::size_t m_inlinedCalls = 0;
+
+public:
+  void run(std::vector<Stmt> &statements);
+  PassStatistics statistics() const;
+
+  void inlineCalls(std::vector<Stmt> &statements);
+  void inlineCalls(Stmt &stmt);
+  void inlineCalls(Expr &expr);
+
+  void operator()(BlockStmt &stmt);
+  void operator()(ClassStmt &stmt);
+  void operator()(ExpressionStmt &stmt);
+  void operator()(FunctionStmt &stmt);
+  void operator()(IfStmt &stmt);
+  void operator()(PrintStmt &stmt);
+  void operator()(ReturnStmt &stmt);
+  void operator()(VariableStmt &stmt);
+  void operator()(WhileStmt &stmt);
+  void operator()(YieldStmt &stmt);
+
+  void operator()(AssignExpr &expr);
+  void operator()(BinaryExpr &expr);
+  void operator()(CallExpr &expr);
+  void operator()(GetExpr &expr);
+  void operator()(GroupingExpr &expr);
+  void operator()(LogicalExpr &expr);
+  void operator()(SetExpr &expr);
+  void operator()(UnaryExpr &expr);
+
+  void operator()(auto & /*unused*/);
+
+private:
+  void declare(const Token &name);
+  bool isLocal(const std::string &name) const;
+
+  void consider(const FunctionStmt &function);
+  std::optional<Expr> expand(const CallExpr &call) const;
+};
+
+}
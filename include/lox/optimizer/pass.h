@@ -0,0 +1,18 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace lox {
+
+// What a pass did to the tree. Passes fill in their name and counters, the PassManager measures the elapsed time.
+struct PassStatistics {
+  std::string_view name;
+  std::chrono::nanoseconds elapsed{};
+  std::vector<std::pair<std::string_view, std::size_t>> counters;
+};
+
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "lox/ast/stmt.h"
+#include "lox/optimizer/pass.h"
+#include "lox/optimizer/constantfolder.h"
+#include "lox/optimizer/deadcodeeliminator.h"
+#include "lox/optimizer/inliner.h"
+
+#include <initializer_list>
+#include <iosfwd>
+#include <variant>
+#include <vector>
+
+namespace lox {
+
+// Runs optimization passes over the parsed tree, in order, before it is resolved and keeps per-pass statistics.
+class PassManager {
+public:
+  using Pass = std::variant<Inliner, ConstantFolder, DeadCodeEliminator>;
+
+private:
+  std::vector<Pass> m_passes;
+  std::vector<PassStatistics> m_statistics;
+
+public:
+  PassManager();
+  explicit PassManager(std::initializer_list<Pass> passes);
+
+  void run(std::vector<Stmt> &statements);
+
+  const std::vector<PassStatistics> &statistics() const;
+  void printStatistics(std::ostream &os) const;
+};
+
+}
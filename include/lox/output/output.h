@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdio>
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace lox {
+
+// Buffers program output and hands it to the stream in large blocks. The buffer is flushed when it fills up, when
+// the owner is destroyed and, if the stream is a terminal, at every newline so interactive output stays responsive.
+class Output {
+private:
+  static constexpr std::size_t capacity = 64 * 1024;
+
+  std::FILE *m_stream;
+  std::string m_buffer;
+  bool m_lineBuffered;
+
+public:
+  explicit Output(std::FILE *stream = stdout);
+  ~Output();
+
+  Output(const Output &) = delete;
+  Output &operator=(const Output &) = delete;
+
+  void write(const std::string_view text);
+  void writeLine(const std::string_view text);
+  void flush();
+
+  std::FILE *stream() const;
+};
+
+}
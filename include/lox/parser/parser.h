@@ -15,6 +15,9 @@ class Parser {
 private:
   std::vector<Token> m_tokens;
   std::size_t m_current = 0;
+  std::size_t m_binarySites = 0;
+  std::size_t m_statements = 0;
+  bool m_yields = false; // the function being parsed has a yield statement of its own
 
 public:
   Parser(const std::vector<Token> &tokens);
@@ -45,6 +48,7 @@ private:
   std::vector<Stmt> block();
   Stmt printStatement();
   Stmt returnStatement();
+  Stmt yieldStatement();
 
   Expr expression();
   Expr assignment();
@@ -59,5 +63,12 @@ private:
   Expr primary();
 
   Expr finishCall(const Expr &callee);
+
+  template <class T>
+  T numbered(T stmt, const std::size_t line) {
+    stmt.id = ++m_statements;
+    stmt.line = line;
+    return stmt;
+  }
 };
 }
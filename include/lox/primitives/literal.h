@@ -20,8 +20,8 @@ public:
   Literal(const std::string &s);
 
   bool isTruthy() const;
-  literal_t data();
-  const literal_t data() const;
+  literal_t &data();
+  const literal_t &data() const;
   operator std::string() const;
 };
 
@@ -17,7 +17,7 @@ enum class TokenKind : std::uint8_t {
     And, Or, True, False,                                                       // boolean
     If, Else,                                                                   // condition
     For, While,                                                                 // loop
-    Class, Super, Fun, Return, Var, Print, This,                                // keywords
+    Class, Super, Fun, Return, Var, Print, This, Yield,                         // keywords
     Nil, EndOfFile
   // clang-format on
 };
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "lox/ast/stmt.h"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace lox {
+
+// The Lox functions being executed, outermost first, as the interpreter enters and leaves them. It is kept for a
+// Profiler, whose signal handler reads it on the interpreter's own thread at any point between two instructions: a
+// frame is written before the depth that makes it visible, and the compiler is kept from reordering the two.
+//
+// Only the outermost `capacity` frames are recorded; deeper calls still count in the depth.
+class CallStack {
+public:
+  static constexpr std::size_t capacity = 128;
+
+  // Restores the depth it was made at when it goes out of scope, whether the code it guards returned or threw. Given a
+  // function, it pushes a frame for it first. Without a call stack it does nothing.
+  class Scope {
+    CallStack *m_stack;
+    std::uint32_t m_depth = 0;
+
+  public:
+    explicit Scope(CallStack *stack, const FunctionStmt *function = nullptr)
+        : m_stack(stack) {
+      if (m_stack == nullptr)
+        return;
+
+      m_depth = m_stack->depth();
+      if (function != nullptr)
+        m_stack->push(function);
+    }
+
+    ~Scope() {
+      if (m_stack != nullptr)
+        m_stack->truncate(m_depth);
+    }
+
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+  };
+
+private:
+  std::array<const FunctionStmt *, capacity> m_frames{};
+  std::atomic<std::uint32_t> m_depth = 0;
+
+public:
+  void push(const FunctionStmt *function) {
+    const std::uint32_t depth = m_depth.load(std::memory_order_relaxed);
+    if (depth < capacity)
+      m_frames[depth] = function;
+
+    std::atomic_signal_fence(std::memory_order_release);
+    m_depth.store(depth + 1, std::memory_order_relaxed);
+  }
+
+  void pop() {
+    const std::uint32_t depth = m_depth.load(std::memory_order_relaxed);
+    if (depth > 0)
+      m_depth.store(depth - 1, std::memory_order_relaxed);
+  }
+
+  void truncate(const std::uint32_t depth) {
+    m_depth.store(depth, std::memory_order_relaxed);
+  }
+
+  std::uint32_t depth() const {
+    return m_depth.load(std::memory_order_relaxed);
+  }
+
+  // The recorded frames, valid up to min(depth(), capacity).
+  const std::array<const FunctionStmt *, capacity> &frames() const {
+    return m_frames;
+  }
+};
+
+static_assert(std::atomic<std::uint32_t>::is_always_lock_free, "the depth is read from a signal handler");
+
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "lox/ast/stmt.h"
+#include "lox/profiler/callstack.h"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <map>
+#include <ostream>
+#include <thread>
+#include <vector>
+
+namespace lox {
+
+// Samples the Lox call stack of one interpreter. A timer on the CPU time of the thread that started the profiler
+// raises SIGPROF on that thread `frequency` times per second; the handler copies the CallStack into a ring of samples
+// without locking or allocating, and a background thread folds the samples into counts per distinct stack.
+//
+// Only one profiler can run at a time. Isolates spawned on other threads are not sampled.
+class Profiler {
+public:
+  static constexpr unsigned defaultFrequency = 997; // Hz, prime so sampling doesn't beat with periodic work
+  static constexpr std::size_t ringSize = 512;
+
+private:
+  struct Sample {
+    std::uint32_t depth;
+    std::array<const FunctionStmt *, CallStack::capacity> frames;
+  };
+
+  // The handler only writes the head and the background thread only the tail.
+  std::array<Sample, ringSize> m_ring{};
+  std::atomic<std::size_t> m_head = 0;
+  std::atomic<std::size_t> m_tail = 0;
+  std::atomic<std::size_t> m_dropped = 0; // samples taken while the ring was full
+
+  CallStack m_callStack;
+  unsigned m_frequency;
+  timer_t m_timer{};
+  std::atomic<bool> m_running = false;
+  std::thread m_drainer;
+
+  // Outermost frame first; a null frame at the end marks a stack deeper than the call stack records.
+  std::map<std::vector<const FunctionStmt *>, std::size_t> m_stacks;
+  std::size_t m_samples = 0;
+
+public:
+  explicit Profiler(const unsigned frequency = defaultFrequency);
+  ~Profiler();
+
+  Profiler(const Profiler &) = delete;
+  Profiler &operator=(const Profiler &) = delete;
+
+  // What the interpreter to profile has to maintain, see Interpreter::setCallStack().
+  CallStack &callStack();
+
+  // Throws std::logic_error if another profiler is running and std::system_error if the timer can't be set up.
+  void start();
+  void stop();
+
+  std::size_t samples() const;
+  std::size_t dropped() const;
+
+  // One line per distinct stack, "<script>;outer:line;inner:line count", the format flamegraph.pl and speedscope read.
+  // A frame is named after its function and the line it is declared on, methods of top-level classes as
+  // Class.method. The statements are the program that ran, to find those classes.
+  void writeFolded(std::ostream &out, const std::vector<Stmt> &statements) const;
+
+private:
+  static void handle(int signal);
+  void sample();
+  void drain();
+};
+
+}
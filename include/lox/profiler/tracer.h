@@ -0,0 +1,122 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace lox {
+
+// Writes a timeline of what the interpreter does as Chrome trace events (the JSON that Perfetto and chrome://tracing
+// load): a span per phase of the pipeline, a span per Lox call that took at least the threshold, and counters of the
+// objects the program allocates.
+//
+// Every thread records into a buffer of its own without locking; a full buffer is serialized and appended to the
+// output under a lock, so a long run neither grows without bound nor contends per event. finish() writes what the
+// buffers still hold and closes the JSON; the threads that recorded must be done by then.
+class Tracer {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  static constexpr std::size_t bufferSize = 4096;                                 // events of a thread per write
+  static constexpr std::chrono::microseconds allocationInterval{1000};            // between two allocation counters
+  static constexpr std::chrono::nanoseconds defaultThreshold = std::chrono::microseconds(100);
+
+  enum class Category : std::uint8_t { Phase, Call };
+  enum class Allocation : std::uint8_t { Instance, Closure, String };
+
+  // Records a span from its construction to its destruction, whether the code it guards returned or threw. Without a
+  // tracer it does nothing. The name is only copied if the span is recorded, so it has to outlive the span.
+  class Span {
+    Tracer *m_tracer;
+    std::string_view m_name;
+    Category m_category;
+    Clock::time_point m_start;
+
+  public:
+    Span(Tracer *tracer, const std::string_view name, const Category category = Category::Phase)
+        : m_tracer(tracer)
+        , m_name(name)
+        , m_category(category) {
+      if (m_tracer != nullptr)
+        m_start = Clock::now();
+    }
+
+    ~Span() {
+      if (m_tracer != nullptr)
+        m_tracer->complete(m_name, m_category, m_start, Clock::now());
+    }
+
+    Span(const Span &) = delete;
+    Span &operator=(const Span &) = delete;
+  };
+
+private:
+  static constexpr std::size_t allocationKinds = 3;
+
+  struct Event {
+    char type; // 'X' for a span, 'C' for a counter
+    Category category;
+    std::string name;
+    std::int64_t start; // nanoseconds since the tracer was made
+    std::int64_t duration;
+    std::array<std::uint64_t, allocationKinds> values;
+  };
+
+  struct Buffer {
+    std::uint32_t thread;
+    std::string name;
+    std::vector<Event> events;
+    std::array<std::uint64_t, allocationKinds> allocations{};
+    Clock::time_point lastAllocations{};
+    bool allocationsPending = false;
+  };
+
+  std::uint64_t m_id; // tells the buffers of this tracer apart from those of earlier ones, see buffer()
+  std::ostream &m_out;
+  std::chrono::nanoseconds m_threshold;
+  Clock::time_point m_origin;
+
+  std::mutex m_mutex; // guards the buffers list, the output and the counts below
+  std::deque<std::unique_ptr<Buffer>> m_buffers;
+  std::size_t m_written = 0;
+  bool m_finished = false;
+
+public:
+  // Calls shorter than the threshold are left out; phases are always recorded.
+  explicit Tracer(std::ostream &out, const std::chrono::nanoseconds threshold = defaultThreshold);
+  ~Tracer();
+
+  Tracer(const Tracer &) = delete;
+  Tracer &operator=(const Tracer &) = delete;
+
+  std::chrono::nanoseconds threshold() const;
+
+  void complete(std::string_view name, Category category, Clock::time_point start, Clock::time_point end);
+
+  // Counts an object the program made. The counts of a thread are recorded as a counter at most once per
+  // allocationInterval, and once more when the tracer finishes.
+  void allocation(Allocation kind);
+
+  // Names the calling thread in the trace.
+  void nameThread(const std::string &name);
+
+  // Writes out every buffer and closes the JSON. Returns the number of events written.
+  std::size_t finish();
+
+private:
+  Buffer &buffer();
+  void flush(Buffer &buffer);
+  void serialize(const Buffer &buffer, std::string &out) const;
+  void recordAllocations(Buffer &buffer, Clock::time_point now);
+  std::int64_t since(Clock::time_point time) const;
+};
+
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "lox/ast/stmt.h"
+#include "lox/profiler/tracer.h"
+#include "lox/resolver/resolution.h"
+
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace lox {
+
+// Thrown by Program::compile() after the errors themselves have been reported.
+class CompileError : public std::runtime_error {
+private:
+  std::size_t m_errors;
+
+public:
+  explicit CompileError(const std::size_t errors);
+  std::size_t errors() const;
+};
+
+// A script compiled once: scanned, parsed, optionally optimized and resolved. A program never changes after it has been
+// compiled, so any number of interpreters can run it without compiling it again, on as many threads as they like: the
+// tree and the resolution are only ever read.
+class Program {
+private:
+  std::vector<Stmt> m_statements;
+  Resolution m_resolution;
+
+  Program() = default;
+
+public:
+  struct Options {
+    bool optimize = false;     // run the PassManager once the tree resolved without errors
+    Tracer *tracer = nullptr; // records a span per phase of the compilation
+  };
+
+  static std::shared_ptr<const Program> compile(const std::string &source, const Options &options);
+  static std::shared_ptr<const Program> compile(const std::string &source);
+
+  Program(const Program &) = delete;
+  Program &operator=(const Program &) = delete;
+
+  const std::vector<Stmt> &statements() const;
+  const Resolution &resolution() const;
+};
+
+}
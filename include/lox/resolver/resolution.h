@@ -0,0 +1,31 @@
+#pragma once
+
+#include "lox/ast/stmt.h"
+#include "lox/primitives/token.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace lox {
+
+// What the Resolver found out about a parsed program. The first two tables are keyed by the address of a node of that
+// very tree, so they are only valid as long as it lives and isn't moved.
+struct Resolution {
+  // Whether a closure can keep the environment of a block or of a call of a function: it can if a function or class is
+  // declared in it, however deeply nested, as the environments of those enclose it.
+  enum class Frame : std::uint8_t { Unresolved, Scoped, Captured };
+
+  std::unordered_map<const Token *, std::size_t> locals;   // name token of a local reference -> scopes to walk up
+  std::unordered_set<const ReturnStmt *> tailCalls;        // returns whose value is a call in tail position
+  std::vector<Frame> frames;                               // by the number of the BlockStmt or FunctionStmt, see Stmt
+
+  // Statements the optimizer made have no number, and are taken to be captured.
+  bool isScoped(const std::size_t id) const {
+    return id != 0 && id < frames.size() && frames[id] == Frame::Scoped;
+  }
+};
+
+}
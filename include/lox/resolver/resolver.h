@@ -2,6 +2,7 @@
 
 #include "lox/ast/stmt.h"
 #include "lox/interpreter/interpreter.h"
+#include "lox/resolver/resolution.h"
 
 #include <boost/variant/static_visitor.hpp>
 #include <string>
@@ -21,10 +22,18 @@ private:
   std::vector<Stmt> m_statements;
   std::vector<std::unordered_map<std::string, bool>> m_scopes;
 
-  Interpreter m_interpreter;
+  // The blocks and functions being resolved, innermost last, and whether a closure can keep their environment.
+  struct Frame {
+    std::size_t id;
+    bool captured;
+  };
+  std::vector<Frame> m_frames;
+
+  Resolution &m_resolution;
 
 public:
-  explicit Resolver(const Interpreter &interpreter);
+  explicit Resolver(Resolution &resolution);
+  explicit Resolver(Interpreter &interpreter);
   void resolve(const std::vector<Stmt> &statements);
 
   void resolve(const Stmt &stmt);
@@ -38,6 +47,7 @@ public:
   void operator()(const ReturnStmt &stmt);
   void operator()(const VariableStmt &stmt);
   void operator()(const WhileStmt &stmt);
+  void operator()(const YieldStmt &stmt);
 
   void resolve(const Expr &expr);
 
@@ -49,6 +59,8 @@ public:
   void operator()(const LiteralExpr &expr);
   void operator()(const LogicalExpr &expr);
   void operator()(const SetExpr &expr);
+  void operator()(const SuperExpr &expr);
+  void operator()(const ThisExpr &expr);
   void operator()(const UnaryExpr &expr);
   void operator()(const VariableExpr &expr);
 
@@ -61,8 +73,12 @@ private:
   void declare(const Token &name);
   void define(const Token &name);
 
-  void resolveLocal(const Expr &expr, const Token &name);
+  void resolveLocal(const Token &name);
   void resolveFunction(const FunctionStmt &function, const FunctionKind kind);
+
+  void beginFrame(const std::size_t id);
+  void endFrame();
+  void capture();
 };
 
 }
@@ -3,6 +3,7 @@
 #include <vector>
 #include <cstdint>
 #include <string>
+#include <string_view>
 
 #include "lox/primitives/token.h"
 
@@ -24,6 +25,8 @@ public:
 
 private:
   void addToken(const TokenKind kind, const Literal &literal = nullptr);
+  std::string_view lexeme() const;
+  double number(const bool isFractional) const;
 
   char peek() const;
   char peekNext() const;
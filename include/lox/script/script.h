@@ -0,0 +1,81 @@
+#pragma once
+
+#include "lox/callable/function/function.h"
+#include "lox/interpreter/interpreter.h"
+#include "lox/primitives/literal.h"
+#include "lox/program/program.h"
+
+#include <array>
+#include <concepts>
+#include <cstddef>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace lox {
+
+// Embeds a compiled Program in a C++ host. Loading a script runs its top level once, which defines its globals; the
+// global functions can then be looked up and called from C++ as often as needed, without compiling anything again.
+// Values cross the boundary as Literal (nil, booleans, numbers and strings). Runtime errors propagate as RuntimeError.
+//
+// A script is single threaded: it owns an Interpreter, whose globals persist from one call to the next.
+class Script {
+public:
+  class Function {
+  private:
+    Script *m_script;
+    lox::Function m_function;
+    Token m_name;
+
+  public:
+    Function(Script &script, const lox::Function &function, const Token &name);
+
+    std::size_t arity() const;
+
+    Literal call(std::span<const Literal> arguments) const;
+
+    // Converts each argument to a Literal: any arithmetic type becomes a number, character strings become strings.
+    template <class... Args>
+    Literal operator()(const Args &...arguments) const {
+      const std::array<Literal, sizeof...(Args)> literals{toLiteral(arguments)...};
+      return call(literals);
+    }
+
+  private:
+    static Literal toLiteral(const Literal &value) { return value; }
+    static Literal toLiteral(const bool value) { return value; }
+    static Literal toLiteral(const std::nullptr_t /*unused*/) { return nullptr; }
+    static Literal toLiteral(const std::string_view value) { return std::string(value); }
+    static Literal toLiteral(const char *value) { return std::string(value); }
+    static Literal toLiteral(const std::string &value) { return value; }
+
+    template <class T>
+      requires(std::is_arithmetic_v<T> && !std::same_as<T, bool>)
+    static Literal toLiteral(const T value) {
+      return static_cast<double>(value);
+    }
+  };
+
+private:
+  std::shared_ptr<const Program> m_program;
+  Interpreter m_interpreter;
+
+  // Reused by every call, to spare an allocation per call.
+  std::vector<std::any> m_arguments;
+
+public:
+  explicit Script(const std::shared_ptr<const Program> &program);
+
+  Script(const Script &) = delete;
+  Script &operator=(const Script &) = delete;
+
+  // Throws std::invalid_argument if the script defines no global function of that name.
+  Function function(const std::string &name);
+
+  Interpreter &interpreter();
+};
+
+}
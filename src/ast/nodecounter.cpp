@@ -0,0 +1,122 @@
+#include "lox/ast/nodecounter.h"
+
+namespace lox {
+
+void NodeCounter::count(const std::vector<Stmt> &statements) {
+  for (const Stmt &stmt : statements)
+    count(stmt);
+}
+
+void NodeCounter::count(const Stmt &stmt) {
+  if (stmt.which() == 0)
+    return;
+
+  ++m_statements;
+  boost::apply_visitor(*this, stmt);
+}
+
+void NodeCounter::count(const Expr &expr) {
+  if (expr.which() == 0)
+    return;
+
+  ++m_expressions;
+  boost::apply_visitor(*this, expr);
+}
+
+std::size_t NodeCounter::statements() const {
+  return m_statements;
+}
+
+std::size_t NodeCounter::expressions() const {
+  return m_expressions;
+}
+
+std::size_t NodeCounter::nodes() const {
+  return m_statements + m_expressions;
+}
+
+void NodeCounter::operator()(const BlockStmt &stmt) {
+  count(stmt.statements);
+}
+
+void NodeCounter::operator()(const ClassStmt &stmt) {
+  count(stmt.superClass);
+  for (const FunctionStmt &method : stmt.methods) {
+    ++m_statements;
+    (*this)(method);
+  }
+}
+
+void NodeCounter::operator()(const ExpressionStmt &stmt) {
+  count(stmt.expression);
+}
+
+void NodeCounter::operator()(const FunctionStmt &stmt) {
+  count(stmt.body);
+}
+
+void NodeCounter::operator()(const IfStmt &stmt) {
+  count(stmt.condition);
+  count(stmt.thenBranch);
+  count(stmt.elseBranch);
+}
+
+void NodeCounter::operator()(const PrintStmt &stmt) {
+  count(stmt.expression);
+}
+
+void NodeCounter::operator()(const ReturnStmt &stmt) {
+  count(stmt.value);
+}
+
+void NodeCounter::operator()(const VariableStmt &stmt) {
+  count(stmt.initializer);
+}
+
+void NodeCounter::operator()(const WhileStmt &stmt) {
+  count(stmt.condition);
+  count(stmt.body);
+}
+
+void NodeCounter::operator()(const YieldStmt &stmt) {
+  count(stmt.value);
+}
+
+void NodeCounter::operator()(const AssignExpr &expr) {
+  count(expr.value);
+}
+
+void NodeCounter::operator()(const BinaryExpr &expr) {
+  count(expr.left);
+  count(expr.right);
+}
+
+void NodeCounter::operator()(const CallExpr &expr) {
+  count(expr.callee);
+  for (const Expr &argument : expr.arguments)
+    count(argument);
+}
+
+void NodeCounter::operator()(const GetExpr &expr) {
+  count(expr.object);
+}
+
+void NodeCounter::operator()(const GroupingExpr &expr) {
+  count(expr.expression);
+}
+
+void NodeCounter::operator()(const LogicalExpr &expr) {
+  count(expr.left);
+  count(expr.right);
+}
+
+void NodeCounter::operator()(const SetExpr &expr) {
+  count(expr.object);
+  count(expr.value);
+}
+
+void NodeCounter::operator()(const UnaryExpr &expr) {
+  count(expr.right);
+}
+
+}
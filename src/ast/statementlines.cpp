@@ -0,0 +1,56 @@
+#include "lox/ast/statementlines.h"
+
+#include <boost/variant/apply_visitor.hpp>
+
+namespace lox {
+
+StatementLines::StatementLines(const std::vector<Stmt> &statements) {
+  add(statements);
+}
+
+const std::vector<std::size_t> &StatementLines::lines() const {
+  return m_lines;
+}
+
+void StatementLines::operator()(const BlockStmt &stmt) {
+  record(stmt.id, stmt.line);
+  add(stmt.statements);
+}
+
+void StatementLines::operator()(const ClassStmt &stmt) {
+  record(stmt.id, stmt.line);
+  for (const FunctionStmt &method : stmt.methods)
+    (*this)(method);
+}
+
+void StatementLines::operator()(const FunctionStmt &stmt) {
+  record(stmt.id, stmt.line);
+  add(stmt.body);
+}
+
+void StatementLines::operator()(const IfStmt &stmt) {
+  record(stmt.id, stmt.line);
+  boost::apply_visitor(*this, stmt.thenBranch);
+  boost::apply_visitor(*this, stmt.elseBranch);
+}
+
+void StatementLines::operator()(const WhileStmt &stmt) {
+  record(stmt.id, stmt.line);
+  boost::apply_visitor(*this, stmt.body);
+}
+
+void StatementLines::add(const std::vector<Stmt> &statements) {
+  for (const Stmt &stmt : statements)
+    boost::apply_visitor(*this, stmt);
+}
+
+void StatementLines::record(const std::size_t id, const std::size_t line) {
+  if (id == 0)
+    return;
+
+  if (id >= m_lines.size())
+    m_lines.resize(id + 1);
+  m_lines[id] = line;
+}
+
+}
@@ -52,8 +52,9 @@ std::string ASTPrinter::operator()(const ClassStmt &stmt) const {
   sout << '(';
   sout << "class ";
 
-  //  if (stmt.superClass.name.literal != nullptr)
-  //    sout << " < " + visit(stmt.superClass);
+  sout << stmt.name.lexeme;
+  if (stmt.superClass.which() != 0)
+    sout << " < " << visit(stmt.superClass);
 
   for (const FunctionStmt &method : stmt.methods)
     sout << ' ' << visit(method);
@@ -117,6 +118,17 @@ std::string ASTPrinter::operator()(const ReturnStmt &stmt) const {
   return sout.str();
 }
 
+std::string ASTPrinter::operator()(const YieldStmt &stmt) const {
+  if (stmt.value.which() == 0)
+    return "(yield)";
+
+  std::ostringstream sout;
+  sout << '(';
+  sout << "yield " << visit(stmt.value);
+  sout << ')';
+  return sout.str();
+}
+
 std::string ASTPrinter::operator()(const WhileStmt &stmt) const {
   std::ostringstream sout;
   sout << '(';
@@ -0,0 +1,193 @@
+#include "lox/batch/batch.h"
+#include "lox/batch/threadpool.h"
+#include "lox/concurrency/concurrency.h"
+#include "lox/error/error.h"
+#include "lox/interpreter/interpreter.h"
+#include "lox/program/program.h"
+
+#include <stdio.h> // open_memstream
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <exception>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <utility>
+
+namespace lox {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Collects everything written to a FILE in memory.
+class Capture {
+private:
+  char *m_buffer = nullptr;
+  std::size_t m_size = 0;
+  std::FILE *m_stream;
+
+public:
+  Capture()
+      : m_stream(open_memstream(&m_buffer, &m_size)) {}
+
+  ~Capture() {
+    if (m_stream != nullptr)
+      std::fclose(m_stream);
+    std::free(m_buffer);
+  }
+
+  Capture(const Capture &) = delete;
+  Capture &operator=(const Capture &) = delete;
+
+  std::FILE *stream() const {
+    return m_stream;
+  }
+
+  std::string take() {
+    std::fclose(m_stream);
+    m_stream = nullptr;
+    return std::string(m_buffer, m_size);
+  }
+};
+
+struct Result {
+  std::string output;
+  std::string errors;
+  bool failed = false;
+  std::chrono::nanoseconds load{};
+  std::chrono::nanoseconds compile{};
+  std::chrono::nanoseconds run{};
+};
+
+Result runScript(const std::filesystem::path &path, const Batch::Options &options) {
+  Result result;
+  Capture output;
+  Capture errors;
+
+  std::FILE *previousErrors = errorStream();
+  setErrorStream(errors.stream());
+  const std::size_t errorsBefore = reportedErrors();
+
+  const auto start = Clock::now();
+  std::ifstream fin(path);
+  std::string source;
+  if (fin.is_open())
+    source.assign(std::istreambuf_iterator<char>(fin), {});
+  const auto loaded = Clock::now();
+
+  std::shared_ptr<const Program> program;
+  if (!fin.is_open()) {
+    std::fprintf(errors.stream(), "%s: can't be read\n", path.c_str());
+    result.failed = true;
+  } else {
+    try {
+      program = Program::compile(source, Program::Options{options.optimize});
+    } catch (const CompileError &) {
+      result.failed = true;
+    }
+  }
+  const auto compiled = Clock::now();
+
+  // Whatever goes wrong in one script, the others still run.
+  if (program) {
+    try {
+      Interpreter interpreter{program, output.stream()};
+      const Concurrency concurrency{interpreter};
+      interpreter.interpret();
+    } catch (const std::exception &e) {
+      std::fprintf(errors.stream(), "%s: aborted: %s\n", path.c_str(), e.what());
+      result.failed = true;
+    }
+  }
+  const auto ran = Clock::now();
+
+  result.failed = result.failed || reportedErrors() != errorsBefore;
+  setErrorStream(previousErrors);
+
+  result.output = output.take();
+  result.errors = errors.take();
+  result.load = loaded - start;
+  result.compile = compiled - loaded;
+  result.run = ran - compiled;
+  return result;
+}
+
+}
+
+double Batch::Statistics::scriptsPerSecond() const {
+  const double seconds = std::chrono::duration<double>(wall).count();
+  return seconds == 0 ? 0 : static_cast<double>(scripts) / seconds;
+}
+
+Batch::Batch(std::vector<std::filesystem::path> scripts, const Options &options)
+    : m_scripts(std::move(scripts))
+    , m_options(options) {}
+
+std::vector<std::filesystem::path> Batch::collect(const std::filesystem::path &directoryOrList) {
+  std::vector<std::filesystem::path> scripts;
+
+  if (std::filesystem::is_directory(directoryOrList)) {
+    for (const auto &entry : std::filesystem::recursive_directory_iterator(directoryOrList)) {
+      if (entry.is_regular_file() && entry.path().extension() == ".lox")
+        scripts.push_back(entry.path());
+    }
+    std::sort(scripts.begin(), scripts.end());
+    return scripts;
+  }
+
+  std::ifstream list(directoryOrList);
+  for (std::string line; std::getline(list, line);) {
+    if (!line.empty())
+      scripts.emplace_back(line);
+  }
+  return scripts;
+}
+
+// Workers fill in the results in any order; this thread writes them out in script order as they become available.
+Batch::Statistics Batch::run(std::FILE *output, std::FILE *errors) const {
+  Statistics statistics;
+  statistics.scripts = m_scripts.size();
+
+  std::vector<Result> results(m_scripts.size());
+  std::vector<std::atomic<bool>> done(m_scripts.size());
+
+  const auto start = Clock::now();
+
+  ThreadPool pool(m_options.threads != 0 ? m_options.threads : std::thread::hardware_concurrency());
+  statistics.threads = pool.threads();
+
+  for (std::size_t i = 0; i < m_scripts.size(); i++) {
+    pool.submit([&, i] {
+      results[i] = runScript(m_scripts[i], m_options);
+      done[i] = true;
+      done[i].notify_one();
+    });
+  }
+
+  for (std::size_t i = 0; i < m_scripts.size(); i++) {
+    done[i].wait(false);
+    const Result result = std::move(results[i]);
+
+    std::fwrite(result.output.data(), sizeof(char), result.output.size(), output);
+    std::fwrite(result.errors.data(), sizeof(char), result.errors.size(), errors);
+
+    statistics.failed += result.failed ? 1 : 0;
+    statistics.load += result.load;
+    statistics.compile += result.compile;
+    statistics.run += result.run;
+  }
+
+  pool.wait();
+  statistics.steals = pool.steals();
+  statistics.wall = Clock::now() - start;
+
+  std::fflush(output);
+  std::fflush(errors);
+  return statistics;
+}
+
+}
@@ -0,0 +1,100 @@
+#include "lox/batch/threadpool.h"
+
+#include <algorithm>
+#include <mutex>
+#include <utility>
+
+namespace lox {
+
+ThreadPool::ThreadPool(const std::size_t threads) {
+  const std::size_t count = std::max<std::size_t>(threads, 1);
+
+  for (std::size_t i = 0; i < count; i++)
+    m_queues.push_back(std::make_unique<Queue>());
+
+  m_workers.reserve(count);
+  for (std::size_t i = 0; i < count; i++)
+    m_workers.emplace_back([this, i] { work(i); });
+}
+
+ThreadPool::~ThreadPool() {
+  m_stopping = true;
+  ++m_signals;
+  m_signals.notify_all();
+
+  for (std::thread &worker : m_workers)
+    worker.join();
+}
+
+// The task counts as pending before any worker can see it, so it can't finish before it has started.
+void ThreadPool::submit(Task task) {
+  ++m_pending;
+
+  Queue &queue = *m_queues[m_next++ % m_queues.size()];
+  {
+    std::lock_guard lock(queue.mutex);
+    queue.tasks.push_back(std::move(task));
+  }
+
+  ++m_signals;
+  m_signals.notify_one();
+}
+
+void ThreadPool::wait() {
+  for (std::size_t pending = m_pending; pending != 0; pending = m_pending)
+    m_pending.wait(pending);
+}
+
+std::size_t ThreadPool::threads() const {
+  return m_workers.size();
+}
+
+std::size_t ThreadPool::steals() const {
+  return m_steals;
+}
+
+// A worker reads the signal count before it looks for work: if a task is queued after the search came up empty, the
+// count has moved on and the wait returns at once.
+void ThreadPool::work(const std::size_t index) {
+  for (;;) {
+    const std::uint64_t signals = m_signals;
+
+    if (std::optional<Task> task = take(index)) {
+      (*task)();
+
+      if (--m_pending == 0)
+        m_pending.notify_all();
+      continue;
+    }
+
+    if (m_stopping)
+      return;
+
+    m_signals.wait(signals);
+  }
+}
+
+std::optional<ThreadPool::Task> ThreadPool::take(const std::size_t index) {
+  for (std::size_t i = 0; i < m_queues.size(); i++) {
+    Queue &queue = *m_queues[(index + i) % m_queues.size()];
+    std::lock_guard lock(queue.mutex);
+    if (queue.tasks.empty())
+      continue;
+
+    Task task;
+    if (i == 0) {
+      task = std::move(queue.tasks.front());
+      queue.tasks.pop_front();
+    } else {
+      task = std::move(queue.tasks.back());
+      queue.tasks.pop_back();
+      ++m_steals;
+    }
+
+    return task;
+  }
+
+  return std::nullopt;
+}
+
+}
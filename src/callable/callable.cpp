@@ -26,11 +26,15 @@ Callable::Callable(const Class &klass)
 Callable::Callable(const Function &function)
     : m_callable(function) {}
 
-std::any Callable::call(const Interpreter &interpreter, const std::vector<Literal> &arguments) const {
+Callable::Callable(const Native &native)
+    : m_callable(native) {}
+
+std::any Callable::call(const Interpreter &interpreter, const std::vector<std::any> &arguments) const {
   return std::visit(overload{
                         [&](const std::monostate) { return std::any{}; },                               //
                         [&](const Class &klass) { return klass.call(interpreter, arguments); },         //
-                        [&](const Function &function) { return function.call(interpreter, arguments); } //
+                        [&](const Function &function) { return function.call(interpreter, arguments); }, //
+                        [&](const Native &native) { return native.call(arguments); }                    //
                     },
                     m_callable);
 }
@@ -39,16 +43,22 @@ std::size_t Callable::arity() const {
   return std::visit(overload{
                         [&](const std::monostate) { return std::size_t{0}; },      //
                         [&](const Class &klass) { return klass.arity(); },         //
-                        [&](const Function &function) { return function.arity(); } //
+                        [&](const Function &function) { return function.arity(); }, //
+                        [&](const Native &native) { return native.arity(); }        //
                     },
                     m_callable);
 }
 
+const Function *Callable::function() const {
+  return std::get_if<Function>(&m_callable);
+}
+
 Callable::operator std::string() const {
   return std::visit(overload{
                         [&](const std::monostate) { return std::string{}; },            //
                         [&](const Class &klass) { return std::string(klass); },         //
-                        [&](const Function &function) { return std::string(function); } //
+                        [&](const Function &function) { return std::string(function); }, //
+                        [&](const Native &native) { return std::string(native); }         //
                     },
                     m_callable);
 }
@@ -2,36 +2,66 @@
 #include "lox/callable/class/class.h"
 #include "lox/callable/class/instance.h"
 #include "lox/interpreter/interpreter.h"
+#include "lox/memory/memory.h"
 
 #include <string>
 #include <vector>
 #include <any>
+#include <memory>
 
 namespace lox {
 
-Class::Class(const std::string &name, const std::unordered_map<std::string, Function> &methods)
+Class::Class(const std::string &name, const std::optional<Class> &superclass,
+             const std::unordered_map<std::string, Function> &methods)
     : m_name(name)
-    , m_methods(methods) {}
+    , m_superclass(superclass ? std::make_shared<const Class>(*superclass) : nullptr)
+    , m_methods(std::make_shared<const std::unordered_map<std::string, Function>>(methods)) {}
 
 std::optional<Function> Class::findMethod(const std::string &name) const {
-  if (m_methods.contains(name))
-    return m_methods.find(name)->second;
+  if (const auto it = m_methods->find(name); it != m_methods->end())
+    return it->second;
+
+  if (m_superclass)
+    return m_superclass->findMethod(name);
+
   return std::nullopt;
 }
 
-std::any Class::call(const Interpreter &interpreter, const std::vector<Literal> &arguments) const {
-  (void)interpreter;
-  (void)arguments;
+std::any Class::call(const Interpreter &interpreter, const std::vector<std::any> &arguments) const {
+  auto instance = memory::makeShared<Instance>(memory::Tag::Objects, *this, &interpreter.instances());
+  if (Tracer *tracer = interpreter.tracer())
+    tracer->allocation(Tracer::Allocation::Instance);
+
+  if (const auto initializer = findMethod("init"))
+    initializer->bind(instance).call(interpreter, arguments);
 
-  return Instance{*this};
+  return instance;
 }
 
 std::size_t Class::arity() const {
+  if (const auto initializer = findMethod("init"))
+    return initializer->arity();
   return 0;
 }
 
+const std::string &Class::name() const {
+  return m_name;
+}
+
+const std::unordered_map<std::string, Function> &Class::methods() const {
+  return *m_methods;
+}
+
+const Class *Class::superclass() const {
+  return m_superclass.get();
+}
+
 Class::operator std::string() const {
   return m_name;
 }
 
+bool Class::operator==(const Class &other) const {
+  return m_methods == other.m_methods;
+}
+
 }
@@ -6,25 +6,69 @@
 
 namespace lox {
 
-Instance::Instance(const Class &klass)
-    : m_klass(klass){};
+Instance::Instance(const Class &klass, InstanceRegistry *registry)
+    : m_klass(klass)
+    , m_registry(registry) {
+  if (m_registry == nullptr)
+    return;
+
+  m_next = m_registry->m_first;
+  if (m_next != nullptr)
+    m_next->m_previous = this;
+  m_registry->m_first = this;
+  ++m_registry->m_size;
+}
+
+Instance::~Instance() {
+  if (m_registry == nullptr)
+    return;
+
+  (m_previous != nullptr ? m_previous->m_next : m_registry->m_first) = m_next;
+  if (m_next != nullptr)
+    m_next->m_previous = m_previous;
+  --m_registry->m_size;
+}
 
 std::any Instance::get(const Token &name) {
-  if (m_fields.contains(name.lexeme))
-    return m_fields.find(name.lexeme)->second;
+  if (const auto it = m_fields.find(name.lexeme); it != m_fields.end())
+    return it->second;
 
   if (const auto method = m_klass.findMethod(name.lexeme))
-    return *method;
+    return method->bind(shared_from_this());
 
   throw RuntimeError(name, std::string("Undefined property '").append(name.lexeme).append("'."));
 }
 
 void Instance::set(const Token &name, const std::any &val) {
+  const memory::Scope scope{memory::Tag::Objects};
   m_fields[name.lexeme] = val;
 }
 
+void Instance::clearFields() {
+  m_fields.clear();
+}
+
+const Class &Instance::klass() const {
+  return m_klass;
+}
+
+const std::pmr::unordered_map<std::string, std::any> &Instance::fields() const {
+  return m_fields;
+}
+
 Instance::operator std::string() const {
   return std::string(m_klass).append(" instance");
 }
 
+InstanceRegistry::~InstanceRegistry() {
+  for (Instance *instance = m_first; instance != nullptr; instance = instance->m_next) {
+    instance->m_registry = nullptr;
+    instance->m_previous = nullptr;
+  }
+}
+
+std::size_t InstanceRegistry::size() const {
+  return m_size;
+}
+
 }
@@ -1,39 +1,119 @@
 #include "lox/callable/function/function.h"
-#include "lox/callable/function/return.h"
 #include "lox/environment/environment.h"
 #include "lox/interpreter/interpreter.h"
+#include "lox/jit/jit.h"
+#include "lox/memory/memory.h"
 
 #include <vector>
 #include <memory>
 #include <any>
+#include <optional>
 
 namespace lox {
 
-Function::Function(const FunctionStmt &declaration, const Environment &closure)
-    : m_declaration(declaration)
-    , m_closure(closure) {}
+namespace {
+const Token thisToken{TokenKind::This, "this", nullptr, 0};
+}
+
+// The declaration is referenced, not copied: the resolver binds locals to the tokens of the parsed tree, so the body
+// executed here has to be that very tree.
+Function::Function(const FunctionStmt &declaration, const std::shared_ptr<Environment> &closure, const bool isInitializer)
+    : m_declaration(&declaration)
+    , m_closure(closure)
+    , m_isInitializer(isInitializer) {}
 
-std::any Function::call(const Interpreter &interpreter, const std::vector<Literal> &arguments) const {
-  auto environment = m_closure;
+std::any Function::call(const Interpreter &interpreter, const std::vector<std::any> &arguments) const {
+  std::any result = invoke(interpreter, arguments);
 
-  for (std::size_t i = 0; i < m_declaration.params.size(); i++) {
-    environment.define(m_declaration.params[i], arguments[i]);
+  while (result.type() == typeid(TailCall)) {
+    const TailCall next = std::any_cast<TailCall &&>(std::move(result));
+    result = next.function.invoke(interpreter, next.arguments);
   }
-  try {
-    interpreter.statementVisitor().executeBlock(m_declaration.body, environment);
-  } catch (const Return &ret) {
-    return std::any_cast<Literal>(ret.value());
+
+  return result;
+}
+
+std::any Function::invoke(const Interpreter &interpreter, const std::vector<std::any> &arguments) const {
+  if (m_declaration->isCoroutine)
+    return interpreter.statementVisitor().coroutine(*this, arguments);
+
+  interpreter.statementVisitor().checkpoint(m_declaration->name);
+  const CallStack::Scope frame{interpreter.callStack(), m_declaration};
+  const Tracer::Span span{interpreter.tracer(), m_declaration->name.lexeme, Tracer::Category::Call};
+  if (Interpreter::Counters *counters = interpreter.counters())
+    ++counters->calls;
+
+  if (Jit *jit = interpreter.jit(); jit != nullptr && !interpreter.budget().isLimited() && isGlobal(interpreter)) {
+    if (const std::optional<double> result = jit->call(*m_declaration, arguments))
+      return Literal{*result};
   }
 
-  return nullptr;
+  std::any result = interpreter.statementVisitor().executeCall(*this, arguments);
+  return m_isInitializer ? instance() : result;
+}
+
+// Compiled code calls itself directly instead of looking its name up, which is only right while the name still refers
+// to this declaration.
+bool Function::isGlobal(const Interpreter &interpreter) const {
+  if (m_closure != interpreter.globals())
+    return false;
+
+  const std::any *value = m_closure->find(m_declaration->name);
+  const auto *bound = value == nullptr ? nullptr : std::any_cast<Function>(value);
+  return bound != nullptr && bound->m_declaration == m_declaration;
 }
 
 std::size_t Function::arity() const {
-  return m_declaration.params.size();
+  return m_declaration->params.size();
 }
 
 Function::operator std::string() const {
-  return std::string("<fn ").append(m_declaration.name.lexeme).append(">");
+  return std::string("<fn ").append(m_declaration->name.lexeme).append(">");
+}
+
+const FunctionStmt &Function::declaration() const {
+  return *m_declaration;
+}
+
+const std::shared_ptr<Environment> &Function::closure() const {
+  return m_closure;
+}
+
+const std::vector<Stmt> &Function::body() const {
+  return m_declaration->body;
+}
+
+// The environment a call runs in: the closure, extended with the parameters.
+std::shared_ptr<Environment> Function::environment(const std::vector<std::any> &arguments) const {
+  auto environment = memory::makeShared<Environment>(memory::Tag::Environments, m_closure);
+
+  for (std::size_t i = 0; i < m_declaration->params.size(); i++) {
+    environment->define(m_declaration->params[i], arguments[i]);
+  }
+
+  return environment;
+}
+
+Function Function::bind(const std::shared_ptr<Instance> &instance) const {
+  auto environment = memory::makeShared<Environment>(memory::Tag::Environments, m_closure);
+  environment->define(thisToken, instance);
+  return Function{*m_declaration, environment, m_isInitializer};
+}
+
+bool Function::isCoroutine() const {
+  return m_declaration->isCoroutine;
+}
+
+bool Function::isInitializer() const {
+  return m_isInitializer;
+}
+
+std::any Function::instance() const {
+  return m_closure->getAt(thisToken, 0);
+}
+
+bool Function::operator==(const Function &other) const {
+  return m_declaration == other.m_declaration && m_closure == other.m_closure;
 }
 
 }
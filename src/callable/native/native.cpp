@@ -0,0 +1,42 @@
+#include "lox/callable/native/native.h"
+
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace lox {
+
+Native::Native(const std::string &name, const std::size_t arity, Callback callback) {
+  if (arity > maxArity && arity != variadic)
+    throw std::invalid_argument(std::string("native function '").append(name).append("' takes too many parameters"));
+  if (!callback)
+    throw std::invalid_argument(std::string("native function '").append(name).append("' has no callback"));
+
+  m_definition = std::make_shared<const Definition>(Definition{name, arity, std::move(callback)});
+}
+
+std::any Native::call(std::span<const std::any> arguments) const {
+  return m_definition->callback(arguments);
+}
+
+std::size_t Native::arity() const {
+  return m_definition->arity;
+}
+
+bool Native::isVariadic() const {
+  return m_definition->arity == variadic;
+}
+
+const std::string &Native::name() const {
+  return m_definition->name;
+}
+
+Native::operator std::string() const {
+  return "<native fn>";
+}
+
+bool Native::operator==(const Native &other) const {
+  return m_definition == other.m_definition;
+}
+
+}
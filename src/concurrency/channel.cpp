@@ -0,0 +1,79 @@
+#include "lox/concurrency/channel.h"
+
+#include <mutex>
+#include <optional>
+#include <string>
+#include <utility>
+
+namespace lox {
+
+Channel::Channel(const std::size_t capacity)
+    : m_capacity(capacity) {}
+
+// The version is read before looking at the queue: whatever changes it afterwards also changes the version, so the wait
+// can't miss it.
+bool Channel::send(Message message) {
+  for (;;) {
+    const std::uint64_t seen = m_version.load();
+    const Attempt attempt = trySend(message);
+    if (attempt != Attempt::WouldWait)
+      return attempt == Attempt::Done;
+
+    m_version.wait(seen);
+  }
+}
+
+std::optional<Message> Channel::receive() {
+  std::optional<Message> message;
+  for (;;) {
+    const std::uint64_t seen = m_version.load();
+    if (tryReceive(message) != Attempt::WouldWait)
+      return message;
+
+    m_version.wait(seen);
+  }
+}
+
+Channel::Attempt Channel::trySend(Message &message) {
+  const std::lock_guard lock{m_mutex};
+  if (m_closed)
+    return Attempt::Closed;
+  if (m_messages.size() >= m_capacity)
+    return Attempt::WouldWait;
+
+  m_messages.push_back(std::move(message));
+  changed();
+  return Attempt::Done;
+}
+
+Channel::Attempt Channel::tryReceive(std::optional<Message> &message) {
+  const std::lock_guard lock{m_mutex};
+  if (m_messages.empty())
+    return m_closed ? Attempt::Closed : Attempt::WouldWait;
+
+  message = std::move(m_messages.front());
+  m_messages.pop_front();
+  changed();
+  return Attempt::Done;
+}
+
+void Channel::close() {
+  const std::lock_guard lock{m_mutex};
+  m_closed = true;
+  changed();
+}
+
+std::size_t Channel::capacity() const {
+  return m_capacity;
+}
+
+Channel::operator std::string() const {
+  return "<channel>";
+}
+
+void Channel::changed() {
+  ++m_version;
+  m_version.notify_all();
+}
+
+}
@@ -0,0 +1,184 @@
+#include "lox/concurrency/concurrency.h"
+#include "lox/callable/function/function.h"
+#include "lox/callable/native/native.h"
+#include "lox/concurrency/channel.h"
+#include "lox/concurrency/message.h"
+#include "lox/error/error.h"
+#include "lox/interpreter/coroutine.h"
+#include "lox/interpreter/interpreter.h"
+
+#include <boost/variant/get.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <mutex>
+#include <span>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace lox {
+
+struct Concurrency::Threads {
+  std::mutex mutex;
+  std::vector<std::thread> threads;
+
+  ~Threads() {
+    join();
+  }
+
+  void start(std::thread thread) {
+    const std::lock_guard lock{mutex};
+    threads.push_back(std::move(thread));
+  }
+
+  void join() {
+    std::vector<std::thread> joining;
+    {
+      const std::lock_guard lock{mutex};
+      joining.swap(threads);
+    }
+
+    for (std::thread &thread : joining)
+      thread.join();
+  }
+};
+
+namespace {
+
+std::shared_ptr<Channel> channel(const std::any &value) {
+  const auto *channel = std::any_cast<std::shared_ptr<Channel>>(&value);
+  if (channel == nullptr)
+    throw NativeError("Expected a channel.");
+
+  return *channel;
+}
+
+bool isTopLevel(const Interpreter &interpreter, const FunctionStmt &declaration) {
+  const auto &statements = interpreter.statements();
+  return std::any_of(begin(statements), end(statements),
+                     [&](const Stmt &statement) { return boost::get<FunctionStmt>(&statement) == &declaration; });
+}
+
+// The body of a spawned thread. The isolate starts out with the top-level declarations of the program, so the
+// function finds the functions and classes it uses, but none of the global variables of its spawner.
+void runTask(Interpreter &isolate, const FunctionStmt &declaration, const std::vector<Message> &arguments, Channel &result) {
+  {
+    Concurrency concurrency{isolate};
+    if (Tracer *tracer = isolate.tracer())
+      tracer->nameThread("spawn " + declaration.name.lexeme);
+
+    try {
+      isolate.declare();
+
+      std::vector<std::any> values;
+      values.reserve(arguments.size());
+      for (const Message &argument : arguments)
+        values.push_back(argument.unpack(*isolate.globals(), &isolate.instances()));
+
+      const Function function{declaration, isolate.globals()};
+      const std::any value = function.call(isolate, values);
+
+      isolate.output().flush();
+      result.send(Message::pack(value));
+    } catch (const RuntimeError &e) {
+      isolate.output().flush();
+      runtimeError(e);
+    } catch (const NativeError &e) {
+      isolate.output().flush();
+      runtimeError(RuntimeError(declaration.name, e.what()));
+    }
+  }
+
+  result.close();
+}
+
+}
+
+Concurrency::Concurrency(Interpreter &interpreter)
+    : m_threads(std::make_shared<Threads>()) {
+  Interpreter *const self = &interpreter;
+
+  interpreter.defineNative("spawn", Native::variadic, [self, threads = m_threads](std::span<const std::any> arguments) -> std::any {
+    const auto *function = arguments.empty() ? nullptr : std::any_cast<Function>(&arguments.front());
+    if (function == nullptr)
+      throw NativeError("Can only spawn functions.");
+    if (!isTopLevel(*self, function->declaration()))
+      throw NativeError("Can only spawn functions declared at the top level.");
+    if (function->arity() != arguments.size() - 1)
+      throw NativeError(std::string("Expected [")
+                            .append(std::to_string(function->arity()))     //
+                            .append("] arguments but got ")               //
+                            .append(std::to_string(arguments.size() - 1)) //
+                            .append("."));
+
+    std::vector<Message> messages;
+    messages.reserve(arguments.size() - 1);
+    for (const std::any &argument : arguments.subspan(1))
+      messages.push_back(Message::pack(argument));
+
+    auto result = std::make_shared<Channel>(1);
+    self->output().flush();
+
+    threads->start(std::thread([isolate = self->isolate(), &declaration = function->declaration(),
+                                messages = std::move(messages), result, errors = errorStream()] {
+      setErrorStream(errors);
+      runTask(*isolate, declaration, messages, *result);
+    }));
+
+    return result;
+  });
+
+  interpreter.defineNative("channel", 1, [](std::span<const std::any> arguments) -> std::any {
+    const auto *literal = std::any_cast<Literal>(&arguments[0]);
+    const auto *capacity = literal == nullptr ? nullptr : std::get_if<double>(&literal->data());
+    if (capacity == nullptr || *capacity < 1 || *capacity != std::floor(*capacity))
+      throw NativeError("Channel capacity must be a positive integer.");
+
+    return std::make_shared<Channel>(static_cast<std::size_t>(*capacity));
+  });
+
+  interpreter.defineNative("send", 2, [self](std::span<const std::any> arguments) -> std::any {
+    const std::shared_ptr<Channel> target = channel(arguments[0]);
+    Message message = Message::pack(arguments[1]);
+
+    self->output().flush();
+    if (self->coroutine() != nullptr) {
+      const Channel::Attempt attempt = target->trySend(message);
+      if (attempt == Channel::Attempt::WouldWait)
+        return Parked{};
+      if (attempt == Channel::Attempt::Closed)
+        throw NativeError("Can't send on a closed channel.");
+    } else if (!target->send(std::move(message))) {
+      throw NativeError("Can't send on a closed channel.");
+    }
+
+    return Literal{nullptr};
+  });
+
+  interpreter.defineNative("receive", 1, [self](std::span<const std::any> arguments) -> std::any {
+    const std::shared_ptr<Channel> source = channel(arguments[0]);
+
+    self->output().flush();
+    std::optional<Message> message;
+    if (self->coroutine() == nullptr)
+      message = source->receive();
+    else if (source->tryReceive(message) == Channel::Attempt::WouldWait)
+      return Parked{};
+
+    return message ? message->unpack(*self->globals(), &self->instances()) : Literal{nullptr};
+  });
+
+  interpreter.defineNative("close", 1, [](std::span<const std::any> arguments) -> std::any {
+    channel(arguments[0])->close();
+    return Literal{nullptr};
+  });
+}
+
+Concurrency::~Concurrency() {
+  m_threads->join();
+}
+
+}
@@ -0,0 +1,86 @@
+#include "lox/concurrency/message.h"
+#include "lox/callable/class/class.h"
+#include "lox/callable/class/instance.h"
+#include "lox/callable/native/native.h"
+#include "lox/concurrency/channel.h"
+#include "lox/primitives/token.h"
+#include "lox/memory/memory.h"
+
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+namespace lox {
+
+// Instances are numbered the first time they are met, so a second reference, or a cycle, becomes the same index.
+Message Message::pack(const std::any &value) {
+  Message message;
+
+  if (const auto *literal = std::any_cast<Literal>(&value)) {
+    message.m_value = *literal;
+    return message;
+  }
+
+  std::unordered_map<const Instance *, std::size_t> indices;
+  std::vector<const Instance *> instances;
+
+  const auto convert = [&](const std::any &any) -> Value {
+    if (const auto *literal = std::any_cast<Literal>(&any))
+      return *literal;
+    if (const auto *channel = std::any_cast<std::shared_ptr<Channel>>(&any))
+      return *channel;
+    if (const auto *instance = std::any_cast<std::shared_ptr<Instance>>(&any)) {
+      const auto [it, inserted] = indices.try_emplace(instance->get(), instances.size());
+      if (inserted)
+        instances.push_back(instance->get());
+      return it->second;
+    }
+
+    throw NativeError("Can only send nil, booleans, numbers, strings, channels and instances.");
+  };
+
+  message.m_value = convert(value);
+
+  // Converting the fields of an object may number more objects, which are then converted in turn.
+  for (std::size_t i = 0; i < instances.size(); ++i) {
+    Object object{instances[i]->klass().name(), {}};
+    object.fields.reserve(instances[i]->fields().size());
+    for (const auto &[name, field] : instances[i]->fields())
+      object.fields.emplace_back(name, convert(field));
+
+    message.m_objects.push_back(std::move(object));
+  }
+
+  return message;
+}
+
+std::any Message::unpack(const Environment &globals, InstanceRegistry *registry) const {
+  std::vector<std::shared_ptr<Instance>> instances;
+  instances.reserve(m_objects.size());
+
+  for (const Object &object : m_objects) {
+    const std::any *value = globals.find(Token{TokenKind::Identifier, object.klass, nullptr, 0});
+    const auto *klass = value == nullptr ? nullptr : std::any_cast<Class>(value);
+    if (klass == nullptr)
+      throw NativeError(std::string("Can't receive an instance of '").append(object.klass).append("' without a global class of that name."));
+
+    instances.push_back(memory::makeShared<Instance>(memory::Tag::Objects, *klass, registry));
+  }
+
+  const auto convert = [&](const Value &value) -> std::any {
+    if (const auto *literal = std::get_if<Literal>(&value))
+      return *literal;
+    if (const auto *channel = std::get_if<std::shared_ptr<Channel>>(&value))
+      return *channel;
+    return instances[std::get<std::size_t>(value)];
+  };
+
+  for (std::size_t i = 0; i < m_objects.size(); ++i) {
+    for (const auto &[name, field] : m_objects[i].fields)
+      instances[i]->set(Token{TokenKind::Identifier, name, nullptr, 0}, convert(field));
+  }
+
+  return convert(m_value);
+}
+
+}
@@ -13,7 +13,18 @@ namespace lox {
 Environment::Environment(const std::shared_ptr<Environment> &enclosing)
     : m_enclosing(enclosing) {}
 
+Environment::Environment(const std::shared_ptr<Environment> &enclosing, std::pmr::memory_resource *resource)
+    : m_values(resource)
+    , m_enclosing(enclosing) {}
+
+void Environment::clear() {
+  m_values.clear();
+}
+
+// The values are charged to the environments too, for the copies of literals and functions that don't fit in a
+// std::any.
 void Environment::define(const Token &token, const std::any &value) {
+  const memory::Scope scope{memory::Tag::Environments};
   m_values[token.lexeme] = value;
 }
 
@@ -33,7 +44,25 @@ std::any Environment::getAt(const Token &token, const std::size_t distance) cons
   return ancestor(distance)->get(token);
 }
 
+// Like getAt(), without copying the value out.
+const std::any &Environment::at(const Token &token, const std::size_t distance) const {
+  const Environment *environment = ancestor(distance);
+
+  if (const auto it = environment->m_values.find(token.lexeme); it != environment->m_values.end()) {
+    return it->second;
+  }
+
+  throw RuntimeError{token, std::string("Undefined variable '").append(token.lexeme).append("'.")};
+}
+
+// Looks in this environment only and reports a missing name with nullptr instead of an error.
+const std::any *Environment::find(const Token &token) const {
+  const auto it = m_values.find(token.lexeme);
+  return it == m_values.end() ? nullptr : &it->second;
+}
+
 void Environment::assign(const Token &token, const std::any &value) {
+  const memory::Scope scope{memory::Tag::Environments};
   if (const auto lexeme = token.lexeme; m_values.contains(lexeme)) {
     m_values[lexeme] = value;
     return;
@@ -48,27 +77,38 @@ void Environment::assign(const Token &token, const std::any &value) {
 }
 
 void Environment::assignAt(const Token &token, const std::size_t distance, const std::any &value) {
-  ancestor(distance)->m_values[std::string(token.literal)] = value;
+  const memory::Scope scope{memory::Tag::Environments};
+  ancestor(distance)->m_values[token.lexeme] = value;
 }
 
 bool Environment::isGlobalEnvironment() const {
   return m_enclosing == nullptr;
 }
 
-std::shared_ptr<Environment> Environment::ancestor(const std::size_t distance) {
-  auto environment = this->shared_from_this();
+// The walk goes through raw pointers: copying the shared pointers would touch a reference count at every step, which
+// is an atomic operation as soon as the process has a second thread.
+Environment *Environment::ancestor(const std::size_t distance) {
+  Environment *environment = this;
   for (std::size_t i = 0; i < distance; i++) {
-    environment = environment->m_enclosing;
+    environment = environment->m_enclosing.get();
   }
   return environment;
 }
 
-std::shared_ptr<const Environment> Environment::ancestor(const std::size_t distance) const {
-  auto environment = this->shared_from_this();
+const Environment *Environment::ancestor(const std::size_t distance) const {
+  const Environment *environment = this;
   for (std::size_t i = 0; i < distance; i++) {
-    environment = environment->m_enclosing;
+    environment = environment->m_enclosing.get();
   }
   return environment;
 }
 
+const std::pmr::unordered_map<std::string, std::any> &Environment::values() const {
+  return m_values;
+}
+
+const std::shared_ptr<Environment> &Environment::enclosing() const {
+  return m_enclosing;
+}
+
 }
@@ -9,15 +9,22 @@
 
 namespace lox {
 
+namespace {
+thread_local std::size_t errorCount = 0;
+thread_local std::FILE *stream = stderr;
+}
+
 void report(const std::size_t line, const std::string_view message) {
+  ++errorCount;
   const std::string line_message = fmt::format(fmt::emphasis::bold | fg(fmt::color::red), "[line {}]:", line);
-  fmt::print(stderr, fg(fmt::color::red), "{0} Error: {1}\n", line_message, message);
+  fmt::print(stream, fg(fmt::color::red), "{0} Error: {1}\n", line_message, message);
 }
 
 void report(const std::size_t line, const std::string_view where, const std::string_view message) {
+  ++errorCount;
   const std::string line_message = fmt::format(fmt::emphasis::bold | fg(fmt::color::red), "[line {}]:", line);
   const std::string where_message = fmt::format(fmt::emphasis::bold | fg(fmt::color::ghost_white), "{}", where);
-  fmt::print(stderr, fg(fmt::color::red), "{0} Error at `{1}`: {2}\n", line_message, where_message, message);
+  fmt::print(stream, fg(fmt::color::red), "{0} Error at `{1}`: {2}\n", line_message, where_message, message);
 }
 
 void error(const std::size_t line, const std::string_view message) {
@@ -38,6 +45,18 @@ void runtimeError(const RuntimeError &error) {
   report(error.token().line, error.what());
 }
 
+std::size_t reportedErrors() {
+  return errorCount;
+}
+
+std::FILE *errorStream() {
+  return stream;
+}
+
+void setErrorStream(std::FILE *errors) {
+  stream = errors;
+}
+
 const char *RuntimeError::what() const noexcept {
   return m_error_msg.c_str();
 }
@@ -0,0 +1,107 @@
+#include "lox/interpreter/coroutine.h"
+#include "lox/callable/native/native.h"
+#include "lox/interpreter/interpreter.h"
+
+#include <thread>
+#include <utility>
+
+namespace lox {
+
+Coroutine::Coroutine(Interpreter &interpreter, const Function &function, const std::vector<std::any> &arguments)
+    : m_interpreter(interpreter)
+    , m_machine(interpreter)
+    , m_declaration(&function.declaration())
+    , m_environment(function.environment(arguments)) {
+  m_machine.start(function);
+}
+
+// The machine runs in the interpreter's current environment, so the coroutine swaps its own in for as long as it runs.
+std::any Coroutine::resume() {
+  if (m_state == State::Running)
+    throw NativeError("Can't resume a running coroutine.");
+  if (m_state == State::Done)
+    throw NativeError("Can't resume a finished coroutine.");
+
+  m_state = State::Running;
+  const CallStack::Scope frame{m_interpreter.callStack(), m_declaration};
+  std::shared_ptr<Environment> resumer = std::exchange(m_interpreter.m_environment, std::move(m_environment));
+  const Interpreter::SavedEnvironment saved{m_interpreter, resumer};
+  const Coroutine *outer = std::exchange(m_interpreter.m_coroutine, this);
+
+  bool suspended = false;
+  try {
+    suspended = m_machine.resume();
+  } catch (...) {
+    m_state = State::Done;
+    m_interpreter.m_coroutine = outer;
+    m_interpreter.m_environment = std::move(resumer);
+    throw;
+  }
+
+  m_interpreter.m_coroutine = outer;
+  m_environment = std::exchange(m_interpreter.m_environment, std::move(resumer));
+  m_state = suspended ? State::Suspended : State::Done;
+  return m_machine.take();
+}
+
+Coroutine::State Coroutine::state() const {
+  return m_state;
+}
+
+bool Coroutine::isParked() const {
+  return m_state == State::Suspended && m_machine.isParked();
+}
+
+Coroutine::operator std::string() const {
+  return "<coroutine>";
+}
+
+void Coroutine::environments(std::vector<const Environment *> &roots) const {
+  if (m_environment != nullptr)
+    roots.push_back(m_environment.get());
+  m_machine.environments(roots);
+}
+
+void Scheduler::schedule(std::shared_ptr<Coroutine> coroutine) {
+  m_ready.push_back(std::move(coroutine));
+}
+
+void Scheduler::clear() {
+  m_ready.clear();
+}
+
+void Scheduler::run() {
+  std::size_t parked = 0; // in a row
+  while (!m_ready.empty()) {
+    std::shared_ptr<Coroutine> coroutine = std::move(m_ready.front());
+    m_ready.pop_front();
+
+    if (coroutine->state() != Coroutine::State::Suspended) // scheduled twice, or resumed to its end elsewhere
+      continue;
+
+    ++m_switches;
+    coroutine->resume();
+    parked = coroutine->isParked() ? parked + 1 : 0;
+    if (coroutine->state() == Coroutine::State::Suspended)
+      m_ready.push_back(std::move(coroutine));
+
+    if (parked != 0 && parked >= m_ready.size()) {
+      std::this_thread::yield();
+      parked = 0;
+    }
+  }
+}
+
+std::size_t Scheduler::scheduled() const {
+  return m_ready.size();
+}
+
+const std::deque<std::shared_ptr<Coroutine>> &Scheduler::ready() const {
+  return m_ready;
+}
+
+std::size_t Scheduler::switches() const {
+  return m_switches;
+}
+
+}
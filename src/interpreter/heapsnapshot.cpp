@@ -0,0 +1,268 @@
+#include "lox/interpreter/heapsnapshot.h"
+
+#include "lox/callable/class/class.h"
+#include "lox/callable/class/instance.h"
+#include "lox/callable/function/function.h"
+#include "lox/callable/native/native.h"
+#include "lox/environment/environment.h"
+#include "lox/interpreter/coroutine.h"
+#include "lox/primitives/literal.h"
+
+#include <algorithm>
+#include <any>
+#include <array>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string_view>
+#include <type_traits>
+#include <unordered_set>
+#include <variant>
+
+namespace lox {
+
+namespace {
+constexpr std::string_view header = "lox heap snapshot 1";
+constexpr std::array<const char *, 5> kindNames{"instance", "class", "function", "string", "environment"};
+
+// What allocate_shared adds to the object: the reference counts and the allocator.
+constexpr std::size_t sharedOverhead = 3 * sizeof(void *);
+
+// Text that doesn't fit in the string itself (15 characters with libstdc++) takes a block of its own.
+std::size_t textBytes(const std::string &text) {
+  return text.capacity() > 15 ? text.capacity() + 1 : 0;
+}
+
+// A std::any keeps what is bigger than a pointer in a block of its own.
+template <class T>
+constexpr std::size_t boxed() {
+  return sizeof(T) > sizeof(void *) ? sizeof(T) : 0;
+}
+
+std::size_t boxBytes(const std::any &value) {
+  if (value.type() == typeid(Literal))
+    return boxed<Literal>();
+  if (value.type() == typeid(Function))
+    return boxed<Function>();
+  if (value.type() == typeid(Class))
+    return boxed<Class>();
+  if (value.type() == typeid(Native))
+    return boxed<Native>();
+  return boxed<std::shared_ptr<void>>();
+}
+
+// The buckets, a node per entry and the keys; the values only for the box they take.
+template <class Map>
+std::size_t tableBytes(const Map &map) {
+  using Node = std::pair<typename Map::value_type, std::array<std::size_t, 2>>; // the next pointer and the hash
+  std::size_t bytes = map.bucket_count() * sizeof(void *) + map.size() * sizeof(Node);
+  for (const auto &[key, value] : map) {
+    bytes += textBytes(key);
+    if constexpr (std::is_same_v<typename Map::mapped_type, std::any>)
+      bytes += boxBytes(value);
+  }
+  return bytes;
+}
+
+class Walk {
+  HeapSnapshot::Entries &m_entries;
+
+  std::unordered_set<const void *> m_seen; // instances, environments, method tables and coroutines
+  std::set<std::pair<const FunctionStmt *, const Environment *>> m_functions; // a declaration with a closure
+  // To visit: the walk keeps lists rather than recursing, as a chain of closures or a linked list of instances can be
+  // longer than the C++ stack is deep.
+  std::vector<const Environment *> m_environments;
+  std::vector<const Instance *> m_instances;
+
+public:
+  explicit Walk(HeapSnapshot::Entries &entries)
+      : m_entries(entries) {}
+
+  void count(const HeapSnapshot::Kind kind, const std::string &name, const std::size_t bytes) {
+    HeapSnapshot::Entry &entry = m_entries[{kind, name}];
+    ++entry.count;
+    entry.bytes += bytes;
+  }
+
+  void instance(const Instance &instance) {
+    m_instances.push_back(&instance);
+  }
+
+  void environment(const Environment *environment) {
+    if (environment != nullptr)
+      m_environments.push_back(environment);
+  }
+
+  void value(const std::any &value) {
+    if (const auto *literal = std::any_cast<Literal>(&value)) {
+      if (const auto *text = std::get_if<std::string>(&literal->data()))
+        count(HeapSnapshot::Kind::String, {}, textBytes(*text));
+    } else if (const auto *object = std::any_cast<std::shared_ptr<Instance>>(&value)) {
+      instance(**object);
+    } else if (const auto *function = std::any_cast<Function>(&value)) {
+      this->function(*function);
+    } else if (const auto *klass = std::any_cast<Class>(&value)) {
+      this->klass(*klass);
+    } else if (const auto *coroutine = std::any_cast<std::shared_ptr<Coroutine>>(&value)) {
+      if (m_seen.insert(coroutine->get()).second)
+        (*coroutine)->environments(m_environments);
+    }
+  }
+
+  // A function keeps nothing but its closure, which counts as an environment. Bound methods are functions of their
+  // own, one per instance they were bound to.
+  void function(const Function &function) {
+    if (!m_functions.emplace(&function.declaration(), function.closure().get()).second)
+      return;
+
+    count(HeapSnapshot::Kind::Function, function.declaration().name.lexeme, 0);
+    environment(function.closure().get());
+  }
+
+  void klass(const Class &klass) {
+    if (!m_seen.insert(&klass.methods()).second)
+      return;
+
+    count(HeapSnapshot::Kind::Class, klass.name(), sharedOverhead + sizeof(klass.methods()) + tableBytes(klass.methods()));
+    for (const auto &[name, method] : klass.methods())
+      function(method);
+    if (const Class *superclass = klass.superclass())
+      this->klass(*superclass);
+  }
+
+  void run() {
+    while (!m_instances.empty() || !m_environments.empty()) {
+      if (!m_instances.empty()) {
+        const Instance *instance = m_instances.back();
+        m_instances.pop_back();
+        if (m_seen.insert(instance).second)
+          visit(*instance);
+        continue;
+      }
+
+      const Environment *environment = m_environments.back();
+      m_environments.pop_back();
+      if (m_seen.insert(environment).second)
+        visit(*environment);
+    }
+  }
+
+private:
+  void visit(const Instance &instance) {
+    count(HeapSnapshot::Kind::Instance, instance.klass().name(), sizeof(Instance) + sharedOverhead + tableBytes(instance.fields()));
+    klass(instance.klass());
+    for (const auto &[name, value] : instance.fields())
+      this->value(value);
+  }
+
+  void visit(const Environment &environment) {
+    count(HeapSnapshot::Kind::Environment, {}, sizeof(Environment) + sharedOverhead + tableBytes(environment.values()));
+    for (const auto &[name, value] : environment.values())
+      this->value(value);
+    this->environment(environment.enclosing().get());
+  }
+};
+}
+
+HeapSnapshot::HeapSnapshot(Entries entries)
+    : m_entries(std::move(entries)) {}
+
+HeapSnapshot HeapSnapshot::take(const std::span<const Environment *const> roots, InstanceRegistry &instances) {
+  Entries entries;
+  Walk walk{entries};
+
+  instances.forEach([&](const Instance &instance) { walk.instance(instance); });
+  for (const Environment *root : roots)
+    walk.environment(root);
+  walk.run();
+
+  return HeapSnapshot{std::move(entries)};
+}
+
+const HeapSnapshot::Entries &HeapSnapshot::entries() const {
+  return m_entries;
+}
+
+HeapSnapshot::Entry HeapSnapshot::entry(const Kind kind, const std::string &name) const {
+  const auto it = m_entries.find({kind, name});
+  return it != m_entries.end() ? it->second : Entry{};
+}
+
+HeapSnapshot::Entry HeapSnapshot::total(const Kind kind) const {
+  Entry total;
+  for (auto it = m_entries.lower_bound({kind, {}}); it != m_entries.end() && it->first.first == kind; ++it) {
+    total.count += it->second.count;
+    total.bytes += it->second.bytes;
+  }
+  return total;
+}
+
+HeapSnapshot::Entry HeapSnapshot::total() const {
+  Entry total;
+  for (const auto &[key, entry] : m_entries) {
+    total.count += entry.count;
+    total.bytes += entry.bytes;
+  }
+  return total;
+}
+
+// A line per entry: kind, name, count and bytes, separated by tabs. Names are identifiers, so they hold neither tabs
+// nor line breaks; the entries without one write a dash.
+void HeapSnapshot::write(std::ostream &out) const {
+  out << header << '\n';
+  for (const auto &[key, entry] : m_entries)
+    out << lox::name(key.first) << '\t' << (key.second.empty() ? "-" : key.second) << '\t' << entry.count << '\t' << entry.bytes << '\n';
+}
+
+HeapSnapshot HeapSnapshot::read(std::istream &in) {
+  std::string line;
+  if (!std::getline(in, line) || line != header)
+    throw std::runtime_error("Not a heap snapshot.");
+
+  Entries entries;
+  for (std::size_t number = 2; std::getline(in, line); number++) {
+    std::istringstream fields{line};
+    std::string kind;
+    std::string name;
+    Entry entry;
+    if (!std::getline(fields, kind, '\t') || !std::getline(fields, name, '\t') || !(fields >> entry.count >> entry.bytes))
+      throw std::runtime_error("Malformed heap snapshot entry on line " + std::to_string(number) + ".");
+
+    const auto found = std::find(kindNames.begin(), kindNames.end(), kind);
+    if (found == kindNames.end())
+      throw std::runtime_error("Unknown kind '" + kind + "' on line " + std::to_string(number) + " of a heap snapshot.");
+    entries[{static_cast<Kind>(found - kindNames.begin()), name == "-" ? std::string{} : name}] = entry;
+  }
+
+  return HeapSnapshot{std::move(entries)};
+}
+
+std::vector<HeapSnapshot::Change> HeapSnapshot::since(const HeapSnapshot &before) const {
+  std::vector<Change> changes;
+  const auto change = [&](const std::pair<Kind, std::string> &key) {
+    const Entry now = entry(key.first, key.second);
+    const Entry then = before.entry(key.first, key.second);
+    const auto count = static_cast<std::int64_t>(now.count) - static_cast<std::int64_t>(then.count);
+    const auto bytes = static_cast<std::int64_t>(now.bytes) - static_cast<std::int64_t>(then.bytes);
+    if (count != 0 || bytes != 0)
+      changes.push_back(Change{key.first, key.second, count, bytes});
+  };
+
+  for (const auto &[key, entry] : m_entries)
+    change(key);
+  for (const auto &[key, entry] : before.m_entries) {
+    if (!m_entries.contains(key))
+      change(key);
+  }
+
+  std::stable_sort(changes.begin(), changes.end(), [](const Change &left, const Change &right) {
+    return left.bytes != right.bytes ? left.bytes > right.bytes : left.count > right.count;
+  });
+  return changes;
+}
+
+const char *name(const HeapSnapshot::Kind kind) {
+  return kindNames[static_cast<std::size_t>(kind)];
+}
+
+}
@@ -6,21 +6,35 @@
 #include "lox/callable/class/class.h"
 #include "lox/callable/class/instance.h"
 #include "lox/callable/function/function.h"
-#include "lox/callable/function/return.h"
+#include "lox/callable/native/native.h"
 #include "lox/interpreter/interpreter.h"
+#include "lox/memory/memory.h"
+#include "lox/program/program.h"
 #include "lox/environment/environment.h"
 #include "lox/error/error.h"
 
 #include <boost/variant/static_visitor.hpp>
-#include <fmt/core.h>
+#include <boost/variant/get.hpp>
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <variant>
+#include <span>
 #include <string>
 #include <unordered_map>
 #include <iterator>
+#include <memory>
+#include <mutex>
+#include <utility>
 
 namespace lox {
 
+namespace {
+const Token thisToken{TokenKind::This, "this", nullptr, 0};
+}
+
 Interpreter::ExpressionVisitor::ExpressionVisitor(Interpreter &interpreter)
     : m_interpreter(interpreter) {}
 
@@ -32,45 +46,39 @@ Literal Interpreter::ExpressionVisitor::operator()(const LiteralExpr &expr) cons
   return expr.literal;
 }
 
-Literal Interpreter::ExpressionVisitor::operator()(const LogicalExpr &expr) const {
-  Literal left = std::any_cast<Literal>(evaluate(expr.left));
-  if (expr.op.kind == TokenKind::Or) {
-    if (left.isTruthy())
-      return left;
-  } else {
-    if (!left.isTruthy())
-      return left;
-  }
+std::any Interpreter::ExpressionVisitor::operator()(const LogicalExpr &expr) const {
+  std::any left = evaluate(expr.left);
+
+  if (isShortCircuit(expr, left))
+    return left;
 
-  return std::any_cast<Literal>(evaluate(expr.right));
+  return evaluate(expr.right);
 }
 
 std::any Interpreter::ExpressionVisitor::operator()(const SetExpr &expr) const {
-  std::any object = evaluate(expr);
-
-  if (object.type() != typeid(Instance))
-    throw RuntimeError(expr.name, "Only instances have fields.");
-
+  std::any object = evaluate(expr.object);
   std::any value = evaluate(expr.value);
-  std::any_cast<Instance>(object).set(expr.name, value);
+  set(expr, object, value);
   return value;
 }
 
-Literal Interpreter::ExpressionVisitor::operator()(const GroupingExpr &expr) const {
-  return std::any_cast<Literal>(evaluate(expr.expression));
+std::any Interpreter::ExpressionVisitor::operator()(const GroupingExpr &expr) const {
+  return evaluate(expr.expression);
 }
 
 Literal Interpreter::ExpressionVisitor::operator()(const UnaryExpr &expr) const {
-  Literal right = std::any_cast<Literal>(evaluate(expr.right));
+  return unary(expr, evaluate(expr.right));
+}
 
+Literal Interpreter::ExpressionVisitor::unary(const UnaryExpr &expr, const std::any &right) const {
   switch (expr.op.kind) {
     using enum TokenKind;
 
     case Minus:
-      return -std::get<double>(right.data());
+      return -std::get<double>(std::any_cast<const Literal &>(right).data());
 
     case Bang:
-      return !right.isTruthy();
+      return !isTruthy(right);
 
     default:;
   }
@@ -79,9 +87,104 @@ Literal Interpreter::ExpressionVisitor::operator()(const UnaryExpr &expr) const
 }
 
 Literal Interpreter::ExpressionVisitor::operator()(const BinaryExpr &expr) const {
-  Literal left = std::any_cast<Literal>(evaluate(expr.left));
-  Literal right = std::any_cast<Literal>(evaluate(expr.right));
+  if (m_interpreter.m_adaptive)
+    return quickened(expr);
+
+  const std::any left = evaluate(expr.left);
+  const std::any right = evaluate(expr.right);
+
+  return binary(expr, left, right);
+}
+
+Literal Interpreter::ExpressionVisitor::quickened(const BinaryExpr &expr) const {
+  if (expr.site >= m_interpreter.m_binarySites.size())
+    m_interpreter.m_binarySites.resize(expr.site + 1);
+
+  BinarySite &site = m_interpreter.m_binarySites[expr.site];
+
+  // The left operand may only be read in place if evaluating the right one can't change it.
+  const bool isRightPure = boost::get<LiteralExpr>(&expr.right) != nullptr || boost::get<VariableExpr>(&expr.right) != nullptr;
+
+  std::any leftStorage;
+  std::any rightStorage;
+  const Literal *left = isRightPure ? operand(expr.left, leftStorage) : std::any_cast<Literal>(&(leftStorage = evaluate(expr.left)));
+  const Literal *right = operand(expr.right, rightStorage);
+
+  if (left == nullptr || right == nullptr)
+    return nonLiteral(expr, left != nullptr ? std::any{*left} : leftStorage, right != nullptr ? std::any{*right} : rightStorage);
+
+  switch (site.state) {
+    case BinarySite::State::Specialized:
+      if (const std::optional<Literal> result = specialized(site.specialization, *left, *right)) {
+        if (site.specialization == BinarySite::Specialization::AddStrStr)
+          m_interpreter.countStringAllocation();
+        return *result;
+      }
+
+      site.state = BinarySite::State::Generic;
+      ++m_interpreter.m_quickening.deoptimized;
+      break;
+
+    case BinarySite::State::Warming:
+      m_interpreter.record(site, expr.op.kind, *left, *right);
+      break;
+
+    case BinarySite::State::Generic:
+      break;
+  }
+
+  return binary(expr, *left, *right);
+}
+
+// Literal and variable operands are read where they live instead of being copied out through evaluate(). Anything that
+// isn't a literal ends up in `storage` and gives nullptr.
+const Literal *Interpreter::ExpressionVisitor::operand(const Expr &expr, std::any &storage) const {
+  if (const auto *literal = boost::get<LiteralExpr>(&expr))
+    return &literal->literal;
+
+  if (const auto *variable = boost::get<VariableExpr>(&expr)) {
+    const std::any &value = m_interpreter.variable(variable->name);
+    if (const auto *literal = std::any_cast<Literal>(&value))
+      return literal;
+
+    storage = value;
+    return nullptr;
+  }
+
+  storage = evaluate(expr);
+  return std::any_cast<Literal>(&storage);
+}
 
+Literal Interpreter::ExpressionVisitor::binary(const BinaryExpr &expr, const std::any &left, const std::any &right) const {
+  const auto *l = std::any_cast<Literal>(&left);
+  const auto *r = std::any_cast<Literal>(&right);
+
+  if (l != nullptr && r != nullptr)
+    return binary(expr, *l, *r);
+
+  return nonLiteral(expr, left, right);
+}
+
+// Only equality is defined on operands that aren't both literals.
+Literal Interpreter::ExpressionVisitor::nonLiteral(const BinaryExpr &expr, const std::any &left, const std::any &right) const {
+  switch (expr.op.kind) {
+    using enum TokenKind;
+
+    case EqualEqual:
+      return isEqual(left, right);
+
+    case BangEqual:
+      return !isEqual(left, right);
+
+    case Plus:
+      throw RuntimeError(expr.op, "Operands must be two numbers or two strings.");
+
+    default:
+      throw RuntimeError(expr.op, "Operands must be numbers.");
+  }
+}
+
+Literal Interpreter::ExpressionVisitor::binary(const BinaryExpr &expr, const Literal &left, const Literal &right) const {
   switch (expr.op.kind) {
     using enum TokenKind;
 
@@ -89,8 +192,11 @@ Literal Interpreter::ExpressionVisitor::operator()(const BinaryExpr &expr) const
       if (std::holds_alternative<double>(left.data()) && std::holds_alternative<double>(right.data()))
         return std::get<double>(left.data()) + std::get<double>(right.data());
 
-      if (std::holds_alternative<std::string>(left.data()) && std::holds_alternative<std::string>(right.data()))
+      if (std::holds_alternative<std::string>(left.data()) && std::holds_alternative<std::string>(right.data())) {
+        m_interpreter.countStringAllocation();
+        const memory::Scope scope{memory::Tag::Strings};
         return std::get<std::string>(left.data()) + std::get<std::string>(right.data());
+      }
 
       throw RuntimeError(expr.op, "Operands must be two numbers or two strings.");
     }
@@ -130,61 +236,168 @@ Literal Interpreter::ExpressionVisitor::operator()(const BinaryExpr &expr) const
 }
 
 std::any Interpreter::ExpressionVisitor::operator()(const CallExpr &expr) const {
+  const std::any value = evaluate(expr.callee);
 
-  std::any ret = evaluate(expr.callee);
-  Callable callee;
+  if (const auto *native = std::any_cast<Native>(&value))
+    return callNative(expr, *native);
 
-  if (ret.type() == typeid(Function))
-    callee = std::any_cast<Function>(evaluate(expr.callee));
-  else if (ret.type() == typeid(Class))
-    callee = std::any_cast<Class>(evaluate(expr.callee));
-  else
-    throw RuntimeError(expr.paren, "Can only call functions and classes.");
+  // Called in place: converting to a Callable would copy the function, closure and all.
+  if (const auto *function = std::any_cast<Function>(&value))
+    return function->call(m_interpreter, arguments(expr, function->arity()));
+
+  const Callable callee = callable(expr, value);
+  return callee.call(m_interpreter, arguments(expr, callee.arity()));
+}
+
+Callable Interpreter::ExpressionVisitor::callable(const CallExpr &expr, const std::any &callee) {
+  if (const auto *function = std::any_cast<Function>(&callee))
+    return *function;
+  if (const auto *klass = std::any_cast<Class>(&callee))
+    return *klass;
+  if (const auto *native = std::any_cast<Native>(&callee))
+    return *native;
+
+  throw RuntimeError(expr.paren, "Can only call functions and classes.");
+}
+
+// The arity is checked up front, as the arguments go to a fixed array on the C++ stack.
+std::any Interpreter::ExpressionVisitor::callNative(const CallExpr &expr, const Native &native) const {
+  checkArity(expr, native, expr.arguments.size());
 
-  std::vector<Literal> arguments;
+  std::array<std::any, Native::maxArity> arguments;
+  for (std::size_t i = 0; i < expr.arguments.size(); i++)
+    arguments[i] = evaluate(expr.arguments[i]);
+
+  return invokeNative(expr, native, std::span<const std::any>(arguments.data(), expr.arguments.size()));
+}
+
+std::any Interpreter::ExpressionVisitor::invokeNative(const CallExpr &expr, const Native &native, std::span<const std::any> arguments) {
+  try {
+    return native.call(arguments);
+  } catch (const NativeError &e) {
+    throw RuntimeError(expr.paren, e.what());
+  }
+}
+
+std::vector<std::any> Interpreter::ExpressionVisitor::arguments(const CallExpr &expr, const std::size_t arity) const {
+  std::vector<std::any> arguments;
+  arguments.reserve(expr.arguments.size());
   std::transform(begin(expr.arguments), end(expr.arguments), back_inserter(arguments), //
-                 [this](const Expr &expr) { return std::any_cast<Literal>(evaluate(expr)); });
-
-  auto checkArity = [&expr](const std::size_t funcArgs, const std::size_t argsSize) {
-    if (funcArgs != argsSize)
-      throw RuntimeError(expr.paren,
-                         std::string("Expected [")
-                             .append(std::to_string(funcArgs)) //
-                             .append("] arguments but got ")   //
-                             .append(std::to_string(argsSize)) //
-                             .append(".\n"));
-  };
+                 [this](const Expr &expr) { return evaluate(expr); });
 
-  checkArity(callee.arity(), arguments.size());
-  return callee.call(m_interpreter, arguments);
+  checkArity(expr, arity, arguments.size());
+  return arguments;
+}
+
+void Interpreter::ExpressionVisitor::checkArity(const CallExpr &expr, const std::size_t arity, const std::size_t count) {
+  if (arity != count)
+    throw RuntimeError(expr.paren,
+                       std::string("Expected [")
+                           .append(std::to_string(arity))  //
+                           .append("] arguments but got ") //
+                           .append(std::to_string(count))  //
+                           .append(".\n"));
+}
+
+void Interpreter::ExpressionVisitor::checkArity(const CallExpr &expr, const Native &native, const std::size_t count) {
+  if (!native.isVariadic())
+    checkArity(expr, native.arity(), count);
+  else if (count > Native::maxArity)
+    throw RuntimeError(expr.paren,
+                       std::string("Expected at most [")
+                           .append(std::to_string(Native::maxArity)) //
+                           .append("] arguments but got ")          //
+                           .append(std::to_string(count))           //
+                           .append(".\n"));
 }
 
 std::any Interpreter::ExpressionVisitor::operator()(const GetExpr &expr) const {
-  std::any ret = evaluate(expr.object);
-  if (ret.type() == typeid(Instance)) {
-    Instance instance = std::any_cast<Instance>(ret);
-    return instance.get(expr.name);
-  }
+  return get(expr, evaluate(expr.object));
+}
+
+std::any Interpreter::ExpressionVisitor::get(const GetExpr &expr, const std::any &object) const {
+  if (m_interpreter.m_counters != nullptr)
+    ++m_interpreter.m_counters->propertyGets;
+
+  if (const auto *instance = std::any_cast<std::shared_ptr<Instance>>(&object))
+    return (*instance)->get(expr.name);
+
   throw RuntimeError(expr.name, "Only instances have properties.");
 }
 
-std::any Interpreter::ExpressionVisitor::operator()(const VariableExpr &expr) const {
-  return m_interpreter.m_environment.get(expr.name);
+void Interpreter::ExpressionVisitor::set(const SetExpr &expr, std::any &object, const std::any &value) const {
+  const auto *instance = std::any_cast<std::shared_ptr<Instance>>(&object);
+  if (instance == nullptr)
+    throw RuntimeError(expr.name, "Only instances have fields.");
+
+  if (m_interpreter.m_counters != nullptr)
+    ++m_interpreter.m_counters->propertySets;
+  (*instance)->set(expr.name, value);
 }
 
-Literal Interpreter::ExpressionVisitor::operator()(const AssignExpr &expr) const {
-  Literal value = std::any_cast<Literal>(evaluate(expr.value));
+// `or` stops at a truthy left operand, `and` at a falsey one.
+bool Interpreter::ExpressionVisitor::isShortCircuit(const LogicalExpr &expr, const std::any &left) {
+  return expr.op.kind == TokenKind::Or ? isTruthy(left) : !isTruthy(left);
+}
 
-  if (const auto locals = m_interpreter.m_locals; locals.contains(expr)) {
-    const std::size_t distance = locals.find(expr)->second;
-    m_interpreter.m_environment.assignAt(expr.name, distance, value);
-  } else {
-    m_interpreter.m_globals.assign(expr.name, value);
-  }
+bool Interpreter::ExpressionVisitor::isTruthy(const std::any &value) {
+  const auto *literal = std::any_cast<Literal>(&value);
+  return literal == nullptr || literal->isTruthy();
+}
 
+bool Interpreter::ExpressionVisitor::isEqual(const std::any &left, const std::any &right) {
+  if (left.type() != right.type())
+    return false;
+
+  if (const auto *literal = std::any_cast<Literal>(&left))
+    return *literal == std::any_cast<const Literal &>(right);
+  if (const auto *instance = std::any_cast<std::shared_ptr<Instance>>(&left))
+    return *instance == std::any_cast<const std::shared_ptr<Instance> &>(right);
+  if (const auto *function = std::any_cast<Function>(&left))
+    return *function == std::any_cast<const Function &>(right);
+  if (const auto *klass = std::any_cast<Class>(&left))
+    return *klass == std::any_cast<const Class &>(right);
+  if (const auto *native = std::any_cast<Native>(&left))
+    return *native == std::any_cast<const Native &>(right);
+  if (const auto *channel = std::any_cast<std::shared_ptr<Channel>>(&left))
+    return *channel == std::any_cast<const std::shared_ptr<Channel> &>(right);
+  if (const auto *coroutine = std::any_cast<std::shared_ptr<Coroutine>>(&left))
+    return *coroutine == std::any_cast<const std::shared_ptr<Coroutine> &>(right);
+
+  return false;
+}
+
+std::any Interpreter::ExpressionVisitor::operator()(const VariableExpr &expr) const {
+  return m_interpreter.lookUpVariable(expr.name);
+}
+
+std::any Interpreter::ExpressionVisitor::operator()(const AssignExpr &expr) const {
+  std::any value = evaluate(expr.value);
+  m_interpreter.assignVariable(expr.name, value);
   return value;
 }
 
+std::any Interpreter::ExpressionVisitor::operator()(const ThisExpr &expr) const {
+  return m_interpreter.lookUpVariable(expr.keyword);
+}
+
+// The resolver puts the superclass one scope above the one binding `this`.
+std::any Interpreter::ExpressionVisitor::operator()(const SuperExpr &expr) const {
+  const auto it = m_interpreter.m_resolution.locals.find(&expr.keyword);
+  if (it == m_interpreter.m_resolution.locals.end()) // only reachable past a resolution error
+    return Literal{nullptr};
+
+  const std::size_t distance = it->second;
+  const auto &superclass = std::any_cast<const Class &>(m_interpreter.m_environment->at(expr.keyword, distance));
+  const auto &instance = std::any_cast<const std::shared_ptr<Instance> &>(m_interpreter.m_environment->at(thisToken, distance - 1));
+
+  const std::optional<Function> method = superclass.findMethod(expr.method.lexeme);
+  if (!method)
+    throw RuntimeError(expr.method, std::string("Undefined property '").append(expr.method.lexeme).append("'."));
+
+  return method->bind(instance);
+}
+
 Literal Interpreter::ExpressionVisitor::operator()([[maybe_unused]] const auto & /*unused*/) const {
   return {};
 }
@@ -193,6 +406,8 @@ Interpreter::StatementVisitor::StatementVisitor(Interpreter &interpreter)
     : m_interpreter(interpreter) {}
 
 void Interpreter::StatementVisitor::execute(const Stmt &stmt) const {
+  if constexpr (countsStatements)
+    m_interpreter.countStatement(stmt);
   boost::apply_visitor(m_interpreter.m_statementVisitor, stmt);
 }
 
@@ -202,60 +417,110 @@ void Interpreter::StatementVisitor::operator()(const ExpressionStmt &stmt) const
 
 void Interpreter::StatementVisitor::operator()(const FunctionStmt &stmt) const {
   Function function{stmt, m_interpreter.m_environment};
-  m_interpreter.m_environment.define(stmt.name, function);
+  m_interpreter.m_environment->define(stmt.name, function);
+  if (Tracer *tracer = m_interpreter.m_tracer)
+    tracer->allocation(Tracer::Allocation::Closure);
 }
 
 void Interpreter::StatementVisitor::operator()(const PrintStmt &stmt) const {
-  std::any ret = m_interpreter.m_expressionVisitor.evaluate(stmt.expression);
-
-  if (ret.type() == typeid(Literal)) {
-    fmt::print("{}\n", std::string(std::any_cast<Literal>(ret)));
-  } else if (ret.type() == typeid(Class)) {
-    fmt::print("{}\n", std::string(std::any_cast<Class>(ret)));
-  } else if (ret.type() == typeid(Function)) {
-    fmt::print("{}\n", std::string(std::any_cast<Function>(ret)));
+  print(m_interpreter.m_expressionVisitor.evaluate(stmt.expression));
+}
+
+void Interpreter::StatementVisitor::print(const std::any &ret) const {
+  Output &output = m_interpreter.m_output;
+
+  if (const auto *literal = std::any_cast<Literal>(&ret)) {
+    output.writeLine(std::string(*literal));
+  } else if (const auto *klass = std::any_cast<Class>(&ret)) {
+    output.writeLine(std::string(*klass));
+  } else if (const auto *function = std::any_cast<Function>(&ret)) {
+    output.writeLine(std::string(*function));
+  } else if (const auto *native = std::any_cast<Native>(&ret)) {
+    output.writeLine(std::string(*native));
+  } else if (const auto *channel = std::any_cast<std::shared_ptr<Channel>>(&ret)) {
+    output.writeLine(std::string(**channel));
+  } else if (const auto *coroutine = std::any_cast<std::shared_ptr<Coroutine>>(&ret)) {
+    output.writeLine(std::string(**coroutine));
   } else {
-    fmt::print("{}\n", std::string(std::any_cast<Instance>(ret)));
+    output.writeLine(std::string(*std::any_cast<const std::shared_ptr<Instance> &>(ret)));
   }
 }
 
 void Interpreter::StatementVisitor::operator()(const ReturnStmt &stmt) const {
-  Literal value;
+  if (m_interpreter.m_resolution.tailCalls.contains(&stmt)) {
+    const auto &call = boost::get<CallExpr>(stmt.value);
+    const std::any value = m_interpreter.m_expressionVisitor.evaluate(call.callee);
+    if (const auto *native = std::any_cast<Native>(&value)) {
+      m_interpreter.m_returnValue = m_interpreter.m_expressionVisitor.callNative(call, *native);
+      return;
+    }
+
+    const Callable callee = Interpreter::ExpressionVisitor::callable(call, value);
+    std::vector<std::any> arguments = m_interpreter.m_expressionVisitor.arguments(call, callee.arity());
+
+    if (const Function *function = callee.function())
+      m_interpreter.m_returnValue = TailCall{*function, std::move(arguments)};
+    else
+      m_interpreter.m_returnValue = callee.call(m_interpreter, arguments);
+    return;
+  }
+
+  std::any value = Literal{nullptr};
   if (stmt.value.which() != 0) // is its type boost::blank?
-    value = std::any_cast<Literal>(m_interpreter.m_expressionVisitor.evaluate(stmt.value));
+    value = m_interpreter.m_expressionVisitor.evaluate(stmt.value);
 
-  throw Return{value};
+  m_interpreter.m_returnValue = std::move(value);
 }
 
 void Interpreter::StatementVisitor::operator()(const VariableStmt &stmt) const {
-  std::any val;
+  std::any val = Literal{nullptr};
 
   if (stmt.initializer.which() != 0) {
     val = m_interpreter.m_expressionVisitor.evaluate(stmt.initializer);
   }
 
-  m_interpreter.m_environment.define(stmt.name, val);
+  m_interpreter.m_environment->define(stmt.name, val);
 }
 
 void Interpreter::StatementVisitor::operator()(const BlockStmt &stmt) const {
-  const auto newEnvironment = m_interpreter.m_environment;
-  executeBlock(stmt.statements, newEnvironment);
+  if (!m_interpreter.m_resolution.isScoped(stmt.id)) {
+    executeBlock(stmt.statements, memory::makeShared<Environment>(memory::Tag::Environments, m_interpreter.m_environment));
+    return;
+  }
+
+  const memory::FrameArena::Frame frame{m_interpreter.m_frames};
+  executeBlock(stmt.statements, m_interpreter.frameEnvironment(m_interpreter.m_environment));
 }
 
 void Interpreter::StatementVisitor::operator()(const ClassStmt &stmt) const {
-  m_interpreter.m_environment.define(stmt.name, nullptr);
+  std::optional<Class> superclass;
+  if (const auto *superClass = boost::get<VariableExpr>(&stmt.superClass)) {
+    const std::any value = m_interpreter.m_expressionVisitor.evaluate(stmt.superClass);
+    if (value.type() != typeid(Class))
+      throw RuntimeError(superClass->name, "Superclass must be a class.");
+    superclass = std::any_cast<const Class &>(value);
+  }
+
+  m_interpreter.m_environment->define(stmt.name, Literal{nullptr});
+
+  // The methods of a subclass close over an environment binding `super`.
+  std::shared_ptr<Environment> closure = m_interpreter.m_environment;
+  if (superclass) {
+    closure = memory::makeShared<Environment>(memory::Tag::Environments, closure);
+    closure->define(Token{TokenKind::Super, "super", nullptr, stmt.name.line}, *superclass);
+  }
 
   std::unordered_map<std::string, Function> methods;
   std::transform(begin(stmt.methods), end(stmt.methods), inserter(methods, end(methods)), //
                  [&](const FunctionStmt &method) {
-                   return std::pair{method.name.lexeme, Function{method, m_interpreter.m_environment}};
+                   return std::pair{method.name.lexeme, Function{method, closure, method.name.lexeme == "init"}};
                  });
 
-  m_interpreter.m_environment.assign(stmt.name, Class{stmt.name.lexeme, methods});
+  m_interpreter.m_environment->assign(stmt.name, Class{stmt.name.lexeme, superclass, methods});
 }
 
 void Interpreter::StatementVisitor::operator()(const IfStmt &stmt) const {
-  if (std::any_cast<Literal>(m_interpreter.m_expressionVisitor.evaluate(stmt.condition)).isTruthy()) {
+  if (ExpressionVisitor::isTruthy(m_interpreter.m_expressionVisitor.evaluate(stmt.condition))) {
     execute(stmt.thenBranch);
   } else if (stmt.elseBranch.which() != 0) {
     execute(stmt.elseBranch);
@@ -263,44 +528,268 @@ void Interpreter::StatementVisitor::operator()(const IfStmt &stmt) const {
 }
 
 void Interpreter::StatementVisitor::operator()(const WhileStmt &stmt) const {
-  while (std::any_cast<Literal>(m_interpreter.m_expressionVisitor.evaluate(stmt.condition)).isTruthy())
+  while (ExpressionVisitor::isTruthy(m_interpreter.m_expressionVisitor.evaluate(stmt.condition))) {
     execute(stmt.body);
+    if (m_interpreter.m_returnValue)
+      break;
+    checkpoint(stmt.keyword);
+  }
 }
 
 void Interpreter::StatementVisitor::operator()([[maybe_unused]] const auto & /*unused*/) const {
   /* sink */
 }
 
-void Interpreter::StatementVisitor::executeBlock(const std::vector<Stmt> &statements, const Environment &env) const {
-  const auto previous = m_interpreter.m_environment;
-
-  m_interpreter.m_environment = env;
+void Interpreter::StatementVisitor::executeBlock(const std::vector<Stmt> &statements, const std::shared_ptr<Environment> &env) const {
+  auto previous = std::exchange(m_interpreter.m_environment, env);
+  const SavedEnvironment saved{m_interpreter, previous};
 
-  for (const auto &statement : statements) {
-    execute(statement);
+  try {
+    for (const auto &statement : statements) {
+      execute(statement);
+      if (m_interpreter.m_returnValue)
+        break;
+    }
+  } catch (...) {
+    m_interpreter.m_environment = std::move(previous);
+    throw;
   }
 
-  m_interpreter.m_environment = previous;
+  m_interpreter.m_environment = std::move(previous);
+}
+
+// Runs the body of a function and hands out the value its return statement left behind, nil if there was none.
+std::any Interpreter::StatementVisitor::executeFunction(const std::vector<Stmt> &body, const std::shared_ptr<Environment> &env) const {
+  executeBlock(body, env);
+
+  if (!m_interpreter.m_returnValue)
+    return Literal{nullptr};
+
+  std::any value = std::move(*m_interpreter.m_returnValue);
+  m_interpreter.m_returnValue.reset();
+  return value;
+}
+
+std::any Interpreter::StatementVisitor::executeCall(const Function &function, const std::vector<std::any> &arguments) const {
+  const FunctionStmt &declaration = function.declaration();
+  if (!m_interpreter.m_resolution.isScoped(declaration.id))
+    return executeFunction(declaration.body, function.environment(arguments));
+
+  const memory::FrameArena::Frame frame{m_interpreter.m_frames};
+  const std::shared_ptr<Environment> environment = m_interpreter.frameEnvironment(function.closure());
+  for (std::size_t i = 0; i < declaration.params.size(); i++)
+    environment->define(declaration.params[i], arguments[i]);
+
+  return executeFunction(declaration.body, environment);
+}
+
+std::any Interpreter::StatementVisitor::coroutine(const Function &function, const std::vector<std::any> &arguments) const {
+  return std::make_shared<Coroutine>(m_interpreter, function, arguments);
 }
 
 Interpreter::Interpreter(const std::vector<Stmt> &statements)
     : m_statements(statements)
+    , m_resolution(m_ownResolution)
+    , m_globals(memory::makeShared<Environment>(memory::Tag::Environments))
     , m_environment(m_globals)
     , m_expressionVisitor(*this)
-    , m_statementVisitor(*this) {}
+    , m_statementVisitor(*this) {
+  defineClock();
+  defineCoroutines();
+  defineHeapStats();
+}
 
-void Interpreter::interpret() const {
-  try {
-    for (const Stmt &statement : m_statements) {
+Interpreter::Interpreter(const std::shared_ptr<const Program> &program, std::FILE *output)
+    : m_program(program)
+    , m_statements(program->statements())
+    , m_resolution(program->resolution())
+    , m_globals(memory::makeShared<Environment>(memory::Tag::Environments))
+    , m_environment(m_globals)
+    , m_output(output)
+    , m_expressionVisitor(*this)
+    , m_statementVisitor(*this) {
+  defineClock();
+  defineCoroutines();
+  defineHeapStats();
+}
+
+Interpreter::Interpreter(const IsolateOf parent)
+    : m_program(parent.interpreter.m_program)
+    , m_statements(parent.interpreter.m_statements)
+    , m_resolution(parent.interpreter.m_resolution)
+    , m_globals(memory::makeShared<Environment>(memory::Tag::Environments))
+    , m_environment(m_globals)
+    , m_output(parent.interpreter.m_output.stream())
+    , m_adaptive(parent.interpreter.m_adaptive)
+    , m_tracer(parent.interpreter.m_tracer)
+    , m_expressionVisitor(*this)
+    , m_statementVisitor(*this) {
+  defineClock();
+  defineCoroutines();
+  defineHeapStats();
+  setJit(parent.interpreter.m_jit != nullptr);
+
+  const Interpreter &spawner = parent.interpreter;
+  if (spawner.m_budget.isLimited()) {
+    Budget budget = spawner.m_budget;
+    if (budget.steps)
+      budget.steps = spawner.m_stepsLeft + static_cast<std::uint64_t>(std::max<std::int64_t>(spawner.m_countdown, 0));
+    setBudget(budget);
+  }
+
+  m_spawner = spawner.m_isolates;
+  const std::lock_guard lock{m_spawner->mutex};
+  m_spawner->interpreters.push_back(this);
+}
+
+// Reference counting doesn't collect cycles, and a program makes them all the time: a global function closes over the
+// globals that hold it, and a bound method stored in a field of its instance keeps that instance. Dropping the
+// globals and the fields of every instance still alive breaks these; a local function that closes over the
+// environment holding it still leaks that environment once the call returns.
+Interpreter::~Interpreter() {
+  if (m_spawner) {
+    const std::lock_guard lock{m_spawner->mutex};
+    std::erase(m_spawner->interpreters, this);
+  }
+
+  m_scheduler.clear();
+  m_returnValue.reset();
+  m_environment = m_globals;
+  m_globals->clear();
+
+  // Held while their fields are dropped, so that none of them is destroyed while the registry is walked.
+  std::vector<std::shared_ptr<Instance>> instances;
+  m_instances->forEach([&](Instance &instance) {
+    if (std::shared_ptr<Instance> alive = instance.weak_from_this().lock())
+      instances.push_back(std::move(alive));
+  });
+  for (const std::shared_ptr<Instance> &instance : instances)
+    instance->clearFields();
+}
+
+std::unique_ptr<Interpreter> Interpreter::isolate() const {
+  return std::unique_ptr<Interpreter>(new Interpreter(IsolateOf{*this}));
+}
+
+void Interpreter::declare() {
+  for (const Stmt &statement : m_statements) {
+    if (boost::get<FunctionStmt>(&statement) != nullptr || boost::get<ClassStmt>(&statement) != nullptr)
       m_statementVisitor.execute(statement);
-    }
+  }
+}
+
+void Interpreter::interpret() {
+  const Tracer::Span span{m_tracer, "Interpreter"};
+  try {
+    execute();
   } catch (const RuntimeError &e) {
+    m_output.flush();
     runtimeError(e);
   }
 }
 
-void Interpreter::resolve(const Expr &expr, const std::size_t depth) {
-  m_locals[expr] = depth;
+void Interpreter::execute() {
+  if (m_machine) {
+    m_machine->run(m_statements);
+    return;
+  }
+
+  for (const Stmt &statement : m_statements) {
+    m_statementVisitor.execute(statement);
+    if (m_returnValue) // only reachable past a resolution error
+      break;
+  }
+}
+
+Resolution &Interpreter::resolution() {
+  return m_ownResolution;
+}
+
+// The control block goes on the arena along with the environment, so neither takes anything from the heap.
+std::shared_ptr<Environment> Interpreter::frameEnvironment(const std::shared_ptr<Environment> &enclosing) {
+  return std::allocate_shared<Environment>(std::pmr::polymorphic_allocator<Environment>{&m_frames}, enclosing, &m_frames);
+}
+
+void Interpreter::defineClock() {
+  defineNative("clock", 0, [](std::span<const std::any> /*arguments*/) -> std::any {
+    const auto now = std::chrono::steady_clock::now().time_since_epoch();
+    return Literal{std::chrono::duration<double>(now).count()};
+  });
+}
+
+void Interpreter::defineCoroutines() {
+  const auto coroutine = [](const std::any &value) {
+    const auto *coroutine = std::any_cast<std::shared_ptr<Coroutine>>(&value);
+    if (coroutine == nullptr)
+      throw NativeError("Expected a coroutine.");
+    return *coroutine;
+  };
+
+  defineNative("resume", 1, [coroutine](std::span<const std::any> arguments) -> std::any {
+    return coroutine(arguments[0])->resume();
+  });
+
+  defineNative("done", 1, [coroutine](std::span<const std::any> arguments) -> std::any {
+    return Literal{coroutine(arguments[0])->state() == Coroutine::State::Done};
+  });
+
+  defineNative("schedule", 1, [this, coroutine](std::span<const std::any> arguments) -> std::any {
+    m_scheduler.schedule(coroutine(arguments[0]));
+    return Literal{nullptr};
+  });
+
+  defineNative("run", 0, [this](std::span<const std::any> /*arguments*/) -> std::any {
+    m_scheduler.run();
+    return Literal{nullptr};
+  });
+}
+
+void Interpreter::defineHeapStats() {
+  defineNative("heapStats", Native::variadic, [this](std::span<const std::any> arguments) -> std::any {
+    if (arguments.size() > 1)
+      throw NativeError("Expected at most 1 argument.");
+
+    const HeapSnapshot snapshot = heapSnapshot();
+    if (arguments.size() == 1) {
+      const auto *name = std::any_cast<Literal>(&arguments[0]);
+      if (name == nullptr || !std::holds_alternative<std::string>(name->data()))
+        throw NativeError("Expected the name of a class.");
+      return Literal{static_cast<double>(snapshot.entry(HeapSnapshot::Kind::Instance, std::get<std::string>(name->data())).count)};
+    }
+
+    auto stats = memory::makeShared<Instance>(memory::Tag::Objects, Class{"HeapStats", std::nullopt, {}}, m_instances.get());
+    const std::array<std::pair<HeapSnapshot::Kind, const char *>, 5> fields{{{HeapSnapshot::Kind::Instance, "instances"},
+                                                                             {HeapSnapshot::Kind::Class, "classes"},
+                                                                             {HeapSnapshot::Kind::Function, "functions"},
+                                                                             {HeapSnapshot::Kind::String, "strings"},
+                                                                             {HeapSnapshot::Kind::Environment, "environments"}}};
+    for (const auto &[kind, field] : fields) {
+      const HeapSnapshot::Entry total = snapshot.total(kind);
+      stats->set(Token{TokenKind::Identifier, field, nullptr, 0}, Literal{static_cast<double>(total.count)});
+      stats->set(Token{TokenKind::Identifier, std::string(name(kind)) + "Bytes", nullptr, 0}, Literal{static_cast<double>(total.bytes)});
+    }
+    return stats;
+  });
+}
+
+void Interpreter::defineNative(const std::string &name, const std::size_t arity, Native::Callback callback) {
+  m_globals->define(Token{TokenKind::Identifier, name, nullptr, 0}, Native{name, arity, std::move(callback)});
+}
+
+InstanceRegistry &Interpreter::instances() const {
+  return *m_instances;
+}
+
+HeapSnapshot Interpreter::heapSnapshot() const {
+  std::vector<const Environment *> roots{m_globals.get(), m_environment.get()};
+  for (const SavedEnvironment *saved = m_saved; saved != nullptr; saved = saved->next())
+    roots.push_back(saved->environment());
+  if (m_machine)
+    m_machine->environments(roots);
+  for (const std::shared_ptr<Coroutine> &coroutine : m_scheduler.ready())
+    coroutine->environments(roots);
+
+  return HeapSnapshot::take(roots, *m_instances);
 }
 
 Interpreter::ExpressionVisitor &Interpreter::expressionVisitor() {
@@ -319,9 +808,306 @@ const Interpreter::StatementVisitor &Interpreter::statementVisitor() const {
   return m_statementVisitor;
 }
 
-std::any Interpreter::lookUpVariable(const Token &name, const Expr &expr) const {
-  if (m_locals.contains(expr))
-    return m_environment.getAt(name, m_locals.find(expr)->second);
-  return m_globals.get(name);
+LimitError::LimitError(const Token &token, const Reason reason)
+    : RuntimeError(token, reason == Reason::Steps      ? "Step budget exhausted."
+                          : reason == Reason::Deadline ? "Deadline exceeded."
+                                                       : "Interrupted.")
+    , m_reason(reason) {}
+
+LimitError::Reason LimitError::reason() const {
+  return m_reason;
+}
+
+bool Interpreter::Budget::isLimited() const {
+  return steps || deadline;
+}
+
+void Interpreter::refuel(const Token &where) {
+  if (m_interrupted.exchange(false, std::memory_order_relaxed))
+    throw LimitError(where, LimitError::Reason::Interrupt);
+  if (m_budget.deadline && std::chrono::steady_clock::now() >= *m_budget.deadline) {
+    interruptIsolates();
+    throw LimitError(where, LimitError::Reason::Deadline);
+  }
+
+  std::int64_t granted = Budget::checkInterval;
+  if (m_budget.steps) {
+    if (m_stepsLeft == 0) {
+      interruptIsolates();
+      throw LimitError(where, LimitError::Reason::Steps);
+    }
+
+    granted = static_cast<std::int64_t>(std::min<std::uint64_t>(m_stepsLeft, Budget::checkInterval));
+    m_stepsLeft -= static_cast<std::uint64_t>(granted);
+  }
+
+  m_countdown = granted - 1; // the step being taken
+}
+
+void Interpreter::setBudget(const Budget &budget) {
+  m_budget = budget;
+  m_stepsLeft = budget.steps.value_or(0);
+  m_countdown = 0;
+}
+
+const Interpreter::Budget &Interpreter::budget() const {
+  return m_budget;
+}
+
+void Interpreter::interrupt() {
+  m_interrupted.store(true, std::memory_order_relaxed);
+  interruptIsolates();
+}
+
+void Interpreter::interruptIsolates() {
+  const std::lock_guard lock{m_isolates->mutex};
+  for (Interpreter *isolate : m_isolates->interpreters)
+    isolate->interrupt();
+}
+
+void Interpreter::setCallStack(CallStack *callStack) {
+  m_callStack = callStack;
+}
+
+CallStack *Interpreter::callStack() const {
+  return m_callStack;
+}
+
+void Interpreter::setCounters(Counters *counters) {
+  m_counters = counters;
+}
+
+Interpreter::Counters *Interpreter::counters() const {
+  return m_counters;
+}
+
+void Interpreter::setTracer(Tracer *tracer) {
+  m_tracer = tracer;
+}
+
+Tracer *Interpreter::tracer() const {
+  return m_tracer;
+}
+
+const std::vector<std::uint64_t> &Interpreter::statementCounts() const {
+  return m_statementCounts;
+}
+
+void Interpreter::countStringAllocation() const {
+  if (m_counters != nullptr)
+    ++m_counters->stringAllocations;
+  if (m_tracer != nullptr)
+    m_tracer->allocation(Tracer::Allocation::String);
+}
+
+void Interpreter::setAdaptive(const bool adaptive) {
+  m_adaptive = adaptive;
+}
+
+const Interpreter::QuickeningStatistics &Interpreter::quickeningStatistics() const {
+  return m_quickening;
+}
+
+void Interpreter::setJit(const bool enabled) {
+  m_jit = enabled && Jit::isSupported() ? std::make_unique<Jit>(m_interrupted) : nullptr;
+}
+
+Jit *Interpreter::jit() const {
+  return m_jit.get();
+}
+
+const std::shared_ptr<Environment> &Interpreter::globals() const {
+  return m_globals;
+}
+
+const std::vector<Stmt> &Interpreter::statements() const {
+  return m_statements;
+}
+
+Output &Interpreter::output() {
+  return m_output;
+}
+
+void Interpreter::setExplicitStack(const bool enabled, const std::size_t maxDepth) {
+  m_machine = enabled ? std::make_unique<Machine>(*this, maxDepth) : nullptr;
+}
+
+const Machine *Interpreter::machine() const {
+  return m_machine.get();
+}
+
+const Coroutine *Interpreter::coroutine() const {
+  return m_coroutine;
+}
+
+const Scheduler &Interpreter::scheduler() const {
+  return m_scheduler;
+}
+
+// The guard of a specialized site: operands of the expected types run the operation directly, anything else returns
+// nothing and sends the site back to the generic path.
+std::optional<Literal> Interpreter::specialized(const BinarySite::Specialization specialization, const Literal &left, const Literal &right) {
+  using enum BinarySite::Specialization;
+
+  if (specialization >= AddStrStr) {
+    const auto *l = std::get_if<std::string>(&left.data());
+    const auto *r = std::get_if<std::string>(&right.data());
+    if (l == nullptr || r == nullptr)
+      return std::nullopt;
+
+    switch (specialization) {
+      case AddStrStr: {
+        const memory::Scope scope{memory::Tag::Strings};
+        return *l + *r;
+      }
+      case EqualStrStr:
+        return *l == *r;
+      case NotEqualStrStr:
+        return *l != *r;
+      default:
+        return std::nullopt;
+    }
+  }
+
+  const auto *l = std::get_if<double>(&left.data());
+  const auto *r = std::get_if<double>(&right.data());
+  if (l == nullptr || r == nullptr)
+    return std::nullopt;
+
+  switch (specialization) {
+    case AddNumNum:
+      return *l + *r;
+    case SubtractNumNum:
+      return *l - *r;
+    case MultiplyNumNum:
+      return *l * *r;
+    case DivideNumNum:
+      return *l / *r;
+    case LessNumNum:
+      return *l < *r;
+    case LessEqualNumNum:
+      return *l <= *r;
+    case GreaterNumNum:
+      return *l > *r;
+    case GreaterEqualNumNum:
+      return *l >= *r;
+    case EqualNumNum:
+      return *l == *r;
+    case NotEqualNumNum:
+      return *l != *r;
+    default:
+      return std::nullopt;
+  }
+}
+
+void Interpreter::record(BinarySite &site, const TokenKind op, const Literal &left, const Literal &right) {
+  if (std::holds_alternative<double>(left.data()) && std::holds_alternative<double>(right.data()))
+    site.seen |= BinarySite::numbers;
+  else if (std::holds_alternative<std::string>(left.data()) && std::holds_alternative<std::string>(right.data()))
+    site.seen |= BinarySite::strings;
+  else
+    site.seen |= BinarySite::others;
+
+  if (++site.samples < BinarySite::warmup)
+    return;
+
+  using enum BinarySite::Specialization;
+  std::optional<BinarySite::Specialization> specialization;
+
+  if (site.seen == BinarySite::numbers) {
+    switch (op) {
+      case TokenKind::Plus:
+        specialization = AddNumNum;
+        break;
+      case TokenKind::Minus:
+        specialization = SubtractNumNum;
+        break;
+      case TokenKind::Star:
+        specialization = MultiplyNumNum;
+        break;
+      case TokenKind::Slash:
+        specialization = DivideNumNum;
+        break;
+      case TokenKind::Less:
+        specialization = LessNumNum;
+        break;
+      case TokenKind::LessEqual:
+        specialization = LessEqualNumNum;
+        break;
+      case TokenKind::Greater:
+        specialization = GreaterNumNum;
+        break;
+      case TokenKind::GreaterEqual:
+        specialization = GreaterEqualNumNum;
+        break;
+      case TokenKind::EqualEqual:
+        specialization = EqualNumNum;
+        break;
+      case TokenKind::BangEqual:
+        specialization = NotEqualNumNum;
+        break;
+      default:
+        break;
+    }
+  } else if (site.seen == BinarySite::strings) {
+    switch (op) {
+      case TokenKind::Plus:
+        specialization = AddStrStr;
+        break;
+      case TokenKind::EqualEqual:
+        specialization = EqualStrStr;
+        break;
+      case TokenKind::BangEqual:
+        specialization = NotEqualStrStr;
+        break;
+      default:
+        break;
+    }
+  }
+
+  if (specialization) {
+    site.state = BinarySite::State::Specialized;
+    site.specialization = *specialization;
+    ++m_quickening.specialized;
+  } else {
+    site.state = BinarySite::State::Generic;
+    ++m_quickening.generic;
+  }
+}
+
+const std::any &Interpreter::variable(const Token &name) const {
+  const auto it = m_resolution.locals.find(&name);
+  countLookup(it);
+  if (it != m_resolution.locals.end())
+    return m_environment->at(name, it->second);
+  return m_globals->at(name, 0);
+}
+
+void Interpreter::assignVariable(const Token &name, const std::any &value) {
+  const auto it = m_resolution.locals.find(&name);
+  countLookup(it);
+  if (it != m_resolution.locals.end()) {
+    m_environment->assignAt(name, it->second, value);
+  } else {
+    m_globals->assign(name, value);
+  }
+}
+
+std::any Interpreter::lookUpVariable(const Token &name) const {
+  const auto it = m_resolution.locals.find(&name);
+  countLookup(it);
+  if (it != m_resolution.locals.end())
+    return m_environment->getAt(name, it->second);
+  return m_globals->get(name);
+}
+
+void Interpreter::countLookup(const decltype(Resolution::locals)::const_iterator local) const {
+  if (m_counters == nullptr)
+    return;
+
+  if (local != m_resolution.locals.end())
+    m_counters->lookup(local->second);
+  else
+    ++m_counters->globalLookups;
 }
 }
@@ -0,0 +1,483 @@
+#include "lox/interpreter/machine.h"
+#include "lox/interpreter/interpreter.h"
+#include "lox/callable/class/class.h"
+#include "lox/callable/class/instance.h"
+#include "lox/callable/function/function.h"
+#include "lox/callable/native/native.h"
+#include "lox/error/error.h"
+#include "lox/memory/memory.h"
+
+#include <boost/variant/apply_visitor.hpp>
+#include <boost/variant/get.hpp>
+
+#include <algorithm>
+#include <any>
+#include <iterator>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace lox {
+
+std::size_t Machine::Statistics::bytesPerFrame() const {
+  return peakFrames == 0 ? 0 : peakBytes / peakFrames;
+}
+
+Machine::Machine(Interpreter &interpreter, const std::size_t maxDepth)
+    : m_interpreter(interpreter)
+    , m_maxDepth(maxDepth) {}
+
+void Machine::run(const std::vector<Stmt> &statements) {
+  push(Operation::Sequence, &statements);
+  resume();
+}
+
+// The bottom frame has no caller environment to go back to; the coroutine running the call restores its own. Traced,
+// the call spans the life of the coroutine, from its creation to its end.
+void Machine::start(const Function &function) {
+  m_frames.push_back(Frame{nullptr, 0, 0, 0, {}, &function.declaration(),
+                           m_interpreter.m_tracer != nullptr ? Tracer::Clock::now() : Tracer::Clock::time_point{}});
+  push(Operation::ExitFunction, &function.declaration());
+  push(Operation::Sequence, &function.body());
+}
+
+// The frames a run leaves behind by yielding or throwing are dropped from the call stack; a yield only happens in the
+// bottom frame, which the coroutine records itself.
+bool Machine::resume() {
+  const CallStack::Scope scope{m_interpreter.m_callStack};
+  m_suspended = false;
+  m_parked = false;
+
+  while (!m_tasks.empty() && !m_suspended) {
+    const Task task = m_tasks.back();
+    m_tasks.pop_back();
+    step(task);
+  }
+
+  return m_suspended;
+}
+
+std::any Machine::take() {
+  return pop();
+}
+
+bool Machine::isParked() const {
+  return m_parked;
+}
+
+void Machine::environments(std::vector<const Environment *> &roots) const {
+  for (const Frame &frame : m_frames)
+    if (frame.caller != nullptr)
+      roots.push_back(frame.caller.get());
+  for (const std::shared_ptr<Environment> &environment : m_environments)
+    if (environment != nullptr)
+      roots.push_back(environment.get());
+}
+
+const Machine::Statistics &Machine::statistics() const {
+  return m_statistics;
+}
+
+void Machine::step(const Task task) {
+  switch (task.operation) {
+    using enum Operation;
+
+    case Execute: {
+      const auto &stmt = *static_cast<const Stmt *>(task.node);
+      if constexpr (Interpreter::countsStatements)
+        m_interpreter.countStatement(stmt);
+      if (stmt.which() != 0)
+        boost::apply_visitor(*this, stmt);
+      break;
+    }
+
+    case Evaluate: {
+      const auto &expr = *static_cast<const Expr *>(task.node);
+      if (expr.which() != 0)
+        boost::apply_visitor(*this, expr);
+      else
+        m_values.emplace_back(Literal{nullptr});
+      break;
+    }
+
+    case Sequence: {
+      const auto &statements = *static_cast<const std::vector<Stmt> *>(task.node);
+      if (task.count + 1 < statements.size())
+        push(Sequence, &statements, task.count + 1);
+      if (task.count < statements.size())
+        push(Execute, &statements[task.count]);
+      break;
+    }
+
+    case ExitBlock:
+      m_interpreter.m_environment = std::move(m_environments.back());
+      m_environments.pop_back();
+      break;
+
+    case ExitFunction:
+      returnValue(Literal{nullptr});
+      break;
+
+    case Discard:
+      m_values.pop_back();
+      break;
+
+    case Print:
+      m_interpreter.m_statementVisitor.print(pop());
+      break;
+
+    case Define:
+      m_interpreter.m_environment->define(static_cast<const VariableStmt *>(task.node)->name, pop());
+      break;
+
+    case Return:
+      returnValue(pop());
+      break;
+
+    case Yield:
+      m_suspended = true;
+      break;
+
+    case TailCall: {
+      const auto &expr = *static_cast<const CallExpr *>(task.node);
+      if (callNative(task)) {
+        if (!m_parked)
+          returnValue(pop());
+        break;
+      }
+
+      std::vector<std::any> arguments = popArguments(task.count);
+      const std::any callee = pop();
+
+      // The frame goes first, so the callee takes its place instead of stacking on top of it.
+      if (const auto *function = std::any_cast<Function>(&callee); function != nullptr && !function->isCoroutine() && !m_frames.empty()) {
+        Interpreter::ExpressionVisitor::checkArity(expr, function->arity(), arguments.size());
+        leave();
+        enter(expr, *function, arguments);
+      } else {
+        call(expr, callee, std::move(arguments));
+        returnValue(pop());
+      }
+      break;
+    }
+
+    case Branch: {
+      const auto &stmt = *static_cast<const IfStmt *>(task.node);
+      if (Interpreter::ExpressionVisitor::isTruthy(pop()))
+        push(Execute, &stmt.thenBranch);
+      else if (stmt.elseBranch.which() != 0)
+        push(Execute, &stmt.elseBranch);
+      break;
+    }
+
+    case Loop: {
+      const auto &stmt = *static_cast<const WhileStmt *>(task.node);
+      push(LoopCondition, &stmt);
+      push(Evaluate, &stmt.condition);
+      break;
+    }
+
+    case LoopCondition: {
+      const auto &stmt = *static_cast<const WhileStmt *>(task.node);
+      if (Interpreter::ExpressionVisitor::isTruthy(pop())) {
+        push(Loop, &stmt);
+        push(Execute, &stmt.body);
+        m_interpreter.m_statementVisitor.checkpoint(stmt.keyword);
+      }
+      break;
+    }
+
+    case Assign:
+      m_interpreter.assignVariable(static_cast<const AssignExpr *>(task.node)->name, m_values.back());
+      break;
+
+    case Unary: {
+      const auto &expr = *static_cast<const UnaryExpr *>(task.node);
+      m_values.back() = m_interpreter.m_expressionVisitor.unary(expr, m_values.back());
+      break;
+    }
+
+    case Binary: {
+      const auto &expr = *static_cast<const BinaryExpr *>(task.node);
+      const std::any right = pop();
+      m_values.back() = m_interpreter.m_expressionVisitor.binary(expr, m_values.back(), right);
+      break;
+    }
+
+    case Logical: {
+      const auto &expr = *static_cast<const LogicalExpr *>(task.node);
+      if (!Interpreter::ExpressionVisitor::isShortCircuit(expr, m_values.back())) {
+        m_values.pop_back();
+        push(Evaluate, &expr.right);
+      }
+      break;
+    }
+
+    case Call: {
+      const auto &expr = *static_cast<const CallExpr *>(task.node);
+      if (callNative(task))
+        break;
+
+      std::vector<std::any> arguments = popArguments(task.count);
+      const std::any callee = pop();
+      call(expr, callee, std::move(arguments));
+      break;
+    }
+
+    case Get:
+      m_values.back() = m_interpreter.m_expressionVisitor.get(*static_cast<const GetExpr *>(task.node), m_values.back());
+      break;
+
+    case Set: {
+      std::any value = pop();
+      m_interpreter.m_expressionVisitor.set(*static_cast<const SetExpr *>(task.node), m_values.back(), value);
+      m_values.back() = std::move(value);
+      break;
+    }
+  }
+}
+
+void Machine::operator()(const BlockStmt &stmt) {
+  m_environments.push_back(m_interpreter.m_environment);
+  m_interpreter.m_environment = memory::makeShared<Environment>(memory::Tag::Environments, m_interpreter.m_environment);
+
+  push(Operation::ExitBlock, &stmt);
+  push(Operation::Sequence, &stmt.statements);
+}
+
+void Machine::operator()(const ClassStmt &stmt) {
+  m_interpreter.m_statementVisitor(stmt);
+}
+
+void Machine::operator()(const ExpressionStmt &stmt) {
+  push(Operation::Discard, &stmt);
+  push(Operation::Evaluate, &stmt.expression);
+}
+
+void Machine::operator()(const FunctionStmt &stmt) {
+  m_interpreter.m_statementVisitor(stmt);
+}
+
+void Machine::operator()(const IfStmt &stmt) {
+  push(Operation::Branch, &stmt);
+  push(Operation::Evaluate, &stmt.condition);
+}
+
+void Machine::operator()(const PrintStmt &stmt) {
+  push(Operation::Print, &stmt);
+  push(Operation::Evaluate, &stmt.expression);
+}
+
+void Machine::operator()(const ReturnStmt &stmt) {
+  if (m_interpreter.m_resolution.tailCalls.contains(&stmt)) {
+    const auto &call = boost::get<CallExpr>(stmt.value);
+    push(Operation::TailCall, &call, static_cast<std::uint32_t>(call.arguments.size()));
+    for (auto argument = call.arguments.rbegin(); argument != call.arguments.rend(); ++argument)
+      push(Operation::Evaluate, &*argument);
+    push(Operation::Evaluate, &call.callee);
+    return;
+  }
+
+  push(Operation::Return, &stmt);
+  push(Operation::Evaluate, &stmt.value);
+}
+
+void Machine::operator()(const VariableStmt &stmt) {
+  push(Operation::Define, &stmt);
+  push(Operation::Evaluate, &stmt.initializer);
+}
+
+void Machine::operator()(const WhileStmt &stmt) {
+  push(Operation::Loop, &stmt);
+}
+
+void Machine::operator()(const YieldStmt &stmt) {
+  push(Operation::Yield, &stmt);
+  push(Operation::Evaluate, &stmt.value);
+}
+
+void Machine::operator()(const AssignExpr &expr) {
+  push(Operation::Assign, &expr);
+  push(Operation::Evaluate, &expr.value);
+}
+
+void Machine::operator()(const BinaryExpr &expr) {
+  push(Operation::Binary, &expr);
+  push(Operation::Evaluate, &expr.right);
+  push(Operation::Evaluate, &expr.left);
+}
+
+void Machine::operator()(const CallExpr &expr) {
+  push(Operation::Call, &expr, static_cast<std::uint32_t>(expr.arguments.size()));
+  for (auto argument = expr.arguments.rbegin(); argument != expr.arguments.rend(); ++argument)
+    push(Operation::Evaluate, &*argument);
+  push(Operation::Evaluate, &expr.callee);
+}
+
+void Machine::operator()(const GetExpr &expr) {
+  push(Operation::Get, &expr);
+  push(Operation::Evaluate, &expr.object);
+}
+
+void Machine::operator()(const GroupingExpr &expr) {
+  push(Operation::Evaluate, &expr.expression);
+}
+
+void Machine::operator()(const LiteralExpr &expr) {
+  m_values.emplace_back(expr.literal);
+}
+
+void Machine::operator()(const LogicalExpr &expr) {
+  push(Operation::Logical, &expr);
+  push(Operation::Evaluate, &expr.left);
+}
+
+void Machine::operator()(const SetExpr &expr) {
+  push(Operation::Set, &expr);
+  push(Operation::Evaluate, &expr.value);
+  push(Operation::Evaluate, &expr.object);
+}
+
+void Machine::operator()(const UnaryExpr &expr) {
+  push(Operation::Unary, &expr);
+  push(Operation::Evaluate, &expr.right);
+}
+
+void Machine::operator()(const VariableExpr &expr) {
+  m_values.push_back(m_interpreter.lookUpVariable(expr.name));
+}
+
+void Machine::operator()(const ThisExpr &expr) {
+  m_values.push_back(m_interpreter.m_expressionVisitor(expr));
+}
+
+void Machine::operator()(const SuperExpr &expr) {
+  m_values.push_back(m_interpreter.m_expressionVisitor(expr));
+}
+
+void Machine::operator()(const auto & /*unused*/) {
+  m_values.emplace_back(Literal{nullptr});
+}
+
+void Machine::push(const Operation operation, const void *node, const std::uint32_t count) {
+  m_tasks.push_back(Task{operation, count, node});
+}
+
+std::any Machine::pop() {
+  std::any value = std::move(m_values.back());
+  m_values.pop_back();
+  return value;
+}
+
+std::vector<std::any> Machine::popArguments(const std::size_t count) {
+  const auto first = m_values.end() - static_cast<std::ptrdiff_t>(count);
+  std::vector<std::any> arguments(std::make_move_iterator(first), std::make_move_iterator(m_values.end()));
+  m_values.erase(first, m_values.end());
+  return arguments;
+}
+
+// A native callee reads its arguments where they are on the value stack; they and the callee are then replaced by the
+// result. Returns false if the callee isn't native. A native that parks the coroutine leaves them where they are and
+// the call scheduled again, under the nil the coroutine hands out.
+bool Machine::callNative(const Task task) {
+  const auto &expr = *static_cast<const CallExpr *>(task.node);
+  const std::size_t count = task.count;
+  const auto callee = m_values.end() - static_cast<std::ptrdiff_t>(count) - 1;
+  const auto *native = std::any_cast<Native>(&*callee);
+  if (native == nullptr)
+    return false;
+
+  Interpreter::ExpressionVisitor::checkArity(expr, *native, count);
+  std::any result = Interpreter::ExpressionVisitor::invokeNative(expr, *native, std::span<const std::any>(&*(callee + 1), count));
+  if (result.type() == typeid(Parked)) {
+    push(task.operation, task.node, task.count);
+    m_values.emplace_back(Literal{nullptr});
+    m_suspended = true;
+    m_parked = true;
+    return true;
+  }
+
+  m_values.erase(callee, m_values.end());
+  m_values.push_back(std::move(result));
+  return true;
+}
+
+// Functions get a frame of their own, and so does the initializer of a class. A function that yields only creates its
+// coroutine.
+void Machine::call(const CallExpr &expr, const std::any &callee, std::vector<std::any> arguments) {
+  if (const auto *function = std::any_cast<Function>(&callee)) {
+    Interpreter::ExpressionVisitor::checkArity(expr, function->arity(), arguments.size());
+    if (function->isCoroutine())
+      m_values.push_back(m_interpreter.m_statementVisitor.coroutine(*function, arguments));
+    else
+      enter(expr, *function, arguments);
+  } else if (const auto *klass = std::any_cast<Class>(&callee)) {
+    Interpreter::ExpressionVisitor::checkArity(expr, klass->arity(), arguments.size());
+
+    auto instance = memory::makeShared<Instance>(memory::Tag::Objects, *klass, m_interpreter.m_instances.get());
+    if (Tracer *tracer = m_interpreter.m_tracer)
+      tracer->allocation(Tracer::Allocation::Instance);
+    if (const auto initializer = klass->findMethod("init"))
+      enter(expr, initializer->bind(instance), arguments);
+    else
+      m_values.emplace_back(std::move(instance));
+  } else {
+    throw RuntimeError(expr.paren, "Can only call functions and classes.");
+  }
+}
+
+void Machine::enter(const CallExpr &expr, const Function &function, const std::vector<std::any> &arguments) {
+  if (m_frames.size() >= m_maxDepth)
+    throw RuntimeError(expr.paren, "Stack overflow.");
+  m_interpreter.m_statementVisitor.checkpoint(function.declaration().name);
+
+  m_frames.push_back(Frame{m_interpreter.m_environment, m_tasks.size(), m_values.size(), m_environments.size(),
+                           function.isInitializer() ? function.instance() : std::any{}, &function.declaration(),
+                           m_interpreter.m_tracer != nullptr ? Tracer::Clock::now() : Tracer::Clock::time_point{}});
+  m_interpreter.m_environment = function.environment(arguments);
+  if (CallStack *callStack = m_interpreter.m_callStack)
+    callStack->push(&function.declaration());
+  if (Interpreter::Counters *counters = m_interpreter.m_counters)
+    ++counters->calls;
+
+  push(Operation::ExitFunction, &expr);
+  push(Operation::Sequence, &function.body());
+
+  if (m_frames.size() > m_statistics.peakFrames) {
+    m_statistics.peakFrames = m_frames.size();
+    m_statistics.peakTasks = std::max(m_statistics.peakTasks, m_tasks.size());
+    m_statistics.peakValues = std::max(m_statistics.peakValues, m_values.size());
+    m_statistics.peakBytes = m_frames.size() * sizeof(Frame) + m_tasks.size() * sizeof(Task) + m_values.size() * sizeof(std::any) +
+                             m_environments.size() * sizeof(std::shared_ptr<Environment>);
+  }
+}
+
+// Drops whatever the returning function still had pending.
+void Machine::leave() {
+  Frame &frame = m_frames.back();
+  m_tasks.resize(frame.tasks);
+  m_values.resize(frame.values);
+  m_environments.resize(frame.environments);
+  m_interpreter.m_environment = std::move(frame.caller);
+  if (Tracer *tracer = m_interpreter.m_tracer)
+    tracer->complete(frame.function->name.lexeme, Tracer::Category::Call, frame.started, Tracer::Clock::now());
+  m_frames.pop_back();
+  if (CallStack *callStack = m_interpreter.m_callStack)
+    callStack->pop();
+}
+
+void Machine::returnValue(std::any value) {
+  if (m_frames.empty()) { // only reachable past a resolution error
+    m_tasks.clear();
+    return;
+  }
+
+  if (m_frames.back().instance.has_value())
+    value = m_frames.back().instance;
+
+  leave();
+  m_values.push_back(std::move(value));
+}
+
+}
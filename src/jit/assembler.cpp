@@ -0,0 +1,199 @@
+#include "lox/jit/assembler.h"
+
+#include <bit>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <vector>
+
+namespace {
+
+constexpr std::uint8_t rex_w = 0x48;
+
+std::uint8_t reg(const lox::Xmm xmm) {
+  return static_cast<std::uint8_t>(xmm);
+}
+
+// ModRM for a register-register form.
+std::uint8_t direct(const lox::Xmm to, const lox::Xmm from) {
+  return static_cast<std::uint8_t>(0xC0U | (reg(to) << 3U) | reg(from));
+}
+
+}
+
+namespace lox {
+
+Assembler::Label Assembler::newLabel() {
+  m_labels.push_back(unbound);
+  return m_labels.size() - 1;
+}
+
+void Assembler::bind(const Label label) {
+  m_labels[label] = m_code.size();
+}
+
+std::size_t Assembler::offset(const Label label) const {
+  return m_labels[label];
+}
+
+std::size_t Assembler::enter() {
+  emit({0x55});                   // push rbp
+  emit({rex_w, 0x89, 0xE5});      // mov rbp, rsp
+  emit({rex_w, 0x81, 0xEC});      // sub rsp, imm32
+  const std::size_t position = m_code.size();
+  emit32(0);
+  return position;
+}
+
+void Assembler::setFrameSize(const std::size_t position, const std::uint32_t bytes) {
+  for (std::size_t i = 0; i < 4; ++i)
+    m_code[position + i] = static_cast<std::uint8_t>(bytes >> (8 * i));
+}
+
+void Assembler::leave() {
+  emit({rex_w, 0x89, 0xEC}); // mov rsp, rbp
+  emit({0x5D});              // pop rbp
+}
+
+void Assembler::ret() {
+  emit({0xC3});
+}
+
+// movsd xmm, [rbp + disp32]
+void Assembler::loadLocal(const Xmm to, const std::int32_t offset) {
+  emit({0xF2, 0x0F, 0x10, static_cast<std::uint8_t>(0x85U | (reg(to) << 3U))});
+  emit32(static_cast<std::uint32_t>(offset));
+}
+
+// movsd [rbp + disp32], xmm
+void Assembler::storeLocal(const std::int32_t offset, const Xmm from) {
+  emit({0xF2, 0x0F, 0x11, static_cast<std::uint8_t>(0x85U | (reg(from) << 3U))});
+  emit32(static_cast<std::uint32_t>(offset));
+}
+
+// movsd xmm, [rdi + 8 * index]
+void Assembler::loadArgument(const Xmm to, const std::uint8_t index) {
+  assert(index < 16);
+  emit({0xF2, 0x0F, 0x10, static_cast<std::uint8_t>(0x47U | (reg(to) << 3U)), static_cast<std::uint8_t>(8 * index)});
+}
+
+// sub rsp, 8; movsd [rsp], xmm
+void Assembler::push(const Xmm from) {
+  emit({rex_w, 0x83, 0xEC, 0x08});
+  emit({0xF2, 0x0F, 0x11, static_cast<std::uint8_t>(0x04U | (reg(from) << 3U)), 0x24});
+}
+
+// movsd xmm, [rsp]; add rsp, 8
+void Assembler::pop(const Xmm to) {
+  emit({0xF2, 0x0F, 0x10, static_cast<std::uint8_t>(0x04U | (reg(to) << 3U)), 0x24});
+  emit({rex_w, 0x83, 0xC4, 0x08});
+}
+
+// mov rax, imm64; movq xmm, rax
+void Assembler::loadConstant(const Xmm to, const double value) {
+  emit({rex_w, 0xB8});
+  emit64(std::bit_cast<std::uint64_t>(value));
+  emit({0x66, rex_w, 0x0F, 0x6E, direct(to, Xmm::Xmm0)});
+}
+
+// movapd to, from
+void Assembler::move(const Xmm to, const Xmm from) {
+  emit({0x66, 0x0F, 0x28, direct(to, from)});
+}
+
+// addsd/subsd/mulsd/divsd to, from
+void Assembler::arithmetic(const Arithmetic operation, const Xmm to, const Xmm from) {
+  emit({0xF2, 0x0F, static_cast<std::uint8_t>(operation), direct(to, from)});
+}
+
+// Flips the sign bit: xorpd value, -0.0
+void Assembler::negate(const Xmm value, const Xmm scratch) {
+  loadConstant(scratch, -0.0);
+  emit({0x66, 0x0F, 0x57, direct(value, scratch)});
+}
+
+// ucomisd left, right
+void Assembler::compare(const Xmm left, const Xmm right) {
+  emit({0x66, 0x0F, 0x2E, direct(left, right)});
+}
+
+void Assembler::jump(const Label target) {
+  emit({0xE9});
+  emitRelative(target);
+}
+
+void Assembler::jumpIf(const Condition condition, const Label target) {
+  emit({0x0F, static_cast<std::uint8_t>(0x80U | static_cast<std::uint8_t>(condition))});
+  emitRelative(target);
+}
+
+void Assembler::call(const Label target) {
+  emit({0xE8});
+  emitRelative(target);
+}
+
+// mov rax, imm64
+void Assembler::loadAddress(const void *address) {
+  emit({rex_w, 0xB8});
+  emit64(reinterpret_cast<std::uintptr_t>(address));
+}
+
+// inc qword [rax]
+void Assembler::increment() {
+  emit({rex_w, 0xFF, 0x00});
+}
+
+// dec qword [rax]
+void Assembler::decrement() {
+  emit({rex_w, 0xFF, 0x08});
+}
+
+// cmp qword [rax], imm32
+void Assembler::compareWith(const std::int32_t value) {
+  emit({rex_w, 0x81, 0x38});
+  emit32(static_cast<std::uint32_t>(value));
+}
+
+// mov byte [rax], 1
+void Assembler::setFlag() {
+  emit({0xC6, 0x00, 0x01});
+}
+
+// cmp byte [rax], 0
+void Assembler::testFlag() {
+  emit({0x80, 0x38, 0x00});
+}
+
+std::vector<std::uint8_t> Assembler::finish() {
+  for (const auto &[position, target] : m_fixups) {
+    assert(m_labels[target] != unbound);
+    const auto displacement = static_cast<std::uint32_t>(static_cast<std::int64_t>(m_labels[target]) - static_cast<std::int64_t>(position + 4));
+    for (std::size_t i = 0; i < 4; ++i)
+      m_code[position + i] = static_cast<std::uint8_t>(displacement >> (8 * i));
+  }
+
+  m_fixups.clear();
+  return m_code;
+}
+
+void Assembler::emit(std::initializer_list<std::uint8_t> bytes) {
+  m_code.insert(m_code.end(), bytes);
+}
+
+void Assembler::emit32(const std::uint32_t value) {
+  for (std::size_t i = 0; i < 4; ++i)
+    m_code.push_back(static_cast<std::uint8_t>(value >> (8 * i)));
+}
+
+void Assembler::emit64(const std::uint64_t value) {
+  for (std::size_t i = 0; i < 8; ++i)
+    m_code.push_back(static_cast<std::uint8_t>(value >> (8 * i)));
+}
+
+void Assembler::emitRelative(const Label target) {
+  m_fixups.emplace_back(m_code.size(), target);
+  emit32(0);
+}
+
+}
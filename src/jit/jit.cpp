@@ -0,0 +1,524 @@
+#include "lox/jit/jit.h"
+#include "lox/jit/assembler.h"
+#include "lox/primitives/literal.h"
+
+#include <boost/variant/apply_visitor.hpp>
+#include <boost/variant/get.hpp>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <any>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+
+namespace {
+
+using namespace lox;
+
+using NativeFunction = double (*)(const double *arguments);
+
+static_assert(sizeof(std::atomic<bool>) == 1 && std::atomic<bool>::is_always_lock_free, "the flag is tested as a byte");
+
+// Slot i of a frame lives at rbp - 8 * (i + 1).
+std::int32_t frameOffset(const std::size_t slot) {
+  return -8 * static_cast<std::int32_t>(slot + 1);
+}
+
+Xmm argumentRegister(const std::size_t index) {
+  return static_cast<Xmm>(index);
+}
+
+// Translates one function. Every value is a double held in xmm0 while an expression is evaluated; operands waiting for
+// the other side of a binary operator are pushed to the machine stack. Booleans never materialize: comparisons,
+// `!`, `and` and `or` are only accepted where a condition is expected and compile to jumps. Each visit returns false
+// for a construct the compiler doesn't handle, which rejects the whole function.
+class FunctionCompiler : public boost::static_visitor<bool> {
+private:
+  const FunctionStmt &m_function;
+  std::int64_t *m_depth;
+  std::uint8_t *m_bailout;
+  const std::atomic<bool> *m_interrupted;
+
+  Assembler m_assembler;
+  std::vector<std::unordered_map<std::string, std::size_t>> m_scopes;
+  std::size_t m_slots = 0;
+
+  Assembler::Label m_body = m_assembler.newLabel();
+  Assembler::Label m_exit = m_assembler.newLabel();
+  Assembler::Label m_bail = m_assembler.newLabel();
+  Assembler::Label m_entry = m_assembler.newLabel();
+
+public:
+  FunctionCompiler(const FunctionStmt &function, std::int64_t *depth, std::uint8_t *bailout, const std::atomic<bool> *interrupted)
+      : m_function(function)
+      , m_depth(depth)
+      , m_bailout(bailout)
+      , m_interrupted(interrupted) {}
+
+  // The body follows the SysV convention for double(double...), the entry stub adapts it to NativeFunction.
+  bool compile() {
+    if (m_function.params.size() > Jit::maxArity)
+      return false;
+
+    m_assembler.bind(m_body);
+    const std::size_t frame = m_assembler.enter();
+
+    m_assembler.loadAddress(m_depth);
+    m_assembler.increment();
+    m_assembler.compareWith(Jit::maxDepth);
+    m_assembler.jumpIf(Condition::Greater, m_bail);
+    pollInterrupt();
+
+    m_scopes.emplace_back();
+    for (std::size_t i = 0; i < m_function.params.size(); ++i)
+      m_assembler.storeLocal(frameOffset(declare(m_function.params[i])), argumentRegister(i));
+
+    for (const Stmt &statement : m_function.body)
+      if (!boost::apply_visitor(*this, statement))
+        return false;
+
+    // Falling off the end returns nil, which native code has no way to represent.
+    m_assembler.bind(m_bail);
+    m_assembler.loadAddress(m_bailout);
+    m_assembler.setFlag();
+
+    m_assembler.bind(m_exit);
+    m_assembler.loadAddress(m_depth);
+    m_assembler.decrement();
+    m_assembler.leave();
+    m_assembler.ret();
+    m_assembler.setFrameSize(frame, static_cast<std::uint32_t>((m_slots * 8 + 15) / 16 * 16));
+
+    m_assembler.bind(m_entry);
+    m_assembler.enter();
+    for (std::size_t i = 0; i < m_function.params.size(); ++i)
+      m_assembler.loadArgument(argumentRegister(i), static_cast<std::uint8_t>(i));
+    m_assembler.call(m_body);
+    m_assembler.leave();
+    m_assembler.ret();
+
+    return true;
+  }
+
+  std::vector<std::uint8_t> code() {
+    return m_assembler.finish();
+  }
+
+  std::size_t entry() const {
+    return m_assembler.offset(m_entry);
+  }
+
+  bool operator()(const BlockStmt &stmt) {
+    m_scopes.emplace_back();
+    for (const Stmt &statement : stmt.statements)
+      if (!boost::apply_visitor(*this, statement))
+        return false;
+    m_scopes.pop_back();
+    return true;
+  }
+
+  bool operator()(const ExpressionStmt &stmt) {
+    return value(stmt.expression);
+  }
+
+  bool operator()(const IfStmt &stmt) {
+    const Assembler::Label otherwise = m_assembler.newLabel();
+    const Assembler::Label end = m_assembler.newLabel();
+
+    if (!condition(stmt.condition, otherwise, false) || !boost::apply_visitor(*this, stmt.thenBranch))
+      return false;
+    m_assembler.jump(end);
+
+    m_assembler.bind(otherwise);
+    if (!boost::apply_visitor(*this, stmt.elseBranch))
+      return false;
+    m_assembler.bind(end);
+    return true;
+  }
+
+  bool operator()(const ReturnStmt &stmt) {
+    if (!value(stmt.value))
+      return false;
+
+    m_assembler.jump(m_exit);
+    return true;
+  }
+
+  bool operator()(const VariableStmt &stmt) {
+    if (!value(stmt.initializer))
+      return false;
+
+    m_assembler.storeLocal(frameOffset(declare(stmt.name)), Xmm::Xmm0);
+    return true;
+  }
+
+  bool operator()(const WhileStmt &stmt) {
+    const Assembler::Label loop = m_assembler.newLabel();
+    const Assembler::Label end = m_assembler.newLabel();
+
+    m_assembler.bind(loop);
+    if (!condition(stmt.condition, end, false) || !boost::apply_visitor(*this, stmt.body))
+      return false;
+    pollInterrupt();
+    m_assembler.jump(loop);
+    m_assembler.bind(end);
+    return true;
+  }
+
+  bool operator()(const AssignExpr &expr) {
+    const std::optional<std::size_t> slot = lookup(expr.name.lexeme);
+    if (!slot || !value(expr.value))
+      return false;
+
+    m_assembler.storeLocal(frameOffset(*slot), Xmm::Xmm0);
+    return true;
+  }
+
+  bool operator()(const BinaryExpr &expr) {
+    Arithmetic operation{};
+    switch (expr.op.kind) {
+      using enum TokenKind;
+
+      case Plus: operation = Arithmetic::Add; break;
+      case Minus: operation = Arithmetic::Subtract; break;
+      case Star: operation = Arithmetic::Multiply; break;
+      case Slash: operation = Arithmetic::Divide; break;
+      default: return false;
+    }
+
+    if (!operands(expr))
+      return false;
+
+    m_assembler.arithmetic(operation, Xmm::Xmm0, Xmm::Xmm1);
+    return true;
+  }
+
+  bool operator()(const CallExpr &expr) {
+    const auto *callee = boost::get<VariableExpr>(&expr.callee);
+    if (callee == nullptr || callee->name.lexeme != m_function.name.lexeme || lookup(callee->name.lexeme))
+      return false;
+
+    if (expr.arguments.size() != m_function.params.size())
+      return false;
+
+    for (const Expr &argument : expr.arguments) {
+      if (!value(argument))
+        return false;
+      m_assembler.push(Xmm::Xmm0);
+    }
+
+    for (std::size_t i = expr.arguments.size(); i-- > 0;)
+      m_assembler.pop(argumentRegister(i));
+
+    m_assembler.call(m_body);
+
+    // A callee that gave up leaves the flag set; unwind all the way out.
+    m_assembler.loadAddress(m_bailout);
+    m_assembler.testFlag();
+    m_assembler.jumpIf(Condition::NotEqual, m_bail);
+    return true;
+  }
+
+  bool operator()(const GroupingExpr &expr) {
+    return value(expr.expression);
+  }
+
+  bool operator()(const LiteralExpr &expr) {
+    const auto *number = std::get_if<double>(&expr.literal.data());
+    if (number == nullptr)
+      return false;
+
+    m_assembler.loadConstant(Xmm::Xmm0, *number);
+    return true;
+  }
+
+  bool operator()(const UnaryExpr &expr) {
+    if (expr.op.kind != TokenKind::Minus || !value(expr.right))
+      return false;
+
+    m_assembler.negate(Xmm::Xmm0, Xmm::Xmm1);
+    return true;
+  }
+
+  bool operator()(const VariableExpr &expr) {
+    const std::optional<std::size_t> slot = lookup(expr.name.lexeme);
+    if (!slot)
+      return false;
+
+    m_assembler.loadLocal(Xmm::Xmm0, frameOffset(*slot));
+    return true;
+  }
+
+  // An absent else branch.
+  bool operator()(const blank & /*unused*/) {
+    return true;
+  }
+
+  bool operator()(const auto & /*unused*/) {
+    return false;
+  }
+
+private:
+  // Gives up once the interpreter is interrupted. A relaxed load of an atomic bool is a plain byte load on x86-64.
+  void pollInterrupt() {
+    m_assembler.loadAddress(m_interrupted);
+    m_assembler.testFlag();
+    m_assembler.jumpIf(Condition::NotEqual, m_bail);
+  }
+
+  std::size_t declare(const Token &name) {
+    m_scopes.back().insert_or_assign(name.lexeme, m_slots);
+    return m_slots++;
+  }
+
+  std::optional<std::size_t> lookup(const std::string &name) const {
+    for (auto scope = m_scopes.rbegin(); scope != m_scopes.rend(); ++scope)
+      if (const auto it = scope->find(name); it != scope->end())
+        return it->second;
+    return std::nullopt;
+  }
+
+  // Evaluates an expression into xmm0.
+  bool value(const Expr &expr) {
+    return expr.which() != 0 && boost::apply_visitor(*this, expr);
+  }
+
+  // Leaves the left operand in xmm0 and the right one in xmm1.
+  bool operands(const BinaryExpr &expr) {
+    if (!value(expr.left))
+      return false;
+    m_assembler.push(Xmm::Xmm0);
+
+    if (!value(expr.right))
+      return false;
+    m_assembler.move(Xmm::Xmm1, Xmm::Xmm0);
+    m_assembler.pop(Xmm::Xmm0);
+    return true;
+  }
+
+  // Jumps to `target` if the truthiness of the condition equals `jumpIfTrue`, falls through otherwise. ucomisd reports
+  // an unordered (NaN) comparison as "below" and "equal" with the parity flag set, so every comparison is arranged to
+  // come out false for NaN, as it does in the interpreter.
+  bool condition(const Expr &expr, const Assembler::Label target, const bool jumpIfTrue) {
+    if (const auto *grouping = boost::get<GroupingExpr>(&expr))
+      return condition(grouping->expression, target, jumpIfTrue);
+
+    if (const auto *unary = boost::get<UnaryExpr>(&expr); unary != nullptr && unary->op.kind == TokenKind::Bang)
+      return condition(unary->right, target, !jumpIfTrue);
+
+    if (const auto *logical = boost::get<LogicalExpr>(&expr)) {
+      // `and` jumps when either side is false, `or` when either side is true.
+      const bool shortCircuitsOn = logical->op.kind == TokenKind::Or;
+      if (shortCircuitsOn == jumpIfTrue)
+        return condition(logical->left, target, jumpIfTrue) && condition(logical->right, target, jumpIfTrue);
+
+      const Assembler::Label skip = m_assembler.newLabel();
+      if (!condition(logical->left, skip, shortCircuitsOn) || !condition(logical->right, target, jumpIfTrue))
+        return false;
+      m_assembler.bind(skip);
+      return true;
+    }
+
+    if (const auto *literal = boost::get<LiteralExpr>(&expr)) {
+      if (literal->literal.isTruthy() == jumpIfTrue)
+        m_assembler.jump(target);
+      return true;
+    }
+
+    if (const auto *binary = boost::get<BinaryExpr>(&expr))
+      if (const std::optional<bool> compiled = comparison(*binary, target, jumpIfTrue))
+        return *compiled;
+
+    // Any number is truthy; the value is only computed for its side effects.
+    if (!value(expr))
+      return false;
+    if (jumpIfTrue)
+      m_assembler.jump(target);
+    return true;
+  }
+
+  std::optional<bool> comparison(const BinaryExpr &expr, const Assembler::Label target, const bool jumpIfTrue) {
+    switch (expr.op.kind) {
+      using enum TokenKind;
+
+      case Greater:
+      case GreaterEqual:
+      case Less:
+      case LessEqual:
+      case EqualEqual:
+      case BangEqual: break;
+      default: return std::nullopt;
+    }
+
+    if (!operands(expr))
+      return false;
+
+    switch (expr.op.kind) {
+      using enum TokenKind;
+
+      case Greater:
+      case Less:
+        expr.op.kind == Greater ? m_assembler.compare(Xmm::Xmm0, Xmm::Xmm1) : m_assembler.compare(Xmm::Xmm1, Xmm::Xmm0);
+        m_assembler.jumpIf(jumpIfTrue ? Condition::Above : Condition::BelowEqual, target);
+        break;
+
+      case GreaterEqual:
+      case LessEqual:
+        expr.op.kind == GreaterEqual ? m_assembler.compare(Xmm::Xmm0, Xmm::Xmm1) : m_assembler.compare(Xmm::Xmm1, Xmm::Xmm0);
+        m_assembler.jumpIf(jumpIfTrue ? Condition::AboveEqual : Condition::Below, target);
+        break;
+
+      case EqualEqual:
+      case BangEqual: {
+        m_assembler.compare(Xmm::Xmm0, Xmm::Xmm1);
+
+        // equal: ZF set and PF clear
+        if ((expr.op.kind == EqualEqual) == jumpIfTrue) {
+          const Assembler::Label skip = m_assembler.newLabel();
+          m_assembler.jumpIf(Condition::Parity, skip);
+          m_assembler.jumpIf(Condition::Equal, target);
+          m_assembler.bind(skip);
+        } else {
+          m_assembler.jumpIf(Condition::Parity, target);
+          m_assembler.jumpIf(Condition::NotEqual, target);
+        }
+        break;
+      }
+
+      default:;
+    }
+
+    return true;
+  }
+};
+
+}
+
+namespace lox {
+
+// A read-only, executable copy of the generated code.
+class Jit::Code {
+private:
+  void *m_memory = nullptr;
+  std::size_t m_size = 0;
+  NativeFunction m_function = nullptr;
+
+public:
+  Code(const std::vector<std::uint8_t> &code, const std::size_t entry) {
+    const auto page = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    const std::size_t size = (code.size() + page - 1) / page * page;
+
+    void *memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED)
+      return;
+
+    std::memcpy(memory, code.data(), code.size());
+    if (mprotect(memory, size, PROT_READ | PROT_EXEC) != 0) {
+      munmap(memory, size);
+      return;
+    }
+
+    m_memory = memory;
+    m_size = size;
+    m_function = reinterpret_cast<NativeFunction>(static_cast<std::uint8_t *>(memory) + entry);
+  }
+
+  ~Code() {
+    if (m_memory != nullptr)
+      munmap(m_memory, m_size);
+  }
+
+  Code(const Code &) = delete;
+  Code &operator=(const Code &) = delete;
+
+  bool isLoaded() const {
+    return m_function != nullptr;
+  }
+
+  double operator()(const double *arguments) const {
+    return m_function(arguments);
+  }
+};
+
+Jit::Jit(const std::atomic<bool> &interrupted)
+    : m_interrupted(&interrupted) {}
+
+Jit::~Jit() = default;
+
+bool Jit::isSupported() {
+#if defined(__x86_64__) && defined(__linux__)
+  return true;
+#else
+  return false;
+#endif
+}
+
+std::optional<double> Jit::call(const FunctionStmt &declaration, const std::vector<std::any> &arguments) {
+  Entry &entry = m_functions[&declaration];
+
+  if (entry.state == Entry::State::Cold && ++entry.calls >= threshold)
+    compile(entry, declaration);
+
+  if (entry.state != Entry::State::Compiled)
+    return std::nullopt;
+
+  std::array<double, maxArity> values{};
+  for (std::size_t i = 0; i < arguments.size(); ++i) {
+    const auto *literal = std::any_cast<Literal>(&arguments[i]);
+    const auto *number = literal == nullptr ? nullptr : std::get_if<double>(&literal->data());
+    if (number == nullptr) {
+      ++m_statistics.guardFailures;
+      return std::nullopt;
+    }
+    values[i] = *number;
+  }
+
+  m_depth = 0;
+  m_bailout = 0;
+  const double result = (*entry.code)(values.data());
+
+  if (m_bailout != 0) {
+    ++m_statistics.bailouts;
+    if (!m_interrupted->load(std::memory_order_relaxed)) // an interrupt says nothing about the function
+      entry.state = Entry::State::Rejected;
+    return std::nullopt;
+  }
+
+  return result;
+}
+
+const Jit::Statistics &Jit::statistics() const {
+  return m_statistics;
+}
+
+void Jit::compile(Entry &entry, const FunctionStmt &declaration) {
+  const auto start = std::chrono::steady_clock::now();
+
+  entry.state = Entry::State::Rejected;
+  if (isSupported()) {
+    FunctionCompiler compiler{declaration, &m_depth, &m_bailout, m_interrupted};
+    if (compiler.compile()) {
+      const std::vector<std::uint8_t> code = compiler.code();
+      auto loaded = std::make_unique<Code>(code, compiler.entry());
+      if (loaded->isLoaded()) {
+        entry.state = Entry::State::Compiled;
+        entry.code = std::move(loaded);
+        m_statistics.codeSize += code.size();
+      }
+    }
+  }
+
+  entry.state == Entry::State::Compiled ? ++m_statistics.compiled : ++m_statistics.rejected;
+  m_statistics.compileTime += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+}
+
+}
@@ -0,0 +1,61 @@
+#include "lox/memory/arena.h"
+
+#include <algorithm>
+#include <memory>
+
+namespace lox::memory {
+
+FrameArena::FrameArena(std::pmr::memory_resource *upstream)
+    : m_upstream(upstream) {}
+
+FrameArena::~FrameArena() {
+  for (const Chunk &chunk : m_chunks)
+    m_upstream->deallocate(chunk.memory, chunk.size, alignof(std::max_align_t));
+}
+
+FrameArena::Mark FrameArena::mark() const {
+  return Mark{m_chunk, m_offset};
+}
+
+void FrameArena::rewind(const Mark mark) {
+  m_chunk = mark.chunk;
+  m_offset = mark.offset;
+}
+
+std::size_t FrameArena::reserved() const {
+  std::size_t bytes = 0;
+  for (const Chunk &chunk : m_chunks)
+    bytes += chunk.size;
+  return bytes;
+}
+
+// What doesn't fit in the rest of a chunk goes to the next one that is big enough; the ones skipped over are used
+// again after a rewind.
+void *FrameArena::do_allocate(const std::size_t bytes, const std::size_t alignment) {
+  for (;;) {
+    if (m_chunk == m_chunks.size()) {
+      const std::size_t size = std::max(chunkSize, bytes + alignment);
+      m_chunks.push_back(Chunk{static_cast<std::byte *>(m_upstream->allocate(size, alignof(std::max_align_t))), size});
+      m_offset = 0;
+    }
+
+    const Chunk &chunk = m_chunks[m_chunk];
+    void *memory = chunk.memory + m_offset;
+    std::size_t space = chunk.size - m_offset;
+    if (std::align(alignment, bytes, memory, space) != nullptr) {
+      m_offset = chunk.size - space + bytes;
+      return memory;
+    }
+
+    ++m_chunk;
+    m_offset = 0;
+  }
+}
+
+void FrameArena::do_deallocate(void * /*memory*/, const std::size_t /*bytes*/, const std::size_t /*alignment*/) {}
+
+bool FrameArena::do_is_equal(const std::pmr::memory_resource &other) const noexcept {
+  return this == &other;
+}
+
+}
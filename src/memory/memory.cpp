@@ -0,0 +1,247 @@
+#include "lox/memory/memory.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+
+namespace lox::memory {
+
+namespace {
+// Process-wide, updated with a locked instruction once per slack bytes a thread's balance moves.
+struct Total {
+  std::atomic<std::int64_t> live = 0;
+  std::atomic<std::int64_t> peak = 0;
+
+  // The high point of the stretch is where the balance was highest, on top of the bytes live before it.
+  void publish(const std::int64_t balance, const std::int64_t high) {
+    const std::int64_t before = live.fetch_add(balance, std::memory_order_relaxed);
+    raise(before + high);
+  }
+
+  void raise(const std::int64_t bytes) {
+    std::int64_t seen = peak.load(std::memory_order_relaxed);
+    while (bytes > seen && !peak.compare_exchange_weak(seen, bytes, std::memory_order_relaxed)) {
+    }
+  }
+};
+
+// Written by one thread only, with plain loads and stores, so counting costs no locked instruction; read by any. The
+// balance is what the thread allocated less what it freed since it last published, whichever thread allocated it.
+struct Counter {
+  std::atomic<std::uint64_t> allocations = 0;
+  std::atomic<std::int64_t> balance = 0;
+  std::atomic<std::int64_t> high = 0; // the highest the balance has been since the thread last published
+
+  void allocate(const std::int64_t bytes, Total &total) {
+    allocations.store(allocations.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    const std::int64_t now = balance.load(std::memory_order_relaxed) + bytes;
+    balance.store(now, std::memory_order_relaxed);
+    if (now > high.load(std::memory_order_relaxed))
+      high.store(now, std::memory_order_relaxed);
+    if (now >= slack)
+      publish(total);
+  }
+
+  void deallocate(const std::int64_t bytes, Total &total) {
+    const std::int64_t now = balance.load(std::memory_order_relaxed) - bytes;
+    balance.store(now, std::memory_order_relaxed);
+    if (now <= -slack)
+      publish(total);
+  }
+
+  void resetPeak() {
+    high.store(balance.load(std::memory_order_relaxed), std::memory_order_relaxed);
+  }
+
+  void publish(Total &total) {
+    total.publish(balance.load(std::memory_order_relaxed), high.load(std::memory_order_relaxed));
+    balance.store(0, std::memory_order_relaxed);
+    high.store(0, std::memory_order_relaxed);
+  }
+};
+
+// The counters of a thread, on cache lines of their own.
+struct alignas(64) Counters {
+  std::array<Counter, tagCount> tags{};
+  Counter total{};
+  Counters *next = nullptr;
+};
+
+// Constant initialized, so that allocations made while other statics are being constructed already count. The lock
+// guards the list of threads and is only taken when a thread allocates for the first time, when it ends and when the
+// statistics are read. The counters of the threads that ended only keep their allocations, as they publish the rest.
+constinit std::mutex lock;
+constinit Counters *threads = nullptr;
+constinit Counters retired{};
+constinit std::array<Total, tagCount> tagTotals{};
+constinit Total total{};
+constinit std::atomic<bool> hooked = false;
+
+constinit thread_local Counters *own = nullptr;
+constinit thread_local bool ended = false;
+
+constexpr std::array<const char *, tagCount> names{"other", "scanner", "parser", "resolver", "environments", "objects", "strings"};
+
+// Any thread may add to the counters of the threads that ended, under the lock.
+void retire(Counter &into, Counter &counter, Total &total) {
+  counter.publish(total);
+  into.allocations.fetch_add(counter.allocations.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+// Folds the counters of the thread into those of the threads that ended when it ends.
+struct Retire {
+  ~Retire() {
+    const std::lock_guard guard{lock};
+    for (Counters **link = &threads; *link != nullptr; link = &(*link)->next) {
+      if (*link == own) {
+        *link = own->next;
+        break;
+      }
+    }
+    for (std::size_t tag = 0; tag < tagCount; tag++)
+      retire(retired.tags[tag], own->tags[tag], tagTotals[tag]);
+    retire(retired.total, own->total, total);
+
+    own->~Counters();
+    std::free(own);
+    own = nullptr;
+    ended = true;
+  }
+};
+
+// Taken from malloc(), as the operator new hook calls here. Once the thread ended, what its last destructors allocate
+// and free is counted with those of the threads that ended before it.
+Counters &counters() {
+  if (own != nullptr)
+    return *own;
+  if (ended)
+    return retired;
+
+  void *memory = std::aligned_alloc(alignof(Counters), sizeof(Counters));
+  if (memory == nullptr)
+    throw std::bad_alloc();
+  own = new (memory) Counters{};
+  {
+    const std::lock_guard guard{lock};
+    own->next = threads;
+    threads = own;
+  }
+  thread_local Retire retire;
+  return *own;
+}
+
+void allocate(Counters &counters, const Tag tag, const std::int64_t bytes) {
+  counters.tags[static_cast<std::size_t>(tag)].allocate(bytes, tagTotals[static_cast<std::size_t>(tag)]);
+  counters.total.allocate(bytes, total);
+}
+
+void deallocate(Counters &counters, const Tag tag, const std::int64_t bytes) {
+  counters.tags[static_cast<std::size_t>(tag)].deallocate(bytes, tagTotals[static_cast<std::size_t>(tag)]);
+  counters.total.deallocate(bytes, total);
+}
+
+// Past the bytes published, what each thread holds back. A thread may free what another allocated, so a balance can
+// be negative; live bytes only add up across threads.
+void add(Usage &usage, const Counter &counter, std::int64_t &highs) {
+  usage.liveBytes += counter.balance.load(std::memory_order_relaxed);
+  usage.allocations += counter.allocations.load(std::memory_order_relaxed);
+  highs += counter.high.load(std::memory_order_relaxed);
+}
+
+void finish(Usage &usage, const Total &total, const std::int64_t highs) {
+  const std::int64_t published = total.live.load(std::memory_order_relaxed);
+  usage.liveBytes += published;
+  usage.peakBytes = std::max({total.peak.load(std::memory_order_relaxed), published + highs, usage.liveBytes});
+}
+}
+
+const char *name(const Tag tag) {
+  return names[static_cast<std::size_t>(tag)];
+}
+
+// Allocations add up across threads, and so do live bytes, however many of them one thread frees for another. Peaks
+// are those of the process, from what the threads published and what they hold back now.
+Statistics statistics() {
+  Statistics statistics;
+  std::array<std::int64_t, tagCount> tagHighs{};
+  std::int64_t highs = 0;
+  const std::lock_guard guard{lock};
+  for (const Counters *counters = &retired; counters != nullptr; counters = counters == &retired ? threads : counters->next) {
+    for (std::size_t tag = 0; tag < tagCount; tag++)
+      add(statistics.tags[tag], counters->tags[tag], tagHighs[tag]);
+    add(statistics.total, counters->total, highs);
+  }
+  for (std::size_t tag = 0; tag < tagCount; tag++)
+    finish(statistics.tags[tag], tagTotals[tag], tagHighs[tag]);
+  finish(statistics.total, total, highs);
+  statistics.hooked = hooked.load();
+  return statistics;
+}
+
+// Like the counting, the peaks of a thread are written here without a locked instruction, so one it counts into
+// meanwhile may keep its old high point. That never happens to the calling thread.
+void resetPeaks() {
+  const std::lock_guard guard{lock};
+  for (Counters *counters = &retired; counters != nullptr; counters = counters == &retired ? threads : counters->next) {
+    for (Counter &counter : counters->tags)
+      counter.resetPeak();
+    counters->total.resetPeak();
+  }
+  for (Total &counter : tagTotals)
+    counter.peak.store(counter.live.load(std::memory_order_relaxed), std::memory_order_relaxed);
+  total.peak.store(total.live.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+void recordAllocation(const Tag tag, const std::size_t bytes) {
+  Counters &mine = counters();
+  if (&mine != &retired) {
+    allocate(mine, tag, static_cast<std::int64_t>(bytes));
+    return;
+  }
+  const std::lock_guard guard{lock};
+  allocate(retired, tag, static_cast<std::int64_t>(bytes));
+}
+
+void recordDeallocation(const Tag tag, const std::size_t bytes) {
+  Counters &mine = counters();
+  if (&mine != &retired) {
+    deallocate(mine, tag, static_cast<std::int64_t>(bytes));
+    return;
+  }
+  const std::lock_guard guard{lock};
+  deallocate(retired, tag, static_cast<std::int64_t>(bytes));
+}
+
+void markHooked() {
+  hooked.store(true);
+}
+
+void *TaggedResource::do_allocate(const std::size_t bytes, const std::size_t alignment) {
+  void *memory = alignment <= alignof(std::max_align_t) ? std::malloc(bytes) : std::aligned_alloc(alignment, (bytes + alignment - 1) / alignment * alignment);
+  if (memory == nullptr)
+    throw std::bad_alloc();
+
+  recordAllocation(m_tag, bytes);
+  return memory;
+}
+
+void TaggedResource::do_deallocate(void *memory, const std::size_t bytes, const std::size_t /*alignment*/) {
+  recordDeallocation(m_tag, bytes);
+  std::free(memory);
+}
+
+bool TaggedResource::do_is_equal(const std::pmr::memory_resource &other) const noexcept {
+  return this == &other;
+}
+
+// Never destroyed: objects of static storage duration may still give memory back to them on exit.
+std::pmr::memory_resource *resource(const Tag tag) {
+  static auto *const resources = new std::array<TaggedResource, tagCount>{
+      TaggedResource{Tag::Other},   TaggedResource{Tag::Scanner}, TaggedResource{Tag::Parser},  TaggedResource{Tag::Resolver},
+      TaggedResource{Tag::Environments}, TaggedResource{Tag::Objects}, TaggedResource{Tag::Strings}};
+  return &(*resources)[static_cast<std::size_t>(tag)];
+}
+
+}
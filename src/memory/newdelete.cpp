@@ -0,0 +1,122 @@
+#include "lox/memory/memory.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+// Replaces the global operator new and delete of the program that links it, to charge every allocation to the tag of
+// the allocating thread (see lox::memory::Scope). A header in front of each block remembers its size and tag, so that
+// freeing it credits the tag it was charged to, on whatever thread and in whatever scope.
+namespace {
+
+struct alignas(16) Header {
+  std::size_t size;
+  lox::memory::Tag tag;
+};
+
+static_assert(sizeof(Header) == 16);
+
+const bool hooked = (lox::memory::markHooked(), true);
+
+std::size_t offset(const std::size_t alignment) {
+  return std::max(alignment, sizeof(Header));
+}
+
+void *allocate(const std::size_t size, const std::size_t alignment) {
+  const std::size_t skip = offset(alignment);
+  void *base = alignment <= alignof(std::max_align_t) ? std::malloc(size + skip) : std::aligned_alloc(alignment, (size + skip + alignment - 1) / alignment * alignment);
+  if (base == nullptr)
+    throw std::bad_alloc();
+
+  auto *memory = static_cast<std::byte *>(base) + skip;
+  const lox::memory::Tag tag = lox::memory::currentTag();
+  new (memory - sizeof(Header)) Header{size, tag};
+  lox::memory::recordAllocation(tag, size);
+  return memory;
+}
+
+void deallocate(void *memory, const std::size_t alignment) noexcept {
+  if (memory == nullptr)
+    return;
+
+  const auto *header = reinterpret_cast<const Header *>(static_cast<std::byte *>(memory) - sizeof(Header));
+  lox::memory::recordDeallocation(header->tag, header->size);
+  std::free(static_cast<std::byte *>(memory) - offset(alignment));
+}
+
+constexpr std::size_t plain = alignof(std::max_align_t);
+
+}
+
+void *operator new(const std::size_t size) {
+  return allocate(size, plain);
+}
+
+void *operator new[](const std::size_t size) {
+  return allocate(size, plain);
+}
+
+void *operator new(const std::size_t size, const std::align_val_t alignment) {
+  return allocate(size, static_cast<std::size_t>(alignment));
+}
+
+void *operator new[](const std::size_t size, const std::align_val_t alignment) {
+  return allocate(size, static_cast<std::size_t>(alignment));
+}
+
+void *operator new(const std::size_t size, const std::nothrow_t & /*unused*/) noexcept {
+  try {
+    return allocate(size, plain);
+  } catch (const std::bad_alloc &) {
+    return nullptr;
+  }
+}
+
+void *operator new[](const std::size_t size, const std::nothrow_t & /*unused*/) noexcept {
+  try {
+    return allocate(size, plain);
+  } catch (const std::bad_alloc &) {
+    return nullptr;
+  }
+}
+
+void operator delete(void *memory) noexcept {
+  deallocate(memory, plain);
+}
+
+void operator delete[](void *memory) noexcept {
+  deallocate(memory, plain);
+}
+
+void operator delete(void *memory, std::size_t /*size*/) noexcept {
+  deallocate(memory, plain);
+}
+
+void operator delete[](void *memory, std::size_t /*size*/) noexcept {
+  deallocate(memory, plain);
+}
+
+void operator delete(void *memory, const std::nothrow_t & /*unused*/) noexcept {
+  deallocate(memory, plain);
+}
+
+void operator delete[](void *memory, const std::nothrow_t & /*unused*/) noexcept {
+  deallocate(memory, plain);
+}
+
+void operator delete(void *memory, const std::align_val_t alignment) noexcept {
+  deallocate(memory, static_cast<std::size_t>(alignment));
+}
+
+void operator delete[](void *memory, const std::align_val_t alignment) noexcept {
+  deallocate(memory, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void *memory, std::size_t /*size*/, const std::align_val_t alignment) noexcept {
+  deallocate(memory, static_cast<std::size_t>(alignment));
+}
+
+void operator delete[](void *memory, std::size_t /*size*/, const std::align_val_t alignment) noexcept {
+  deallocate(memory, static_cast<std::size_t>(alignment));
+}
@@ -0,0 +1,242 @@
+#include "lox/optimizer/constantfolder.h"
+#include "lox/primitives/token.h"
+#include "lox/primitives/literal.h"
+
+#include <boost/variant/apply_visitor.hpp>
+#include <boost/variant/get.hpp>
+
+#include <optional>
+#include <string>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace lox {
+
+void ConstantFolder::run(std::vector<Stmt> &statements) {
+  fold(statements);
+}
+
+PassStatistics ConstantFolder::statistics() const {
+  return PassStatistics{"constant-folding",
+                        {},
+                        {{"folded expressions", m_foldedExpressions}, //
+                         {"removed groupings", m_removedGroupings},   //
+                         {"short-circuited logicals", m_shortCircuits}}};
+}
+
+void ConstantFolder::fold(std::vector<Stmt> &statements) {
+  for (Stmt &statement : statements)
+    fold(statement);
+}
+
+void ConstantFolder::fold(Stmt &stmt) {
+  boost::apply_visitor(*this, stmt);
+}
+
+// Children are folded first, so a node only has to look one level down to see whether its operands became literals.
+void ConstantFolder::fold(Expr &expr) {
+  boost::apply_visitor(*this, expr);
+
+  if (std::optional<Expr> simplified = simplify(expr))
+    expr = std::move(*simplified);
+}
+
+void ConstantFolder::operator()(BlockStmt &stmt) {
+  fold(stmt.statements);
+}
+
+void ConstantFolder::operator()(ClassStmt &stmt) {
+  for (FunctionStmt &method : stmt.methods)
+    (*this)(method);
+}
+
+void ConstantFolder::operator()(ExpressionStmt &stmt) {
+  fold(stmt.expression);
+}
+
+void ConstantFolder::operator()(FunctionStmt &stmt) {
+  fold(stmt.body);
+}
+
+void ConstantFolder::operator()(IfStmt &stmt) {
+  fold(stmt.condition);
+  fold(stmt.thenBranch);
+  fold(stmt.elseBranch);
+}
+
+void ConstantFolder::operator()(PrintStmt &stmt) {
+  fold(stmt.expression);
+}
+
+void ConstantFolder::operator()(ReturnStmt &stmt) {
+  fold(stmt.value);
+}
+
+void ConstantFolder::operator()(YieldStmt &stmt) {
+  fold(stmt.value);
+}
+
+void ConstantFolder::operator()(VariableStmt &stmt) {
+  fold(stmt.initializer);
+}
+
+void ConstantFolder::operator()(WhileStmt &stmt) {
+  fold(stmt.condition);
+  fold(stmt.body);
+}
+
+void ConstantFolder::operator()(AssignExpr &expr) {
+  fold(expr.value);
+}
+
+void ConstantFolder::operator()(BinaryExpr &expr) {
+  fold(expr.left);
+  fold(expr.right);
+}
+
+void ConstantFolder::operator()(CallExpr &expr) {
+  fold(expr.callee);
+
+  for (Expr &argument : expr.arguments)
+    fold(argument);
+}
+
+void ConstantFolder::operator()(GetExpr &expr) {
+  fold(expr.object);
+}
+
+void ConstantFolder::operator()(GroupingExpr &expr) {
+  fold(expr.expression);
+}
+
+void ConstantFolder::operator()(LogicalExpr &expr) {
+  fold(expr.left);
+  fold(expr.right);
+}
+
+void ConstantFolder::operator()(SetExpr &expr) {
+  fold(expr.object);
+  fold(expr.value);
+}
+
+void ConstantFolder::operator()(UnaryExpr &expr) {
+  fold(expr.right);
+}
+
+void ConstantFolder::operator()(auto & /*unused*/) {
+  // sink: blank, literals and leaves that have nothing to fold
+}
+
+std::optional<Expr> ConstantFolder::simplify(Expr &expr) {
+  if (auto *grouping = boost::get<GroupingExpr>(&expr)) {
+    ++m_removedGroupings;
+    return std::move(grouping->expression);
+  }
+
+  if (const auto *binary = boost::get<BinaryExpr>(&expr)) {
+    if (const std::optional<Literal> value = evaluate(*binary)) {
+      ++m_foldedExpressions;
+      return LiteralExpr{*value};
+    }
+  }
+
+  if (const auto *unary = boost::get<UnaryExpr>(&expr)) {
+    if (const std::optional<Literal> value = evaluate(*unary)) {
+      ++m_foldedExpressions;
+      return LiteralExpr{*value};
+    }
+  }
+
+  // `and`/`or` yield one of their operands, so a literal left side decides the whole expression: either the left side
+  // itself or, whatever it is, the right side.
+  if (auto *logical = boost::get<LogicalExpr>(&expr)) {
+    if (const auto *left = boost::get<LiteralExpr>(&logical->left)) {
+      const bool isTruthy = left->literal.isTruthy();
+      const bool shortCircuits = logical->op.kind == TokenKind::Or ? isTruthy : !isTruthy;
+
+      ++m_shortCircuits;
+      if (shortCircuits)
+        return Expr{*left};
+      return std::move(logical->right);
+    }
+  }
+
+  return std::nullopt;
+}
+
+std::optional<Literal> ConstantFolder::evaluate(const BinaryExpr &expr) const {
+  const auto *leftExpr = boost::get<LiteralExpr>(&expr.left);
+  const auto *rightExpr = boost::get<LiteralExpr>(&expr.right);
+
+  if (leftExpr == nullptr || rightExpr == nullptr)
+    return std::nullopt;
+
+  const Literal::literal_t &left = leftExpr->literal.data();
+  const Literal::literal_t &right = rightExpr->literal.data();
+
+  if (expr.op.kind == TokenKind::EqualEqual)
+    return Literal{leftExpr->literal == rightExpr->literal};
+
+  if (expr.op.kind == TokenKind::BangEqual)
+    return Literal{leftExpr->literal != rightExpr->literal};
+
+  if (expr.op.kind == TokenKind::Plus && std::holds_alternative<std::string>(left) && std::holds_alternative<std::string>(right))
+    return Literal{std::get<std::string>(left) + std::get<std::string>(right)};
+
+  if (!std::holds_alternative<double>(left) || !std::holds_alternative<double>(right))
+    return std::nullopt;
+
+  const double l = std::get<double>(left);
+  const double r = std::get<double>(right);
+
+  switch (expr.op.kind) {
+    using enum TokenKind;
+
+    case Plus:
+      return Literal{l + r};
+
+    case Minus:
+      return Literal{l - r};
+
+    case Star:
+      return Literal{l * r};
+
+    case Slash:
+      return Literal{l / r};
+
+    case Greater:
+      return Literal{l > r};
+
+    case GreaterEqual:
+      return Literal{l >= r};
+
+    case Less:
+      return Literal{l < r};
+
+    case LessEqual:
+      return Literal{l <= r};
+
+    default:
+      break;
+  }
+
+  return std::nullopt;
+}
+
+std::optional<Literal> ConstantFolder::evaluate(const UnaryExpr &expr) const {
+  const auto *right = boost::get<LiteralExpr>(&expr.right);
+
+  if (right == nullptr)
+    return std::nullopt;
+
+  if (expr.op.kind == TokenKind::Bang)
+    return Literal{!right->literal.isTruthy()};
+
+  if (expr.op.kind == TokenKind::Minus && std::holds_alternative<double>(right->literal.data()))
+    return Literal{-std::get<double>(right->literal.data())};
+
+  return std::nullopt;
+}
+
+}
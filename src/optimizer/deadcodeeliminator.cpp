@@ -0,0 +1,113 @@
+#include "lox/optimizer/deadcodeeliminator.h"
+#include "lox/ast/expr.h"
+
+#include <boost/variant/apply_visitor.hpp>
+#include <boost/variant/get.hpp>
+
+#include <algorithm>
+#include <iterator>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace lox {
+
+void DeadCodeEliminator::run(std::vector<Stmt> &statements) {
+  eliminate(statements);
+}
+
+PassStatistics DeadCodeEliminator::statistics() const {
+  return PassStatistics{"dead-code-elimination",
+                        {},
+                        {{"unreachable statements", m_unreachableStatements}, //
+                         {"folded branches", m_foldedBranches},               //
+                         {"removed loops", m_removedLoops},                   //
+                         {"removed expressions", m_removedExpressions}}};
+}
+
+void DeadCodeEliminator::eliminate(std::vector<Stmt> &statements) {
+  for (Stmt &statement : statements)
+    eliminate(statement);
+
+  // Statements removed above are left as blanks, which only matter inside a list.
+  std::erase_if(statements, [](const Stmt &statement) { return statement.which() == 0; });
+
+  const auto returns = std::find_if(begin(statements), end(statements), [this](const Stmt &statement) { return alwaysReturns(statement); });
+  if (returns != end(statements)) {
+    m_unreachableStatements += static_cast<std::size_t>(std::distance(std::next(returns), end(statements)));
+    statements.erase(std::next(returns), end(statements));
+  }
+}
+
+void DeadCodeEliminator::eliminate(Stmt &stmt) {
+  boost::apply_visitor(*this, stmt);
+
+  if (std::optional<Stmt> simplified = simplify(stmt))
+    stmt = std::move(*simplified);
+}
+
+void DeadCodeEliminator::operator()(BlockStmt &stmt) {
+  eliminate(stmt.statements);
+}
+
+void DeadCodeEliminator::operator()(ClassStmt &stmt) {
+  for (FunctionStmt &method : stmt.methods)
+    (*this)(method);
+}
+
+void DeadCodeEliminator::operator()(FunctionStmt &stmt) {
+  eliminate(stmt.body);
+}
+
+void DeadCodeEliminator::operator()(IfStmt &stmt) {
+  eliminate(stmt.thenBranch);
+  eliminate(stmt.elseBranch);
+}
+
+void DeadCodeEliminator::operator()(WhileStmt &stmt) {
+  eliminate(stmt.body);
+}
+
+void DeadCodeEliminator::operator()(auto & /*unused*/) {
+  // sink: statements without nested statements
+}
+
+std::optional<Stmt> DeadCodeEliminator::simplify(Stmt &stmt) {
+  if (auto *ifStmt = boost::get<IfStmt>(&stmt)) {
+    if (const auto *condition = boost::get<LiteralExpr>(&ifStmt->condition)) {
+      ++m_foldedBranches;
+      return condition->literal.isTruthy() ? std::move(ifStmt->thenBranch) : std::move(ifStmt->elseBranch);
+    }
+  }
+
+  if (const auto *whileStmt = boost::get<WhileStmt>(&stmt)) {
+    if (const auto *condition = boost::get<LiteralExpr>(&whileStmt->condition); condition != nullptr && !condition->literal.isTruthy()) {
+      ++m_removedLoops;
+      return Stmt{};
+    }
+  }
+
+  if (const auto *expressionStmt = boost::get<ExpressionStmt>(&stmt)) {
+    if (boost::get<LiteralExpr>(&expressionStmt->expression) != nullptr) {
+      ++m_removedExpressions;
+      return Stmt{};
+    }
+  }
+
+  return std::nullopt;
+}
+
+bool DeadCodeEliminator::alwaysReturns(const Stmt &stmt) const {
+  if (boost::get<ReturnStmt>(&stmt) != nullptr)
+    return true;
+
+  if (const auto *block = boost::get<BlockStmt>(&stmt))
+    return std::any_of(cbegin(block->statements), cend(block->statements), [this](const Stmt &statement) { return alwaysReturns(statement); });
+
+  if (const auto *ifStmt = boost::get<IfStmt>(&stmt))
+    return alwaysReturns(ifStmt->thenBranch) && alwaysReturns(ifStmt->elseBranch);
+
+  return false;
+}
+
+}
@@ -0,0 +1,525 @@
+#include "lox/optimizer/inliner.h"
+
+#include <boost/variant/apply_visitor.hpp>
+#include <boost/variant/get.hpp>
+
+#include <algorithm>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace {
+
+using namespace lox;
+
+// Finds the global names whose binding may change after it's declared: names declared more than once at top level and
+// every name that is the target of an assignment anywhere. Assignments to a shadowing local pin the global as well,
+// which is conservative but keeps the check independent of scoping.
+class BindingCollector : public boost::static_visitor<void> {
+private:
+  std::unordered_map<std::string, std::size_t> m_declarations;
+  std::unordered_set<std::string> &m_pinned;
+  std::size_t m_depth = 0;
+
+public:
+  explicit BindingCollector(std::unordered_set<std::string> &pinned)
+      : m_pinned(pinned) {}
+
+  void collect(const std::vector<Stmt> &statements) {
+    for (const Stmt &statement : statements)
+      boost::apply_visitor(*this, statement);
+  }
+
+  void collect(const Expr &expr) {
+    boost::apply_visitor(*this, expr);
+  }
+
+  void operator()(const BlockStmt &stmt) {
+    ++m_depth;
+    collect(stmt.statements);
+    --m_depth;
+  }
+
+  void operator()(const ClassStmt &stmt) {
+    declare(stmt.name);
+    ++m_depth;
+    for (const FunctionStmt &method : stmt.methods)
+      collect(method.body);
+    --m_depth;
+  }
+
+  void operator()(const ExpressionStmt &stmt) {
+    collect(stmt.expression);
+  }
+
+  void operator()(const FunctionStmt &stmt) {
+    declare(stmt.name);
+    ++m_depth;
+    collect(stmt.body);
+    --m_depth;
+  }
+
+  void operator()(const IfStmt &stmt) {
+    collect(stmt.condition);
+    boost::apply_visitor(*this, stmt.thenBranch);
+    boost::apply_visitor(*this, stmt.elseBranch);
+  }
+
+  void operator()(const PrintStmt &stmt) {
+    collect(stmt.expression);
+  }
+
+  void operator()(const ReturnStmt &stmt) {
+    collect(stmt.value);
+  }
+
+  void operator()(const YieldStmt &stmt) {
+    collect(stmt.value);
+  }
+
+  void operator()(const VariableStmt &stmt) {
+    collect(stmt.initializer);
+    declare(stmt.name);
+  }
+
+  void operator()(const WhileStmt &stmt) {
+    collect(stmt.condition);
+    boost::apply_visitor(*this, stmt.body);
+  }
+
+  void operator()(const AssignExpr &expr) {
+    m_pinned.insert(expr.name.lexeme);
+    collect(expr.value);
+  }
+
+  void operator()(const BinaryExpr &expr) {
+    collect(expr.left);
+    collect(expr.right);
+  }
+
+  void operator()(const CallExpr &expr) {
+    collect(expr.callee);
+    for (const Expr &argument : expr.arguments)
+      collect(argument);
+  }
+
+  void operator()(const GetExpr &expr) {
+    collect(expr.object);
+  }
+
+  void operator()(const GroupingExpr &expr) {
+    collect(expr.expression);
+  }
+
+  void operator()(const LogicalExpr &expr) {
+    collect(expr.left);
+    collect(expr.right);
+  }
+
+  void operator()(const SetExpr &expr) {
+    collect(expr.object);
+    collect(expr.value);
+  }
+
+  void operator()(const UnaryExpr &expr) {
+    collect(expr.right);
+  }
+
+  void operator()(const auto & /*unused*/) {}
+
+private:
+  void declare(const Token &name) {
+    if (m_depth == 0 && ++m_declarations[name.lexeme] > 1)
+      m_pinned.insert(name.lexeme);
+  }
+};
+
+// Measures an expression and records the variables it reads. Anything that may have a side effect (assignment, call,
+// property write) or depends on the enclosing method (this, super) makes the expression impure.
+class ExpressionShape : public boost::static_visitor<void> {
+public:
+  bool isPure = true;
+  std::size_t size = 0;
+  std::unordered_map<std::string, std::size_t> variables;
+
+  void measure(const Expr &expr) {
+    ++size;
+    boost::apply_visitor(*this, expr);
+  }
+
+  void operator()(const BinaryExpr &expr) {
+    measure(expr.left);
+    measure(expr.right);
+  }
+
+  void operator()(const GetExpr &expr) {
+    measure(expr.object);
+  }
+
+  void operator()(const GroupingExpr &expr) {
+    measure(expr.expression);
+  }
+
+  void operator()(const LiteralExpr & /*unused*/) {}
+
+  void operator()(const LogicalExpr &expr) {
+    measure(expr.left);
+    measure(expr.right);
+  }
+
+  void operator()(const UnaryExpr &expr) {
+    measure(expr.right);
+  }
+
+  void operator()(const VariableExpr &expr) {
+    ++variables[expr.name.lexeme];
+  }
+
+  void operator()(const auto & /*unused*/) {
+    isPure = false;
+  }
+};
+
+// Lists the steps of a pure expression in the order the interpreter takes them: operands left to right, then the
+// operator; the right operand of a logical operator only maybe.
+class EvaluationOrder : public boost::static_visitor<void> {
+private:
+  std::vector<Inliner::Step> &m_steps;
+  bool m_isConditional = false;
+
+public:
+  explicit EvaluationOrder(std::vector<Inliner::Step> &steps)
+      : m_steps(steps) {}
+
+  void walk(const Expr &expr) {
+    boost::apply_visitor(*this, expr);
+  }
+
+  void operator()(const BinaryExpr &expr) {
+    walk(expr.left);
+    walk(expr.right);
+    m_steps.push_back(Inliner::Step{nullptr, m_isConditional});
+  }
+
+  void operator()(const GetExpr &expr) {
+    walk(expr.object);
+    m_steps.push_back(Inliner::Step{nullptr, m_isConditional});
+  }
+
+  void operator()(const GroupingExpr &expr) {
+    walk(expr.expression);
+  }
+
+  void operator()(const LogicalExpr &expr) {
+    walk(expr.left);
+    const bool wasConditional = std::exchange(m_isConditional, true);
+    walk(expr.right);
+    m_isConditional = wasConditional;
+  }
+
+  void operator()(const UnaryExpr &expr) {
+    walk(expr.right);
+    m_steps.push_back(Inliner::Step{nullptr, m_isConditional});
+  }
+
+  void operator()(const VariableExpr &expr) {
+    m_steps.push_back(Inliner::Step{&expr.name.lexeme, m_isConditional});
+  }
+
+  void operator()(const auto & /*unused*/) {}
+};
+
+// Replaces reads of parameters with copies of the matching arguments. Arguments are not visited again, so a parameter
+// name that also appears inside an argument refers to the caller's variable, as it should.
+class Substitution : public boost::static_visitor<void> {
+private:
+  const std::unordered_map<std::string, const Expr *> &m_arguments;
+
+public:
+  explicit Substitution(const std::unordered_map<std::string, const Expr *> &arguments)
+      : m_arguments(arguments) {}
+
+  void substitute(Expr &expr) {
+    if (const auto *variable = boost::get<VariableExpr>(&expr)) {
+      if (const auto it = m_arguments.find(variable->name.lexeme); it != m_arguments.end()) {
+        expr = *it->second;
+        return;
+      }
+    }
+
+    boost::apply_visitor(*this, expr);
+  }
+
+  void operator()(BinaryExpr &expr) {
+    substitute(expr.left);
+    substitute(expr.right);
+  }
+
+  void operator()(GetExpr &expr) {
+    substitute(expr.object);
+  }
+
+  void operator()(GroupingExpr &expr) {
+    substitute(expr.expression);
+  }
+
+  void operator()(LogicalExpr &expr) {
+    substitute(expr.left);
+    substitute(expr.right);
+  }
+
+  void operator()(UnaryExpr &expr) {
+    substitute(expr.right);
+  }
+
+  void operator()(auto & /*unused*/) {}
+};
+
+}
+
+namespace lox {
+
+void Inliner::run(std::vector<Stmt> &statements) {
+  BindingCollector collector{m_pinned};
+  collector.collect(statements);
+
+  inlineCalls(statements);
+}
+
+PassStatistics Inliner::statistics() const {
+  return PassStatistics{"inlining",
+                        {},
+                        {{"candidate functions", m_candidatesFound}, //
+                         {"inlined calls", m_inlinedCalls}}};
+}
+
+void Inliner::inlineCalls(std::vector<Stmt> &statements) {
+  for (Stmt &statement : statements)
+    inlineCalls(statement);
+}
+
+void Inliner::inlineCalls(Stmt &stmt) {
+  boost::apply_visitor(*this, stmt);
+}
+
+void Inliner::inlineCalls(Expr &expr) {
+  boost::apply_visitor(*this, expr);
+
+  if (const auto *call = boost::get<CallExpr>(&expr)) {
+    if (std::optional<Expr> expanded = expand(*call)) {
+      ++m_inlinedCalls;
+      expr = std::move(*expanded);
+    }
+  }
+}
+
+void Inliner::operator()(BlockStmt &stmt) {
+  m_scopes.emplace_back();
+  inlineCalls(stmt.statements);
+  m_scopes.pop_back();
+}
+
+void Inliner::operator()(ClassStmt &stmt) {
+  declare(stmt.name);
+
+  for (FunctionStmt &method : stmt.methods) {
+    m_scopes.emplace_back();
+    for (const Token &param : method.params)
+      declare(param);
+    inlineCalls(method.body);
+    m_scopes.pop_back();
+  }
+}
+
+void Inliner::operator()(ExpressionStmt &stmt) {
+  inlineCalls(stmt.expression);
+}
+
+void Inliner::operator()(FunctionStmt &stmt) {
+  declare(stmt.name);
+
+  if (m_scopes.empty())
+    consider(stmt);
+
+  m_scopes.emplace_back();
+  for (const Token &param : stmt.params)
+    declare(param);
+  inlineCalls(stmt.body);
+  m_scopes.pop_back();
+}
+
+void Inliner::operator()(IfStmt &stmt) {
+  inlineCalls(stmt.condition);
+  inlineCalls(stmt.thenBranch);
+  inlineCalls(stmt.elseBranch);
+}
+
+void Inliner::operator()(PrintStmt &stmt) {
+  inlineCalls(stmt.expression);
+}
+
+void Inliner::operator()(ReturnStmt &stmt) {
+  inlineCalls(stmt.value);
+}
+
+void Inliner::operator()(YieldStmt &stmt) {
+  inlineCalls(stmt.value);
+}
+
+void Inliner::operator()(VariableStmt &stmt) {
+  inlineCalls(stmt.initializer);
+  declare(stmt.name);
+}
+
+void Inliner::operator()(WhileStmt &stmt) {
+  inlineCalls(stmt.condition);
+  inlineCalls(stmt.body);
+}
+
+void Inliner::operator()(AssignExpr &expr) {
+  inlineCalls(expr.value);
+}
+
+void Inliner::operator()(BinaryExpr &expr) {
+  inlineCalls(expr.left);
+  inlineCalls(expr.right);
+}
+
+void Inliner::operator()(CallExpr &expr) {
+  inlineCalls(expr.callee);
+
+  for (Expr &argument : expr.arguments)
+    inlineCalls(argument);
+}
+
+void Inliner::operator()(GetExpr &expr) {
+  inlineCalls(expr.object);
+}
+
+void Inliner::operator()(GroupingExpr &expr) {
+  inlineCalls(expr.expression);
+}
+
+void Inliner::operator()(LogicalExpr &expr) {
+  inlineCalls(expr.left);
+  inlineCalls(expr.right);
+}
+
+void Inliner::operator()(SetExpr &expr) {
+  inlineCalls(expr.object);
+  inlineCalls(expr.value);
+}
+
+void Inliner::operator()(UnaryExpr &expr) {
+  inlineCalls(expr.right);
+}
+
+void Inliner::operator()(auto & /*unused*/) {
+  // sink: leaves have no calls to expand
+}
+
+void Inliner::declare(const Token &name) {
+  if (!m_scopes.empty())
+    m_scopes.back().insert(name.lexeme);
+}
+
+bool Inliner::isLocal(const std::string &name) const {
+  return std::any_of(cbegin(m_scopes), cend(m_scopes), [&name](const auto &scope) { return scope.contains(name); });
+}
+
+void Inliner::consider(const FunctionStmt &function) {
+  if (m_pinned.contains(function.name.lexeme) || function.body.size() != 1)
+    return;
+
+  const auto *ret = boost::get<ReturnStmt>(&function.body.front());
+  if (ret == nullptr || ret->value.which() == 0)
+    return;
+
+  ExpressionShape shape;
+  shape.measure(ret->value);
+  if (!shape.isPure || shape.size > maxInlineSize)
+    return;
+
+  std::vector<Step> steps;
+  EvaluationOrder order{steps};
+  order.walk(ret->value);
+
+  ++m_candidatesFound;
+  m_candidates.insert_or_assign(function.name.lexeme, Candidate{&function, &ret->value, std::move(shape.variables), std::move(steps)});
+}
+
+std::optional<Expr> Inliner::expand(const CallExpr &call) const {
+  const auto *callee = boost::get<VariableExpr>(&call.callee);
+  if (callee == nullptr || isLocal(callee->name.lexeme))
+    return std::nullopt;
+
+  const auto candidate = m_candidates.find(callee->name.lexeme);
+  if (candidate == m_candidates.end())
+    return std::nullopt;
+
+  const std::vector<Token> &params = candidate->second.function->params;
+  if (params.size() != call.arguments.size()) // let the call report the arity error
+    return std::nullopt;
+
+  const auto isParam = [&params](const std::string &name) {
+    return std::any_of(cbegin(params), cend(params), [&name](const Token &param) { return param.lexeme == name; });
+  };
+
+  // Globals read by the body must not be shadowed where the call is.
+  for (const auto &[name, uses] : candidate->second.variables)
+    if (!isParam(name) && isLocal(name))
+      return std::nullopt;
+
+  // A call evaluates each argument exactly once. Literals can be duplicated or dropped freely and variables can be
+  // read any number of times, but an operator expression may only replace a parameter that is read exactly once.
+  std::unordered_map<std::string, const Expr *> arguments;
+  std::vector<const std::string *> evaluated; // parameters whose argument can fail, in argument order
+  for (std::size_t i = 0; i < params.size(); ++i) {
+    const Expr &argument = call.arguments[i];
+    const auto found = candidate->second.variables.find(params[i].lexeme);
+    const std::size_t uses = found == candidate->second.variables.end() ? 0 : found->second;
+
+    if (boost::get<LiteralExpr>(&argument) == nullptr) {
+      if (boost::get<VariableExpr>(&argument) == nullptr) {
+        ExpressionShape shape;
+        shape.measure(argument);
+        if (!shape.isPure || uses != 1)
+          return std::nullopt;
+      }
+      evaluated.push_back(&params[i].lexeme);
+    }
+
+    arguments.insert_or_assign(params[i].lexeme, &argument);
+  }
+
+  // Reading an undefined variable or applying an operator to the wrong operands fails, so the arguments that can must
+  // still be evaluated first, each for sure and in the order the call would: the body may read parameters bound to
+  // literals or to arguments already evaluated, but nothing else, until the last of them is read.
+  std::size_t next = 0;
+  for (const Step &step : candidate->second.steps) {
+    if (next == evaluated.size())
+      break;
+    if (step.variable == nullptr || !isParam(*step.variable))
+      return std::nullopt;
+    if (*step.variable == *evaluated[next]) {
+      if (step.isConditional)
+        return std::nullopt;
+      ++next;
+    } else if (std::find_if(evaluated.begin() + static_cast<std::ptrdiff_t>(next), evaluated.end(),
+                            [&step](const std::string *param) { return *param == *step.variable; }) != evaluated.end()) {
+      return std::nullopt;
+    }
+  }
+  if (next != evaluated.size())
+    return std::nullopt;
+
+  Expr body = *candidate->second.body;
+  Substitution substitution{arguments};
+  substitution.substitute(body);
+  return body;
+}
+
+}
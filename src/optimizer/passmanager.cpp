@@ -0,0 +1,47 @@
+#include "lox/optimizer/passmanager.h"
+
+#include <chrono>
+#include <initializer_list>
+#include <iomanip>
+#include <ostream>
+#include <variant>
+#include <vector>
+
+namespace lox {
+
+// Inlining runs first so the expanded bodies get folded with their arguments, dead code elimination last since it
+// needs conditions that folding has reduced to literals.
+PassManager::PassManager()
+    : PassManager({Inliner{}, ConstantFolder{}, DeadCodeEliminator{}}) {}
+
+PassManager::PassManager(std::initializer_list<Pass> passes)
+    : m_passes(passes) {}
+
+void PassManager::run(std::vector<Stmt> &statements) {
+  for (Pass &pass : m_passes) {
+    const auto start = std::chrono::steady_clock::now();
+    std::visit([&statements](auto &p) { p.run(statements); }, pass);
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+
+    PassStatistics statistics = std::visit([](const auto &p) { return p.statistics(); }, pass);
+    statistics.elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed);
+    m_statistics.push_back(statistics);
+  }
+}
+
+const std::vector<PassStatistics> &PassManager::statistics() const {
+  return m_statistics;
+}
+
+void PassManager::printStatistics(std::ostream &os) const {
+  for (const PassStatistics &statistics : m_statistics) {
+    const auto microseconds = std::chrono::duration<double, std::micro>(statistics.elapsed).count();
+    os << std::left << std::setw(24) << statistics.name << std::right << std::fixed << std::setprecision(1) << std::setw(10) << microseconds
+       << " us\n";
+
+    for (const auto &[counter, value] : statistics.counters)
+      os << "  " << std::left << std::setw(28) << counter << std::right << std::setw(8) << value << '\n';
+  }
+}
+
+}
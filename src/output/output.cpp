@@ -0,0 +1,48 @@
+#include "lox/output/output.h"
+
+#include <unistd.h>
+
+#include <cstdio>
+#include <string_view>
+
+namespace lox {
+
+Output::Output(std::FILE *stream)
+    : m_stream(stream)
+    , m_lineBuffered(isatty(fileno(stream)) != 0) {
+  m_buffer.reserve(capacity);
+}
+
+Output::~Output() {
+  flush();
+}
+
+void Output::write(const std::string_view text) {
+  m_buffer.append(text);
+
+  if (m_buffer.size() >= capacity || (m_lineBuffered && text.find('\n') != std::string_view::npos))
+    flush();
+}
+
+void Output::writeLine(const std::string_view text) {
+  m_buffer.append(text);
+  m_buffer.push_back('\n');
+
+  if (m_buffer.size() >= capacity || m_lineBuffered)
+    flush();
+}
+
+void Output::flush() {
+  if (!m_buffer.empty()) {
+    std::fwrite(m_buffer.data(), sizeof(char), m_buffer.size(), m_stream);
+    m_buffer.clear();
+  }
+
+  std::fflush(m_stream);
+}
+
+std::FILE *Output::stream() const {
+  return m_stream;
+}
+
+}
@@ -2,6 +2,7 @@
 #include "lox/primitives/token.h"
 #include "lox/primitives/literal.h"
 #include "lox/error/error.h"
+#include "lox/memory/memory.h"
 
 #include <boost/variant/get.hpp>
 
@@ -9,6 +10,7 @@
 #include <string_view>
 #include <string>
 #include <algorithm>
+#include <utility>
 
 namespace lox {
 
@@ -86,6 +88,8 @@ void Parser::synchronize() {
       case Print:
         [[fallthrough]];
       case Return:
+        [[fallthrough]];
+      case Yield:
         return;
       default:
         break;
@@ -117,9 +121,16 @@ Stmt Parser::declaration() {
   }
 }
 
-// classDecl -> "class" IDENTIFIER "{" function* "}" ;
+// classDecl -> "class" IDENTIFIER ( "<" IDENTIFIER )? "{" function* "}" ;
 Stmt Parser::classDeclaration() {
   Token name = consume(TokenKind::Identifier, "Expect class name.");
+
+  Expr superClass;
+  if (match(TokenKind::Less)) {
+    consume(TokenKind::Identifier, "Expect superclass name.");
+    superClass = VariableExpr{previous()};
+  }
+
   consume(TokenKind::LeftBrace, "Expect '{' before class body.");
 
   std::vector<FunctionStmt> methods;
@@ -129,7 +140,7 @@ Stmt Parser::classDeclaration() {
 
   consume(TokenKind::RightBrace, "Expect '}' before class body.");
 
-  return ClassStmt{name, methods};
+  return numbered(ClassStmt{name, superClass, methods}, name.line);
 }
 
 // varDecl -> "var" IDENTIFIER ( "=" expression )? ";" ;
@@ -142,10 +153,10 @@ Stmt Parser::variableDeclaration() {
 
   consume(TokenKind::Semicolon, "Expect ';' after variable declaration.");
 
-  return VariableStmt{name, initializer};
+  return numbered(VariableStmt{name, initializer}, name.line);
 }
 
-// statement -> exprStmt | forStmt | ifStmt | printStmt | whileStmt | block ;
+// statement -> exprStmt | forStmt | ifStmt | printStmt | returnStmt | whileStmt | yieldStmt | block ;
 Stmt Parser::statement() {
   if (match(TokenKind::For))
     return forStatement();
@@ -159,17 +170,23 @@ Stmt Parser::statement() {
   if (match(TokenKind::Return))
     return returnStatement();
 
+  if (match(TokenKind::Yield))
+    return yieldStatement();
+
   if (match(TokenKind::While))
     return whileStatement();
 
-  if (match(TokenKind::LeftBrace))
-    return BlockStmt{block()};
+  if (match(TokenKind::LeftBrace)) {
+    const std::size_t line = previous().line;
+    return numbered(BlockStmt{block()}, line);
+  }
 
   return expressionStatement();
 }
 
 // forStmt -> "for" "(" ( varDecl | exprStmt | ";" ) expression? ";" expression? ")" statement ;
 Stmt Parser::forStatement() {
+  const Token keyword = previous();
   consume(TokenKind::LeftParen, "Expect '(' after 'for'.");
 
   Stmt initializer = [&]() -> Stmt {
@@ -201,21 +218,22 @@ Stmt Parser::forStatement() {
   Stmt body = statement();
 
   if (increment.which() != 0)
-    body = BlockStmt{{body, ExpressionStmt{increment}}};
+    body = numbered(BlockStmt{{body, numbered(ExpressionStmt{increment}, keyword.line)}}, keyword.line);
 
   if (condition.which() == 0) // is its value boost::blank?
     condition = LiteralExpr{true};
 
-  body = WhileStmt{condition, body};
+  body = numbered(WhileStmt{condition, body, keyword}, keyword.line);
 
   if (initializer.which() != 0)
-    body = BlockStmt{{initializer, body}};
+    body = numbered(BlockStmt{{initializer, body}}, keyword.line);
 
   return body;
 }
 
 // ifStmt -> "if" "(" expression ")" statement ( "else" statement )? ;
 Stmt Parser::ifStatement() {
+  const std::size_t line = previous().line;
   consume(TokenKind::LeftParen, "Expect '(' after 'if'.");
   Expr condition = expression();
   consume(TokenKind::RightParen, "Expect ')' after if condition.");
@@ -226,24 +244,26 @@ Stmt Parser::ifStatement() {
   if (match(TokenKind::Else))
     elseBranch = statement();
 
-  return IfStmt{condition, thenBranch, elseBranch};
+  return numbered(IfStmt{condition, thenBranch, elseBranch}, line);
 }
 
 Stmt Parser::whileStatement() {
+  const Token keyword = previous();
   consume(TokenKind::LeftParen, "Expect '(' after 'while'.");
   Expr condition = expression();
   consume(TokenKind::RightParen, "Expect ')' after condition.");
 
   Stmt body = statement();
 
-  return WhileStmt{condition, body};
+  return numbered(WhileStmt{condition, body, keyword}, keyword.line);
 }
 
 // exprStmt -> expression ";";
 Stmt Parser::expressionStatement() {
+  const std::size_t line = peek().line;
   Expr expr = expression();
   consume(TokenKind::Semicolon, "Expect ';' after expression.");
-  return ExpressionStmt{expr};
+  return numbered(ExpressionStmt{expr}, line);
 }
 
 FunctionStmt Parser::functionStatement(const std::string &kind) {
@@ -262,8 +282,10 @@ FunctionStmt Parser::functionStatement(const std::string &kind) {
   consume(TokenKind::RightParen, "Expect ')' after parameters.");
 
   consume(TokenKind::LeftBrace, std::string("Expect '{' before ").append(kind).append(" body."));
+  const bool enclosingYields = std::exchange(m_yields, false);
   std::vector<Stmt> body = block();
-  return FunctionStmt{name, parameters, body};
+  const bool yields = std::exchange(m_yields, enclosingYields);
+  return numbered(FunctionStmt{name, parameters, body, yields}, name.line);
 }
 
 // block -> "{" declaration "}";
@@ -278,9 +300,10 @@ std::vector<Stmt> Parser::block() {
 
 // printStmt -> "print" expression ";";
 Stmt Parser::printStatement() {
+  const std::size_t line = previous().line;
   Expr value = expression();
   consume(TokenKind::Semicolon, "Expect ';' after value.");
-  return PrintStmt{value};
+  return numbered(PrintStmt{value}, line);
 }
 
 Stmt Parser::returnStatement() {
@@ -291,7 +314,20 @@ Stmt Parser::returnStatement() {
     value = expression();
 
   consume(TokenKind::Semicolon, "Expect ';' after return value.");
-  return ReturnStmt{keyword, value};
+  return numbered(ReturnStmt{keyword, value}, keyword.line);
+}
+
+// yieldStmt -> "yield" expression? ";" ;
+Stmt Parser::yieldStatement() {
+  Token keyword = previous();
+  m_yields = true;
+
+  Expr value;
+  if (!check(TokenKind::Semicolon))
+    value = expression();
+
+  consume(TokenKind::Semicolon, "Expect ';' after yield value.");
+  return numbered(YieldStmt{keyword, value}, keyword.line);
 }
 
 // expression -> assignment;
@@ -351,7 +387,7 @@ Expr Parser::equality() {
   while (match({TokenKind::BangEqual, TokenKind::EqualEqual})) {
     Token op = previous();
     Expr right = comparison();
-    expr = BinaryExpr{expr, op, right};
+    expr = BinaryExpr{expr, op, right, m_binarySites++};
   }
 
   return expr;
@@ -365,7 +401,7 @@ Expr Parser::comparison() {
   while (match({Greater, GreaterEqual, Less, LessEqual})) {
     Token op = previous();
     Expr right = term();
-    expr = BinaryExpr{expr, op, right};
+    expr = BinaryExpr{expr, op, right, m_binarySites++};
   }
   return expr;
 }
@@ -377,7 +413,7 @@ Expr Parser::term() {
   while (match({TokenKind::Minus, TokenKind::Plus})) {
     Token op = previous();
     Expr right = factor();
-    expr = BinaryExpr{expr, op, right};
+    expr = BinaryExpr{expr, op, right, m_binarySites++};
   }
   return expr;
 }
@@ -389,7 +425,7 @@ Expr Parser::factor() {
   while (match({TokenKind::Slash, TokenKind::Star})) {
     Token op = previous();
     Expr right = unary();
-    expr = BinaryExpr{expr, op, right};
+    expr = BinaryExpr{expr, op, right, m_binarySites++};
   }
   return expr;
 }
@@ -423,7 +459,8 @@ Expr Parser::call() {
   return expr;
 }
 
-// primary -> NUMBER | STRING | "true" | "false" | "nil" | "(" expression ")" | IDENTIFIER ;
+// primary -> NUMBER | STRING | "true" | "false" | "nil" | "this" | "(" expression ")" | IDENTIFIER
+//          | "super" "." IDENTIFIER ;
 Expr Parser::primary() {
   if (match({TokenKind::Number, TokenKind::String})) {
     Literal literal = previous().literal;
@@ -445,6 +482,17 @@ Expr Parser::primary() {
     return LiteralExpr{nilLiteral};
   }
 
+  if (match(TokenKind::Super)) {
+    Token keyword = previous();
+    consume(TokenKind::Dot, "Expect '.' after 'super'.");
+    Token method = consume(TokenKind::Identifier, "Expect superclass method name.");
+    return SuperExpr{keyword, method};
+  }
+
+  if (match(TokenKind::This)) {
+    return ThisExpr{previous()};
+  }
+
   if (match(TokenKind::Identifier)) {
     return VariableExpr{previous()};
   }
@@ -462,6 +510,7 @@ Parser::Parser(const std::vector<Token> &tokens)
     : m_tokens(tokens) {}
 
 std::vector<Stmt> Parser::parse() {
+  const memory::Scope scope{memory::Tag::Parser};
   std::vector<Stmt> statements;
 
   while (!isAtEnd())
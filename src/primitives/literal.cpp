@@ -1,5 +1,8 @@
 #include "lox/primitives/literal.h"
 
+#include <array>
+#include <charconv>
+#include <cmath>
 #include <functional>
 #include <variant>
 
@@ -13,6 +16,17 @@ struct overload : Ts... {
 template <class... Ts>
 overload(Ts...) -> overload<Ts...>;
 
+// Shortest representation that round-trips, locale independent. Integral values print without a fractional part as
+// long as they are exactly representable, larger magnitudes fall back to the exponent form.
+std::string toString(const double d) {
+  constexpr double maxExactInteger = 9007199254740992.0; // 2^53
+
+  std::array<char, 32> buffer{};
+  const auto format = (std::trunc(d) == d && std::abs(d) < maxExactInteger) ? std::chars_format::fixed : std::chars_format::general;
+  char *last = std::to_chars(buffer.data(), buffer.data() + buffer.size(), d, format).ptr;
+  return std::string(buffer.data(), last);
+}
+
 }
 
 namespace lox {
@@ -40,11 +54,11 @@ bool Literal::isTruthy() const {
   // clang-format on
 }
 
-Literal::literal_t Literal::data() {
+Literal::literal_t &Literal::data() {
   return m_data;
 }
 
-const Literal::literal_t Literal::data() const {
+const Literal::literal_t &Literal::data() const {
   return m_data;
 }
 
@@ -54,20 +68,15 @@ Literal::operator std::string() const {
   return std::visit(overload {
            [](const std::nullptr_t) { return "nil"s; },
            [](const bool b) { return b ? "true"s: "false"s; },
-           [](const double d) { return std::to_string(d); },
+           [](const double d) { return toString(d); },
            [](const std::string& s) { return s;}
       }, m_data);
   // clang-format on
 }
 
+// Values of different types are never equal; doubles compare with IEEE semantics, so NaN != NaN.
 bool operator==(const Literal &left, const Literal &right) {
-  if (left.data().index() != right.data().index()) // not the same type
-    return false;
-
-  if (left.data().index() == 2 && right.data().index() == 2) // double comparison is tricky, NaN etc.
-    return std::get<double>(left.data()) == std::get<double>(right.data());
-
-  return left.isTruthy() == right.isTruthy();
+  return left.data() == right.data();
 }
 
 bool operator!=(const Literal &left, const Literal &right) {
@@ -0,0 +1,174 @@
+#include "lox/profiler/profiler.h"
+
+#include <boost/variant/get.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <ctime>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <unordered_map>
+
+#include <unistd.h>
+
+#ifndef sigev_notify_thread_id
+#define sigev_notify_thread_id _sigev_un._tid
+#endif
+
+namespace lox {
+
+namespace {
+std::atomic<Profiler *> active = nullptr;
+
+constexpr auto drainInterval = std::chrono::milliseconds(10);
+
+std::unordered_map<const FunctionStmt *, std::string> methodNames(const std::vector<Stmt> &statements) {
+  std::unordered_map<const FunctionStmt *, std::string> names;
+  for (const Stmt &statement : statements) {
+    if (const auto *stmt = boost::get<ClassStmt>(&statement)) {
+      for (const FunctionStmt &method : stmt->methods)
+        names.emplace(&method, stmt->name.lexeme + "." + method.name.lexeme);
+    }
+  }
+  return names;
+}
+}
+
+Profiler::Profiler(const unsigned frequency)
+    : m_frequency(std::max(frequency, 1U)) {}
+
+Profiler::~Profiler() {
+  stop();
+}
+
+CallStack &Profiler::callStack() {
+  return m_callStack;
+}
+
+// The handler stays installed once the first profiler starts: a signal of the last period may still be pending after
+// the timer is deleted, and the default action of SIGPROF would end the process.
+void Profiler::start() {
+  Profiler *expected = nullptr;
+  if (!active.compare_exchange_strong(expected, this))
+    throw std::logic_error("Another profiler is already running.");
+
+  struct sigaction action {};
+  action.sa_handler = &Profiler::handle;
+  action.sa_flags = SA_RESTART;
+  sigemptyset(&action.sa_mask);
+
+  sigevent event{};
+  event.sigev_notify = SIGEV_THREAD_ID;
+  event.sigev_signo = SIGPROF;
+  event.sigev_notify_thread_id = gettid();
+
+  if (sigaction(SIGPROF, &action, nullptr) != 0 || timer_create(CLOCK_THREAD_CPUTIME_ID, &event, &m_timer) != 0) {
+    const int error = errno;
+    active.store(nullptr);
+    throw std::system_error(error, std::generic_category(), "Can't start the profiler");
+  }
+
+  m_running.store(true);
+  m_drainer = std::thread([this] {
+    while (m_running.load(std::memory_order_relaxed)) {
+      drain();
+      std::this_thread::sleep_for(drainInterval);
+    }
+  });
+
+  const long period = 1'000'000'000L / m_frequency;
+  itimerspec interval{};
+  interval.it_interval.tv_sec = period / 1'000'000'000L;
+  interval.it_interval.tv_nsec = period % 1'000'000'000L;
+  interval.it_value = interval.it_interval;
+  timer_settime(m_timer, 0, &interval, nullptr);
+}
+
+void Profiler::stop() {
+  if (!m_running.exchange(false))
+    return;
+
+  timer_delete(m_timer);
+  active.store(nullptr);
+
+  m_drainer.join();
+  drain();
+}
+
+std::size_t Profiler::samples() const {
+  return m_samples;
+}
+
+std::size_t Profiler::dropped() const {
+  return m_dropped.load();
+}
+
+void Profiler::handle(const int /*signal*/) {
+  if (Profiler *profiler = active.load(std::memory_order_acquire))
+    profiler->sample();
+}
+
+// Runs in the signal handler, on the profiled thread: nothing here may lock or allocate.
+void Profiler::sample() {
+  const std::size_t head = m_head.load(std::memory_order_relaxed);
+  if (head - m_tail.load(std::memory_order_acquire) == ringSize) {
+    m_dropped.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  const std::uint32_t depth = m_callStack.depth();
+  std::atomic_signal_fence(std::memory_order_acquire);
+
+  Sample &sample = m_ring[head % ringSize];
+  sample.depth = depth;
+  std::copy_n(m_callStack.frames().begin(), std::min<std::size_t>(depth, CallStack::capacity), sample.frames.begin());
+
+  m_head.store(head + 1, std::memory_order_release);
+}
+
+void Profiler::drain() {
+  const std::size_t head = m_head.load(std::memory_order_acquire);
+
+  for (std::size_t tail = m_tail.load(std::memory_order_relaxed); tail != head; ++tail) {
+    const Sample &sample = m_ring[tail % ringSize];
+    const auto recorded = static_cast<std::ptrdiff_t>(std::min<std::size_t>(sample.depth, CallStack::capacity));
+
+    std::vector<const FunctionStmt *> stack(sample.frames.begin(), sample.frames.begin() + recorded);
+    if (sample.depth > CallStack::capacity)
+      stack.push_back(nullptr);
+
+    ++m_stacks[std::move(stack)];
+    ++m_samples;
+    m_tail.store(tail + 1, std::memory_order_release);
+  }
+}
+
+void Profiler::writeFolded(std::ostream &out, const std::vector<Stmt> &statements) const {
+  const auto methods = methodNames(statements);
+
+  // Different declarations can print the same, a function redefined on the same line for instance; they are merged.
+  std::map<std::string, std::size_t> lines;
+  for (const auto &[stack, count] : m_stacks) {
+    std::string line = "<script>";
+    for (const FunctionStmt *function : stack) {
+      line += ';';
+      if (function == nullptr) {
+        line += "...";
+        continue;
+      }
+
+      const auto method = methods.find(function);
+      line += method != methods.end() ? method->second : function->name.lexeme;
+      line += ':' + std::to_string(function->name.line);
+    }
+    lines[line] += count;
+  }
+
+  for (const auto &[line, count] : lines)
+    out << line << ' ' << count << '\n';
+}
+
+}
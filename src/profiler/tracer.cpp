@@ -0,0 +1,188 @@
+#include "lox/profiler/tracer.h"
+
+#include <atomic>
+#include <cstdio>
+#include <utility>
+
+namespace lox {
+
+namespace {
+std::atomic<std::uint64_t> tracers = 0;
+
+// The buffer the calling thread records into, valid while the tracer it belongs to is the one with that id.
+struct Cached {
+  std::uint64_t tracer = 0;
+  void *buffer = nullptr;
+};
+thread_local Cached cached;
+
+constexpr std::array<const char *, 3> allocationNames{"instances", "closures", "strings"};
+
+void appendEscaped(std::string &out, const std::string_view text) {
+  for (const char c : text) {
+    if (c == '"' || c == '\\')
+      out += '\\';
+    if (static_cast<unsigned char>(c) >= 0x20)
+      out += c;
+  }
+}
+
+// Trace events count in microseconds.
+void appendMicroseconds(std::string &out, const std::int64_t nanoseconds) {
+  char digits[32];
+  const int length = std::snprintf(digits, sizeof digits, "%lld.%03lld", static_cast<long long>(nanoseconds / 1000),
+                                   static_cast<long long>(nanoseconds % 1000));
+  out.append(digits, static_cast<std::size_t>(length));
+}
+}
+
+Tracer::Tracer(std::ostream &out, const std::chrono::nanoseconds threshold)
+    : m_id(++tracers)
+    , m_out(out)
+    , m_threshold(threshold)
+    , m_origin(Clock::now()) {
+  m_out << R"({"displayTimeUnit": "ms", "traceEvents": [)"
+        << "\n"
+        << R"({"name": "process_name", "ph": "M", "pid": 1, "tid": 0, "args": {"name": "lox"}})";
+}
+
+Tracer::~Tracer() {
+  finish();
+}
+
+std::chrono::nanoseconds Tracer::threshold() const {
+  return m_threshold;
+}
+
+void Tracer::complete(const std::string_view name, const Category category, const Clock::time_point start, const Clock::time_point end) {
+  if (category == Category::Call && end - start < m_threshold)
+    return;
+
+  Buffer &current = buffer();
+  current.events.push_back(Event{'X', category, std::string(name), since(start), since(end) - since(start), {}});
+  if (current.allocationsPending)
+    recordAllocations(current, end);
+  if (current.events.size() >= bufferSize)
+    flush(current);
+}
+
+void Tracer::allocation(const Allocation kind) {
+  Buffer &current = buffer();
+  ++current.allocations[static_cast<std::size_t>(kind)];
+  current.allocationsPending = true;
+
+  // Reading the clock on every allocation would cost more than counting it; every 64th will do.
+  if ((current.allocations[static_cast<std::size_t>(kind)] & 63U) != 0)
+    return;
+
+  const Clock::time_point now = Clock::now();
+  if (now - current.lastAllocations >= allocationInterval) {
+    recordAllocations(current, now);
+    if (current.events.size() >= bufferSize)
+      flush(current);
+  }
+}
+
+void Tracer::nameThread(const std::string &name) {
+  buffer().name = name;
+}
+
+std::size_t Tracer::finish() {
+  const std::lock_guard lock{m_mutex};
+  if (m_finished)
+    return m_written;
+  m_finished = true;
+
+  std::string text;
+  for (const auto &current : m_buffers) {
+    if (current->allocationsPending)
+      recordAllocations(*current, Clock::now());
+    serialize(*current, text);
+    m_written += current->events.size();
+    current->events.clear();
+
+    text += R"(,
+{"name": "thread_name", "ph": "M", "pid": 1, "tid": )";
+    text += std::to_string(current->thread);
+    text += R"(, "args": {"name": ")";
+    appendEscaped(text, current->name);
+    text += "\"}}";
+  }
+
+  m_out << text << "\n]}\n";
+  m_out.flush();
+  return m_written;
+}
+
+Tracer::Buffer &Tracer::buffer() {
+  if (cached.tracer == m_id)
+    return *static_cast<Buffer *>(cached.buffer);
+
+  const std::lock_guard lock{m_mutex};
+  auto &current = m_buffers.emplace_back(std::make_unique<Buffer>());
+  current->thread = static_cast<std::uint32_t>(m_buffers.size());
+  current->name = "thread " + std::to_string(current->thread);
+  current->events.reserve(bufferSize);
+  cached = Cached{m_id, current.get()};
+  return *current;
+}
+
+void Tracer::recordAllocations(Buffer &buffer, const Clock::time_point now) {
+  buffer.events.push_back(Event{'C', Category::Phase, {}, since(now), 0, buffer.allocations});
+  buffer.lastAllocations = now;
+  buffer.allocationsPending = false;
+}
+
+// Formats the events outside the lock, so threads only wait for each other to copy text to the output.
+void Tracer::flush(Buffer &buffer) {
+  std::string text;
+  serialize(buffer, text);
+  const std::size_t events = buffer.events.size();
+  buffer.events.clear();
+
+  const std::lock_guard lock{m_mutex};
+  if (m_finished)
+    return;
+  m_out << text;
+  m_written += events;
+}
+
+void Tracer::serialize(const Buffer &buffer, std::string &out) const {
+  const std::string thread = std::to_string(buffer.thread);
+
+  for (const Event &event : buffer.events) {
+    out += ",\n{\"name\": \"";
+    if (event.type == 'C') {
+      out += "allocations: ";
+      appendEscaped(out, buffer.name);
+      out += R"(", "ph": "C", "ts": )";
+      appendMicroseconds(out, event.start);
+      out += R"(, "pid": 1, "tid": )";
+      out += thread;
+      out += R"(, "args": {)";
+      for (std::size_t kind = 0; kind < allocationKinds; kind++) {
+        out += kind == 0 ? "\"" : ", \"";
+        out += allocationNames[kind];
+        out += "\": ";
+        out += std::to_string(event.values[kind]);
+      }
+      out += "}}";
+      continue;
+    }
+
+    appendEscaped(out, event.name);
+    out += event.category == Category::Call ? R"(", "cat": "call", "ph": "X", "ts": )" : R"(", "cat": "phase", "ph": "X", "ts": )";
+    appendMicroseconds(out, event.start);
+    out += R"(, "dur": )";
+    appendMicroseconds(out, event.duration);
+    out += R"(, "pid": 1, "tid": )";
+    out += thread;
+    out += '}';
+  }
+}
+
+std::int64_t Tracer::since(const Clock::time_point time) const {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(time - m_origin).count();
+}
+
+}
@@ -0,0 +1,80 @@
+#include "lox/program/program.h"
+#include "lox/scanner/scanner.h"
+#include "lox/parser/parser.h"
+#include "lox/optimizer/passmanager.h"
+#include "lox/resolver/resolver.h"
+#include "lox/error/error.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace lox {
+
+CompileError::CompileError(const std::size_t errors)
+    : std::runtime_error(std::to_string(errors).append(errors == 1 ? " compile error" : " compile errors"))
+    , m_errors(errors) {}
+
+std::size_t CompileError::errors() const {
+  return m_errors;
+}
+
+std::shared_ptr<const Program> Program::compile(const std::string &source) {
+  return compile(source, Options{});
+}
+
+// The resolution is keyed by the addresses of the nodes, so the tree is resolved in place, where it stays.
+std::shared_ptr<const Program> Program::compile(const std::string &source, const Options &options) {
+  const std::size_t errorsBefore = reportedErrors();
+
+  std::shared_ptr<Program> program{new Program};
+
+  std::vector<Token> tokens;
+  {
+    const Tracer::Span span{options.tracer, "Scanner"};
+    Scanner scanner{source};
+    tokens = scanner.scan();
+  }
+
+  {
+    const Tracer::Span span{options.tracer, "Parser"};
+    Parser parser{tokens};
+    program->m_statements = parser.parse();
+  }
+
+  {
+    const Tracer::Span span{options.tracer, "Resolver"};
+    Resolver resolver{program->m_resolution};
+    resolver.resolve(program->m_statements);
+  }
+
+  if (const std::size_t errors = reportedErrors() - errorsBefore; errors != 0)
+    throw CompileError(errors);
+
+  // The passes run on a tree the resolver accepted, as they drop branches that could hold an error it would report.
+  // What they leave is resolved afresh, since the resolution is keyed by the nodes they replaced.
+  if (options.optimize) {
+    {
+      const Tracer::Span span{options.tracer, "Optimizer"};
+      PassManager passManager;
+      passManager.run(program->m_statements);
+    }
+
+    const Tracer::Span span{options.tracer, "Resolver"};
+    program->m_resolution = Resolution{};
+    Resolver resolver{program->m_resolution};
+    resolver.resolve(program->m_statements);
+  }
+
+  return program;
+}
+
+const std::vector<Stmt> &Program::statements() const {
+  return m_statements;
+}
+
+const Resolution &Program::resolution() const {
+  return m_resolution;
+}
+
+}
@@ -1,15 +1,22 @@
 #include "lox/resolver/resolver.h"
 #include "lox/ast/stmt.h"
 #include "lox/error/error.h"
+#include "lox/memory/memory.h"
+
+#include <boost/variant/get.hpp>
 
 #include <ranges>
 
 namespace lox {
 
-Resolver::Resolver(const Interpreter &interpreter)
-    : m_interpreter(interpreter) {}
+Resolver::Resolver(Resolution &resolution)
+    : m_resolution(resolution) {}
+
+Resolver::Resolver(Interpreter &interpreter)
+    : Resolver(interpreter.resolution()) {}
 
 void Resolver::resolve(const std::vector<Stmt> &statements) {
+  const memory::Scope scope{memory::Tag::Resolver};
   for (const Stmt &statement : statements)
     resolve(statement);
 }
@@ -19,18 +26,45 @@ void Resolver::resolve(const Stmt &stmt) {
 }
 
 void Resolver::operator()(const BlockStmt &stmt) {
+  beginFrame(stmt.id);
   beginScope();
   resolve(stmt.statements);
   endScope();
+  endFrame();
 }
 
 void Resolver::operator()(const ClassStmt &stmt) {
+  ClassKind enclosingClass = m_currentClass;
+  m_currentClass = ClassKind::Class;
+
+  capture();
   declare(stmt.name);
   define(stmt.name);
 
+  if (const auto *superClass = boost::get<VariableExpr>(&stmt.superClass)) {
+    if (superClass->name.lexeme == stmt.name.lexeme)
+      error(superClass->name, "A class can't inherit from itself.");
+
+    m_currentClass = ClassKind::Subclass;
+    resolve(stmt.superClass);
+
+    beginScope();
+    m_scopes.back()["super"] = true;
+  }
+
+  beginScope();
+  m_scopes.back()["this"] = true;
+
   for (const FunctionStmt &method : stmt.methods) {
-    resolveFunction(method, FunctionKind::Method);
+    resolveFunction(method, method.name.lexeme == "init" ? FunctionKind::Initializer : FunctionKind::Method);
   }
+
+  endScope();
+
+  if (stmt.superClass.which() != 0)
+    endScope();
+
+  m_currentClass = enclosingClass;
 }
 
 void Resolver::operator()(const ExpressionStmt &stmt) {
@@ -38,6 +72,7 @@ void Resolver::operator()(const ExpressionStmt &stmt) {
 }
 
 void Resolver::operator()(const FunctionStmt &stmt) {
+  capture();
   declare(stmt.name);
   define(stmt.name);
   resolveFunction(stmt, FunctionKind::Function);
@@ -59,6 +94,24 @@ void Resolver::operator()(const ReturnStmt &stmt) {
   if (m_currentFunction == FunctionKind::None)
     error(stmt.keyword, "Can't return from top-level code.");
 
+  if (stmt.value.which() != 0) {
+    if (m_currentFunction == FunctionKind::Initializer)
+      error(stmt.keyword, "Can't return a value from an initializer.");
+
+    resolve(stmt.value);
+  }
+
+  // Nothing is left to do in the caller once the callee returns, so its frame can go before the call is made.
+  if (m_currentFunction != FunctionKind::Initializer && boost::get<CallExpr>(&stmt.value) != nullptr)
+    m_resolution.tailCalls.insert(&stmt);
+}
+
+void Resolver::operator()(const YieldStmt &stmt) {
+  if (m_currentFunction == FunctionKind::None)
+    error(stmt.keyword, "Can't yield from top-level code.");
+  else if (m_currentFunction == FunctionKind::Initializer)
+    error(stmt.keyword, "Can't yield from an initializer.");
+
   if (stmt.value.which() != 0)
     resolve(stmt.value);
 }
@@ -86,12 +139,12 @@ void Resolver::resolve(const Expr &expr) {
 
 void Resolver::operator()(const AssignExpr &expr) {
   resolve(expr.value);
-  resolveLocal(expr, expr.name);
+  resolveLocal(expr.name);
 }
 
 void Resolver::operator()(const BinaryExpr &expr) {
   resolve(expr.left);
-  resolve(expr.left);
+  resolve(expr.right);
 }
 
 void Resolver::operator()(const CallExpr &expr) {
@@ -121,16 +174,35 @@ void Resolver::operator()(const SetExpr &expr) {
   resolve(expr.object);
 }
 
+void Resolver::operator()(const SuperExpr &expr) {
+  if (m_currentClass == ClassKind::None)
+    error(expr.keyword, "Can't use 'super' outside of a class.");
+  else if (m_currentClass != ClassKind::Subclass)
+    error(expr.keyword, "Can't use 'super' in a class with no superclass.");
+
+  resolveLocal(expr.keyword);
+}
+
+void Resolver::operator()(const ThisExpr &expr) {
+  if (m_currentClass == ClassKind::None) {
+    error(expr.keyword, "Can't use 'this' outside of a class.");
+    return;
+  }
+
+  resolveLocal(expr.keyword);
+}
+
 void Resolver::operator()(const UnaryExpr &expr) {
   resolve(expr.right);
 }
 
 void Resolver::operator()(const VariableExpr &expr) {
-  if (!m_scopes.empty() && m_scopes.back()[expr.name.lexeme] == false) {
-    error(expr.name, "Can't read local variable in its own initializer.");
+  if (!m_scopes.empty()) {
+    if (const auto it = m_scopes.back().find(expr.name.lexeme); it != m_scopes.back().end() && it->second == false)
+      error(expr.name, "Can't read local variable in its own initializer.");
   }
 
-  resolveLocal(expr, expr.name);
+  resolveLocal(expr.name);
 }
 
 void Resolver::operator()(const auto & /*unused*/) {
@@ -164,16 +236,23 @@ void Resolver::define(const Token &name) {
   m_scopes.back()[name.lexeme] = true;
 }
 
-void Resolver::resolveLocal(const Expr &expr, const Token &name) {
-  for (std::size_t i = 0; const auto &scope : m_scopes | std::views::reverse)
-    if (scope.contains(name.lexeme))
-      m_interpreter.resolve(expr, i++);
+// Locals are keyed by the address of the name token of the referencing node, so two references that look alike
+// (same name, same line) still resolve independently.
+void Resolver::resolveLocal(const Token &name) {
+  for (std::size_t i = 0; const auto &scope : m_scopes | std::views::reverse) {
+    if (scope.contains(name.lexeme)) {
+      m_resolution.locals[&name] = i;
+      return;
+    }
+    ++i;
+  }
 }
 
 void Resolver::resolveFunction(const FunctionStmt &function, const FunctionKind kind) {
   FunctionKind enclosingFunction = m_currentFunction;
   m_currentFunction = kind;
 
+  beginFrame(function.id);
   beginScope();
   for (const Token &param : function.params) {
     declare(param);
@@ -181,8 +260,35 @@ void Resolver::resolveFunction(const FunctionStmt &function, const FunctionKind
   }
   resolve(function.body);
   endScope();
+  endFrame();
 
   m_currentFunction = enclosingFunction;
 }
 
+void Resolver::beginFrame(const std::size_t id) {
+  m_frames.push_back(Frame{id, false});
+}
+
+// A statement is resolved once per copy the optimizer left of it; one captured copy is enough to capture them all.
+void Resolver::endFrame() {
+  const Frame frame = m_frames.back();
+  m_frames.pop_back();
+
+  auto &frames = m_resolution.frames;
+  if (frame.id >= frames.size())
+    frames.resize(frame.id + 1, Resolution::Frame::Unresolved);
+  if (frames[frame.id] != Resolution::Frame::Captured)
+    frames[frame.id] = frame.captured ? Resolution::Frame::Captured : Resolution::Frame::Scoped;
+}
+
+// A closure made here keeps the environments of every frame around it. Frames further out are already captured once
+// an inner one is.
+void Resolver::capture() {
+  for (Frame &frame : m_frames | std::views::reverse) {
+    if (frame.captured)
+      break;
+    frame.captured = true;
+  }
+}
+
 }
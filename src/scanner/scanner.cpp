@@ -1,8 +1,13 @@
 #include "lox/primitives/token.h"
 #include "lox/scanner/scanner.h"
 #include "lox/error/error.h"
+#include "lox/memory/memory.h"
 
+#include <charconv>
+#include <functional>
+#include <cstdint>
 #include <map>
+#include <utility>
 #include <string>
 #include <string_view>
 #include <cstddef>
@@ -21,16 +26,18 @@
 
 namespace lox {
 
-const std::map<std::string, TokenKind> keywords{
+const std::map<std::string, TokenKind, std::less<>> keywords{
     {"and", TokenKind::And},   {"class", TokenKind::Class}, {"else", TokenKind::Else},     {"false", TokenKind::False},
     {"for", TokenKind::For},   {"fun", TokenKind::Fun},     {"if", TokenKind::If},         {"nil", TokenKind::Nil},
     {"or", TokenKind::Or},     {"print", TokenKind::Print}, {"return", TokenKind::Return}, {"super", TokenKind::Super},
-    {"this", TokenKind::This}, {"true", TokenKind::True},   {"var", TokenKind::Var},       {"while", TokenKind::While}};
+    {"this", TokenKind::This}, {"true", TokenKind::True},   {"var", TokenKind::Var},       {"while", TokenKind::While},
+    {"yield", TokenKind::Yield}};
 
 Scanner::Scanner(const std::string &source)
     : m_source(source) {}
 
 std::vector<Token> Scanner::scan() {
+  const memory::Scope scope{memory::Tag::Scanner};
   while (!isAtEnd()) {
     m_start = m_current;
 
@@ -132,14 +139,14 @@ std::vector<Token> Scanner::scan() {
           while (isDigit(peek()))
             advance();
 
-          if (peek() == '.' && isDigit(peekNext()))
+          const bool isFractional = peek() == '.' && isDigit(peekNext());
+          if (isFractional)
             advance();
 
           while (isDigit(peek()))
             advance();
 
-          const double value = std::stod(m_source.substr(m_start, m_current - m_start));
-          addToken(TokenKind::Number, value);
+          addToken(TokenKind::Number, number(isFractional));
         }
 
         else if (isAlpha(c)) {
@@ -147,9 +154,8 @@ std::vector<Token> Scanner::scan() {
             advance();
           }
 
-          const std::string text = m_source.substr(m_start, m_current - m_start);
-          const TokenKind kind = keywords.contains(text) ? keywords.find(text)->second : TokenKind::Identifier;
-          addToken(kind);
+          const auto keyword = keywords.find(lexeme());
+          addToken(keyword != keywords.end() ? keyword->second : TokenKind::Identifier);
         }
 
         else {
@@ -160,12 +166,33 @@ std::vector<Token> Scanner::scan() {
   }
 
   addToken(TokenKind::EndOfFile);
-  return m_tokens;
+  return std::move(m_tokens);
 }
 
 void Scanner::addToken(const TokenKind kind, const Literal &literal) {
-  const std::string text = m_source.substr(m_start, m_current - m_start);
-  m_tokens.push_back(Token{kind, text, literal, m_line});
+  m_tokens.push_back(Token{kind, std::string(lexeme()), literal, m_line});
+}
+
+std::string_view Scanner::lexeme() const {
+  return std::string_view(m_source).substr(m_start, m_current - m_start);
+}
+
+// Converts the lexeme in place, without copying it out of the source. Literals without a fractional part are read as
+// integers, which is exact and cheaper than the floating point parse; only those that overflow take the slow path.
+double Scanner::number(const bool isFractional) const {
+  const std::string_view text = lexeme();
+  const char *first = text.data();
+  const char *last = text.data() + text.size();
+
+  if (!isFractional) {
+    std::uint64_t integer = 0;
+    if (const auto [ptr, ec] = std::from_chars(first, last, integer); ec == std::errc{} && ptr == last)
+      return static_cast<double>(integer);
+  }
+
+  double value = 0;
+  std::from_chars(first, last, value);
+  return value;
 }
 
 char Scanner::peek() const {
@@ -0,0 +1,60 @@
+#include "lox/script/script.h"
+#include "lox/error/error.h"
+
+#include <any>
+#include <span>
+#include <stdexcept>
+#include <string>
+
+namespace lox {
+
+Script::Function::Function(Script &script, const lox::Function &function, const Token &name)
+    : m_script(&script)
+    , m_function(function)
+    , m_name(name) {}
+
+std::size_t Script::Function::arity() const {
+  return m_function.arity();
+}
+
+Literal Script::Function::call(std::span<const Literal> arguments) const {
+  if (arguments.size() != m_function.arity())
+    throw RuntimeError(m_name, std::string("Expected [")
+                                   .append(std::to_string(m_function.arity()))
+                                   .append("] arguments but got ")
+                                   .append(std::to_string(arguments.size()))
+                                   .append("."));
+
+  std::vector<std::any> &values = m_script->m_arguments;
+  values.assign(arguments.begin(), arguments.end());
+
+  const std::any result = m_function.call(m_script->m_interpreter, values);
+
+  if (const auto *literal = std::any_cast<Literal>(&result))
+    return *literal;
+
+  throw RuntimeError(m_name, "Can only return nil, booleans, numbers and strings to the host.");
+}
+
+Script::Script(const std::shared_ptr<const Program> &program)
+    : m_program(program)
+    , m_interpreter(program) {
+  m_interpreter.execute();
+}
+
+Script::Function Script::function(const std::string &name) {
+  const Token token{TokenKind::Identifier, name, nullptr, 0};
+
+  const std::any *value = m_interpreter.globals()->find(token);
+  const auto *function = value == nullptr ? nullptr : std::any_cast<lox::Function>(value);
+  if (function == nullptr)
+    throw std::invalid_argument(std::string("no global function '").append(name).append("'"));
+
+  return Function{*this, *function, token};
+}
+
+Interpreter &Script::interpreter() {
+  return m_interpreter;
+}
+
+}
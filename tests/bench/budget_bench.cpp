@@ -0,0 +1,44 @@
+#include <benchmark/benchmark.h>
+
+#include <chrono>
+
+#include "lox/program/program.h"
+#include "lox/script/script.h"
+
+namespace {
+
+// Calls and loop iterations are the two places that spend a step, so the workload does a lot of both.
+const char *const source = R"(
+  fun fib(n) { if (n < 2) return n; return fib(n - 2) + fib(n - 1); }
+  fun loop(n) { var sum = 0; for (var i = 0; i < n; i = i + 1) sum = sum + i; return sum; }
+  fun work() { return fib(18) + loop(5000); }
+)";
+
+void run(benchmark::State &state, const lox::Interpreter::Budget &budget) {
+  lox::Script script{lox::Program::compile(source)};
+  const lox::Script::Function work = script.function("work");
+
+  for (auto _ : state) {
+    script.interpreter().setBudget(budget);
+    benchmark::DoNotOptimize(work());
+  }
+}
+
+void BM_Unlimited(benchmark::State &state) {
+  run(state, {});
+}
+
+// A step budget and a deadline that are never reached: the cost of counting and of looking at the clock.
+void BM_Limited(benchmark::State &state) {
+  lox::Interpreter::Budget budget;
+  budget.steps = 1'000'000'000;
+  budget.deadline = std::chrono::steady_clock::now() + std::chrono::hours(1);
+  run(state, budget);
+}
+
+}
+
+BENCHMARK(BM_Unlimited);
+BENCHMARK(BM_Limited);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,80 @@
+#include <benchmark/benchmark.h>
+
+#include <malloc.h>
+
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <string>
+
+#include "lox/interpreter/interpreter.h"
+#include "lox/program/program.h"
+#include "lox/script/script.h"
+
+namespace {
+
+const std::string tasks = R"(
+  fun task(steps) {
+    for (var i = 0; i < steps; i = i + 1) yield;
+  }
+
+  // Each task runs up to its first yield before it is scheduled, so that it holds what a suspended task holds.
+  fun start(count, steps) {
+    for (var i = 0; i < count; i = i + 1) {
+      var started = task(steps);
+      resume(started);
+      schedule(started);
+    }
+  }
+
+  fun runAll() {
+    run();
+  }
+)";
+
+constexpr double steps = 10;
+
+std::size_t allocatedBytes() {
+  return mallinfo2().uordblks;
+}
+
+// Starts range(0) tasks that yield `steps` times each and then runs the rest of them all on the scheduler. Only that is
+// timed; the counters report what a suspended task costs on the heap (bytes_per_task, measured once every task ran up
+// to its first yield) and how long a switch from one task to the next takes.
+void BM_ScheduledTasks(benchmark::State &state) {
+  static const std::shared_ptr<const lox::Program> program = lox::Program::compile(tasks);
+  const auto count = static_cast<double>(state.range(0));
+
+  double bytesPerTask = 0;
+  double switches = 0;
+  std::chrono::duration<double> running{};
+
+  for (auto _ : state) {
+    lox::Script script{program};
+    const lox::Script::Function start = script.function("start");
+    const lox::Script::Function runAll = script.function("runAll");
+
+    const std::size_t before = allocatedBytes();
+    start(count, steps);
+    const std::size_t suspended = allocatedBytes();
+
+    const auto began = std::chrono::steady_clock::now();
+    runAll();
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - began;
+
+    state.SetIterationTime(elapsed.count());
+    running += elapsed;
+    bytesPerTask = static_cast<double>(suspended - before) / count;
+    switches += static_cast<double>(script.interpreter().scheduler().switches());
+  }
+
+  state.counters["bytes_per_task"] = bytesPerTask;
+  state.counters["ns_per_switch"] = running.count() * 1e9 / switches;
+  state.counters["switches"] = benchmark::Counter(switches, benchmark::Counter::kIsRate);
+}
+
+}
+
+BENCHMARK(BM_ScheduledTasks)->Arg(1'000)->Arg(100'000)->UseManualTime()->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
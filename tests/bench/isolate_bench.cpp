@@ -0,0 +1,45 @@
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "lox/program/program.h"
+#include "lox/script/script.h"
+
+namespace {
+
+const std::string fib = R"(
+  fun fib(n) {
+    if (n < 2) return n;
+    return fib(n - 2) + fib(n - 1);
+  }
+)";
+
+// Every thread runs its own isolate over the one compiled program. Throughput (items_per_second, over wall time) should
+// grow linearly with the number of threads, up to the number of cores.
+void BM_FibIsolates(benchmark::State &state) {
+  static const std::shared_ptr<const lox::Program> program = lox::Program::compile(fib);
+
+  lox::Script script{program};
+  const lox::Script::Function function = script.function("fib");
+
+  for (auto _ : state)
+    benchmark::DoNotOptimize(function(15));
+
+  state.SetItemsProcessed(state.iterations());
+}
+
+void threadCounts(benchmark::internal::Benchmark *benchmark) {
+  const int cores = static_cast<int>(std::max(1U, std::thread::hardware_concurrency()));
+  for (int threads = 1; threads < cores; threads *= 2)
+    benchmark->Threads(threads);
+  benchmark->Threads(cores);
+}
+
+}
+
+BENCHMARK(BM_FibIsolates)->Apply(threadCounts)->UseRealTime();
+
+BENCHMARK_MAIN();
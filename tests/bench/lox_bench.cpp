@@ -0,0 +1,618 @@
+#include <lox/batch/batch.h>
+#include <lox/concurrency/concurrency.h>
+#include <lox/error/error.h>
+#include <lox/interpreter/interpreter.h>
+#include <lox/memory/memory.h>
+#include <lox/program/program.h>
+
+#include <boost/property_tree/json_parser.hpp>
+#include <boost/property_tree/ptree.hpp>
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <new>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+#include <vector>
+
+// Every allocation of the process is counted, so a run can report how many it made. The counters are only read by the
+// process that ran the benchmark, see measure(). Environments and instances allocate from the resources of
+// lox::memory, which take their memory from malloc rather than operator new; those count their own allocations, but
+// not the bytes.
+namespace {
+std::atomic<std::uint64_t> allocations = 0;
+std::atomic<std::uint64_t> allocatedBytes = 0;
+
+void *allocate(const std::size_t size) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+  if (void *memory = std::malloc(size == 0 ? 1 : size))
+    return memory;
+  throw std::bad_alloc();
+}
+
+void *allocate(const std::size_t size, const std::align_val_t alignment) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+  const auto align = static_cast<std::size_t>(alignment);
+  if (void *memory = std::aligned_alloc(align, (std::max<std::size_t>(size, 1) + align - 1) / align * align))
+    return memory;
+  throw std::bad_alloc();
+}
+}
+
+void *operator new(const std::size_t size) {
+  return allocate(size);
+}
+
+void *operator new[](const std::size_t size) {
+  return allocate(size);
+}
+
+void *operator new(const std::size_t size, const std::align_val_t alignment) {
+  return allocate(size, alignment);
+}
+
+void *operator new[](const std::size_t size, const std::align_val_t alignment) {
+  return allocate(size, alignment);
+}
+
+void operator delete(void *memory) noexcept {
+  std::free(memory);
+}
+
+void operator delete[](void *memory) noexcept {
+  std::free(memory);
+}
+
+void operator delete(void *memory, std::size_t /*size*/) noexcept {
+  std::free(memory);
+}
+
+void operator delete[](void *memory, std::size_t /*size*/) noexcept {
+  std::free(memory);
+}
+
+void operator delete(void *memory, std::align_val_t /*alignment*/) noexcept {
+  std::free(memory);
+}
+
+void operator delete[](void *memory, std::align_val_t /*alignment*/) noexcept {
+  std::free(memory);
+}
+
+void operator delete(void *memory, std::size_t /*size*/, std::align_val_t /*alignment*/) noexcept {
+  std::free(memory);
+}
+
+void operator delete[](void *memory, std::size_t /*size*/, std::align_val_t /*alignment*/) noexcept {
+  std::free(memory);
+}
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// ---- Performance counters ----
+
+struct CounterEvent {
+  const char *name;
+  std::uint32_t type;
+  std::uint64_t config;
+};
+
+constexpr std::uint64_t cacheReadMisses(const std::uint64_t cache) {
+  return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8U) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16U);
+}
+
+constexpr std::array<CounterEvent, 6> counterEvents{{
+    {"cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {"instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {"l1d_misses", PERF_TYPE_HW_CACHE, cacheReadMisses(PERF_COUNT_HW_CACHE_L1D)},
+    {"llc_misses", PERF_TYPE_HW_CACHE, cacheReadMisses(PERF_COUNT_HW_CACHE_LL)},
+    {"branch_misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    {"page_faults", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS},
+}};
+
+enum CounterIndex : std::size_t { Cycles, Instructions };
+
+// Values of counterEvents, -1 for an event that couldn't be counted.
+using CounterValues = std::array<std::int64_t, counterEvents.size()>;
+
+// Counts the events of counterEvents in the calling process, its threads included, through perf_event_open. Only user
+// space is counted, which is all an unprivileged process may count with the default perf_event_paranoid of 2. Any
+// event the kernel, the CPU or a container doesn't offer reads as -1, and the rest are counted regardless.
+class PerfCounters {
+  std::array<int, counterEvents.size()> m_descriptors{};
+  int m_error = 0; // of the first event that couldn't be opened
+
+public:
+  PerfCounters() {
+    for (std::size_t i = 0; i < counterEvents.size(); i++) {
+      perf_event_attr attributes{};
+      attributes.size = sizeof attributes;
+      attributes.type = counterEvents[i].type;
+      attributes.config = counterEvents[i].config;
+      attributes.disabled = 1;
+      attributes.inherit = 1;
+      attributes.exclude_kernel = 1;
+      attributes.exclude_hv = 1;
+      attributes.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+      m_descriptors[i] = static_cast<int>(syscall(SYS_perf_event_open, &attributes, 0, -1, -1, PERF_FLAG_FD_CLOEXEC));
+      if (m_descriptors[i] < 0 && m_error == 0)
+        m_error = errno;
+    }
+  }
+
+  ~PerfCounters() {
+    for (const int descriptor : m_descriptors) {
+      if (descriptor >= 0)
+        close(descriptor);
+    }
+  }
+
+  PerfCounters(const PerfCounters &) = delete;
+  PerfCounters &operator=(const PerfCounters &) = delete;
+
+  // The names of the events that can't be counted, with the reason of the first.
+  std::string unavailable() const {
+    std::string names;
+    for (std::size_t i = 0; i < m_descriptors.size(); i++) {
+      if (m_descriptors[i] < 0)
+        names.append(names.empty() ? "" : ", ").append(counterEvents[i].name);
+    }
+    return names.empty() ? names : names.append(" (").append(std::strerror(m_error)).append(")");
+  }
+
+  void start() const {
+    for (const int descriptor : m_descriptors) {
+      if (descriptor >= 0) {
+        ioctl(descriptor, PERF_EVENT_IOC_RESET, 0);
+        ioctl(descriptor, PERF_EVENT_IOC_ENABLE, 0);
+      }
+    }
+  }
+
+  // When there are more events than hardware counters the kernel takes turns with them; the counts are scaled up to
+  // the whole run.
+  CounterValues stop() const {
+    CounterValues values;
+    values.fill(-1);
+
+    for (std::size_t i = 0; i < m_descriptors.size(); i++) {
+      if (m_descriptors[i] < 0)
+        continue;
+
+      ioctl(m_descriptors[i], PERF_EVENT_IOC_DISABLE, 0);
+      std::array<std::uint64_t, 3> reading{}; // value, time enabled, time running
+      if (read(m_descriptors[i], reading.data(), sizeof reading) != sizeof reading || reading[2] == 0)
+        continue;
+
+      values[i] = static_cast<std::int64_t>(static_cast<double>(reading[0]) * static_cast<double>(reading[1]) /
+                                            static_cast<double>(reading[2]));
+    }
+    return values;
+  }
+};
+
+// ---- Runs ----
+
+// A number that isn't negative, all of the text.
+template <class T>
+std::optional<T> parseNumber(const std::string_view text) {
+  T value{};
+  const char *last = text.data() + text.size();
+  if (text.empty() || text.front() == '-')
+    return std::nullopt;
+  if (const auto [end, error] = std::from_chars(text.data(), last, value); error != std::errc{} || end != last)
+    return std::nullopt;
+  if constexpr (std::is_floating_point_v<T>) {
+    if (!std::isfinite(value))
+      return std::nullopt;
+  }
+  return value;
+}
+
+// Allocation counts repeat from run to run, so an increase fails the comparison; wall time is too noisy for a fixed
+// threshold to tell a regression from a busy machine, so it only does when asked to, by the fastest of the runs.
+struct Options {
+  std::size_t runs = 5;
+  std::size_t warmup = 1;
+  bool counters = true;
+  double allocationThreshold = 0.01;  // relative increase of the allocations that fails the comparison
+  std::optional<double> timeThreshold; // relative increase of the fastest run that does
+  std::optional<std::string> output;
+  std::optional<std::string> baseline;
+};
+
+// What the process running a benchmark sends back through the pipe.
+struct Measurement {
+  std::int64_t nanoseconds = 0;
+  std::uint64_t allocations = 0;
+  std::uint64_t allocatedBytes = 0;
+  CounterValues counters{};
+  bool failed = false;
+};
+
+struct Result {
+  std::string name;
+  std::vector<double> milliseconds; // of the measured runs, sorted
+  long peakRssKilobytes = 0;        // the largest of the runs
+  std::uint64_t allocations = 0;    // of the last run; runs of the same program allocate alike
+  std::uint64_t allocatedBytes = 0;
+  std::vector<CounterValues> counters; // of the measured runs
+  bool failed = false;
+
+  double median() const {
+    const std::size_t n = milliseconds.size();
+    return n % 2 == 1 ? milliseconds[n / 2] : (milliseconds[n / 2 - 1] + milliseconds[n / 2]) / 2;
+  }
+
+  // Nearest rank.
+  double p90() const {
+    const auto rank = static_cast<std::size_t>(std::ceil(0.9 * static_cast<double>(milliseconds.size())));
+    return milliseconds[std::max<std::size_t>(rank, 1) - 1];
+  }
+
+  // The median over the runs, if every run could count the event.
+  std::optional<double> counter(const std::size_t event) const {
+    std::vector<double> values;
+    for (const CounterValues &run : counters) {
+      if (run[event] < 0)
+        return std::nullopt;
+      values.push_back(static_cast<double>(run[event]));
+    }
+    if (values.empty())
+      return std::nullopt;
+
+    std::sort(values.begin(), values.end());
+    const std::size_t n = values.size();
+    return n % 2 == 1 ? values[n / 2] : (values[n / 2 - 1] + values[n / 2]) / 2;
+  }
+
+  std::optional<double> ipc() const {
+    const std::optional<double> cycles = counter(Cycles);
+    const std::optional<double> instructions = counter(Instructions);
+    if (!cycles || !instructions || *cycles == 0)
+      return std::nullopt;
+    return *instructions / *cycles;
+  }
+};
+
+// Compiles and runs the program in the calling process, which is a fresh child of the runner.
+Measurement runProgram(const std::string &source, const bool countEvents) {
+  Measurement measurement;
+  measurement.counters.fill(-1);
+  std::FILE *discard = std::fopen("/dev/null", "w");
+  std::optional<PerfCounters> counters;
+  if (countEvents)
+    counters.emplace();
+
+  allocations.store(0);
+  allocatedBytes.store(0);
+  const std::uint64_t resourceAllocations = lox::memory::statistics().total.allocations;
+  if (counters)
+    counters->start();
+  const auto start = Clock::now();
+  try {
+    const auto program = lox::Program::compile(source);
+    lox::Interpreter interpreter{program, discard};
+    const lox::Concurrency concurrency{interpreter};
+    interpreter.interpret();
+  } catch (const std::exception &e) {
+    std::fprintf(stderr, "aborted: %s\n", e.what());
+    measurement.failed = true;
+  }
+  measurement.nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+  if (counters)
+    measurement.counters = counters->stop();
+  measurement.allocations = allocations.load() + (lox::memory::statistics().total.allocations - resourceAllocations);
+  measurement.allocatedBytes = allocatedBytes.load();
+  measurement.failed = measurement.failed || lox::reportedErrors() != 0;
+  return measurement;
+}
+
+// Every run gets a process of its own, so that its peak RSS and allocations are its own and no run inherits the heap
+// of the one before.
+std::optional<Measurement> measure(const std::string &source, const bool countEvents, long &peakRssKilobytes) {
+  int channel[2];
+  if (pipe(channel) != 0)
+    return std::nullopt;
+
+  std::fflush(nullptr);
+  const pid_t child = fork();
+  if (child < 0)
+    return std::nullopt;
+
+  if (child == 0) {
+    close(channel[0]);
+    const Measurement measurement = runProgram(source, countEvents);
+    const bool sent = write(channel[1], &measurement, sizeof measurement) == sizeof measurement;
+    std::fflush(nullptr);
+    _exit(sent ? 0 : 1);
+  }
+
+  close(channel[1]);
+  Measurement measurement;
+  const bool received = read(channel[0], &measurement, sizeof measurement) == sizeof measurement;
+  close(channel[0]);
+
+  int status = 0;
+  rusage usage{};
+  wait4(child, &status, 0, &usage);
+  if (!received || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+    return std::nullopt;
+
+  peakRssKilobytes = std::max(peakRssKilobytes, usage.ru_maxrss);
+  return measurement;
+}
+
+Result benchmark(const std::filesystem::path &path, const Options &options) {
+  Result result;
+  result.name = path.stem().string();
+
+  std::ifstream fin(path);
+  if (!fin.is_open()) {
+    std::cerr << path.string() << ": can't be read\n";
+    result.failed = true;
+    return result;
+  }
+  const std::string source(std::istreambuf_iterator<char>(fin), {});
+
+  for (std::size_t run = 0; run < options.warmup + options.runs; run++) {
+    long peakRss = 0;
+    const std::optional<Measurement> measurement = measure(source, options.counters, peakRss);
+    if (!measurement || measurement->failed) {
+      std::cerr << path.string() << ": failed\n";
+      result.failed = true;
+      return result;
+    }
+    if (run < options.warmup)
+      continue;
+
+    result.milliseconds.push_back(static_cast<double>(measurement->nanoseconds) / 1e6);
+    result.peakRssKilobytes = std::max(result.peakRssKilobytes, peakRss);
+    result.allocations = measurement->allocations;
+    result.allocatedBytes = measurement->allocatedBytes;
+    result.counters.push_back(measurement->counters);
+  }
+
+  std::sort(result.milliseconds.begin(), result.milliseconds.end());
+  return result;
+}
+
+// One line of whatever events could be counted, none if no event could.
+void printCounters(const Result &result) {
+  std::string line;
+  char text[64];
+  for (std::size_t event = 0; event < counterEvents.size(); event++) {
+    if (const std::optional<double> value = result.counter(event)) {
+      std::snprintf(text, sizeof text, "%s%s %.0f", line.empty() ? "" : ", ", counterEvents[event].name, *value);
+      line += text;
+    }
+    if (const std::optional<double> ipc = result.ipc(); event == Instructions && ipc) {
+      std::snprintf(text, sizeof text, ", ipc %.2f", *ipc);
+      line += text;
+    }
+  }
+
+  if (!line.empty())
+    std::fprintf(stderr, "%-16s %s\n", "", line.c_str());
+}
+
+void writeJson(std::ostream &out, const std::vector<Result> &results, const Options &options) {
+  out << "{\n  \"runs\": " << options.runs << ",\n  \"warmup\": " << options.warmup << ",\n  \"benchmarks\": [";
+
+  const char *separator = "\n";
+  for (const Result &result : results) {
+    if (result.failed)
+      continue;
+
+    out << separator << "    {\"name\": \"" << result.name << "\", \"median_ms\": " << result.median() << ", \"p90_ms\": " << result.p90()
+        << ", \"min_ms\": " << result.milliseconds.front() << ", \"peak_rss_kb\": " << result.peakRssKilobytes
+        << ", \"allocations\": " << result.allocations << ", \"allocated_bytes\": " << result.allocatedBytes;
+    // Only the events that could be counted.
+    for (std::size_t event = 0; event < counterEvents.size(); event++) {
+      if (const std::optional<double> value = result.counter(event))
+        out << ", \"" << counterEvents[event].name << "\": " << static_cast<std::int64_t>(*value);
+    }
+    if (const std::optional<double> ipc = result.ipc())
+      out << ", \"ipc\": " << *ipc;
+    out << "}";
+    separator = ",\n";
+  }
+
+  out << "\n  ]\n}\n";
+}
+
+// The benchmarks of the JSON of an earlier run by name, empty if the file can't be read or isn't such JSON.
+std::optional<std::map<std::string, boost::property_tree::ptree>> readBaseline(const std::string &path) {
+  try {
+    boost::property_tree::ptree baseline;
+    boost::property_tree::read_json(path, baseline);
+
+    std::map<std::string, boost::property_tree::ptree> benchmarks;
+    for (const auto &[key, benchmark] : baseline.get_child("benchmarks")) {
+      benchmark.get<double>("min_ms");
+      benchmark.get<double>("allocations");
+      benchmarks.emplace(benchmark.get<std::string>("name"), benchmark);
+    }
+    return benchmarks;
+  } catch (const boost::property_tree::ptree_error &) {
+    return std::nullopt;
+  }
+}
+
+// Returns whether any benchmark regressed beyond the thresholds. Benchmarks missing from either side are only noted.
+bool compare(const std::vector<Result> &results, const std::map<std::string, boost::property_tree::ptree> &previous,
+             const Options &options) {
+  const auto change = [](const double now, const double before) {
+    return before == 0 ? 0 : now / before - 1;
+  };
+
+  bool regressed = false;
+  for (const Result &result : results) {
+    const auto found = previous.find(result.name);
+    if (result.failed || found == previous.end()) {
+      std::fprintf(stderr, "%-16s not in the baseline\n", result.name.c_str());
+      continue;
+    }
+
+    const double time = change(result.milliseconds.front(), found->second.get<double>("min_ms"));
+    const double allocated = change(static_cast<double>(result.allocations), found->second.get<double>("allocations"));
+    const bool slower = allocated > options.allocationThreshold || (options.timeThreshold && time > *options.timeThreshold);
+    regressed = regressed || slower;
+
+    std::fprintf(stderr, "%-16s fastest %+6.1f%%%s, allocations %+6.1f%%  %s\n", result.name.c_str(), time * 100,
+                 options.timeThreshold ? "" : " (not gated)", allocated * 100, slower ? "REGRESSION" : "ok");
+  }
+
+  return regressed;
+}
+
+}
+
+int main(int argc, const char *const argv[]) {
+  const std::vector<std::string> arguments(argv + 1, argv + argc);
+
+  const std::string menu = R"(usage: lox-bench [options] <file|dir|list>...
+Runs each program in a process of its own, warmup + runs times, and writes the timings as JSON.
+Options:
+--runs=N            : measured runs per program (default 5)
+--warmup=N          : runs per program before measuring (default 1)
+--output=FILE       : write the JSON to FILE instead of stdout
+--baseline=FILE     : compare with the JSON of an earlier run, exit with 1 if a program regressed
+--alloc-threshold=F : relative increase of the allocations counting as a regression (default 0.01)
+--time-threshold=F  : relative increase of the fastest run counting as a regression; unless given, times are only
+                      reported, as they vary by more than 10% between runs of the same build on a busy machine
+--no-counters       : don't read the performance counters (cycles, instructions, cache and branch misses, page faults)
+)";
+
+  Options options;
+  std::vector<std::filesystem::path> programs;
+
+  const auto value = [](const std::string &argument, const std::string_view option) -> std::optional<std::string> {
+    if (argument.starts_with(option))
+      return argument.substr(option.size());
+    return std::nullopt;
+  };
+
+  std::optional<std::string> malformed; // the last numeric option whose value doesn't parse
+  // The number after the option, 0 if it is malformed, which is noted.
+  const auto count = [&malformed](const std::string &argument, const std::string &text) {
+    const std::optional<std::size_t> parsed = parseNumber<std::size_t>(text);
+    if (!parsed)
+      malformed = argument;
+    return parsed.value_or(0);
+  };
+  const auto fraction = [&malformed](const std::string &argument, const std::string &text) {
+    const std::optional<double> parsed = parseNumber<double>(text);
+    if (!parsed)
+      malformed = argument;
+    return parsed.value_or(0);
+  };
+
+  for (const std::string &argument : arguments) {
+    if (argument == "--help" || argument == "-h") {
+      std::cout << menu;
+      return 0;
+    }
+
+    if (const auto runs = value(argument, "--runs="))
+      options.runs = std::max<std::size_t>(count(argument, *runs), 1);
+    else if (const auto warmup = value(argument, "--warmup="))
+      options.warmup = count(argument, *warmup);
+    else if (const auto threshold = value(argument, "--alloc-threshold="))
+      options.allocationThreshold = fraction(argument, *threshold);
+    else if (const auto threshold = value(argument, "--time-threshold="))
+      options.timeThreshold = fraction(argument, *threshold);
+    else if (const auto output = value(argument, "--output="))
+      options.output = *output;
+    else if (const auto baseline = value(argument, "--baseline="))
+      options.baseline = *baseline;
+    else if (argument == "--no-counters")
+      options.counters = false;
+    else if (std::filesystem::is_regular_file(argument) && std::filesystem::path(argument).extension() == ".lox")
+      programs.emplace_back(argument);
+    else {
+      const auto collected = lox::Batch::collect(argument);
+      programs.insert(programs.end(), collected.begin(), collected.end());
+    }
+  }
+
+  if (malformed) {
+    std::cerr << "Malformed option " << *malformed << "\n" << menu;
+    return 1;
+  }
+
+  if (programs.empty()) {
+    std::cerr << menu;
+    return 1;
+  }
+
+  // Read up front, so that a bad path fails before the benchmarks run rather than after.
+  std::optional<std::map<std::string, boost::property_tree::ptree>> baseline;
+  if (options.baseline) {
+    baseline = readBaseline(*options.baseline);
+    if (!baseline) {
+      std::cerr << *options.baseline << ": can't be read as the JSON of lox-bench\n";
+      return 1;
+    }
+  }
+
+  if (options.counters) {
+    if (const std::string missing = PerfCounters{}.unavailable(); !missing.empty())
+      std::cerr << "lox-bench: can't count " << missing << " here, leaving them out\n";
+  }
+
+  std::vector<Result> results;
+  bool failed = false;
+  for (const auto &program : programs) {
+    results.push_back(benchmark(program, options));
+    const Result &result = results.back();
+    failed = failed || result.failed;
+
+    if (!result.failed) {
+      std::fprintf(stderr, "%-16s median %10.2f ms, p90 %10.2f ms, peak RSS %8ld kB, %10llu allocations\n", result.name.c_str(),
+                   result.median(), result.p90(), result.peakRssKilobytes, static_cast<unsigned long long>(result.allocations));
+      printCounters(result);
+    }
+  }
+
+  if (options.output) {
+    std::ofstream out(*options.output);
+    writeJson(out, results, options);
+  } else {
+    writeJson(std::cout, results, options);
+  }
+
+  if (baseline && compare(results, *baseline, options))
+    failed = true;
+
+  return failed ? 1 : 0;
+}
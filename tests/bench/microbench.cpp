@@ -0,0 +1,319 @@
+#include <benchmark/benchmark.h>
+
+#include <any>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "lox/callable/class/class.h"
+#include "lox/callable/class/instance.h"
+#include "lox/environment/environment.h"
+#include "lox/parser/parser.h"
+#include "lox/primitives/literal.h"
+#include "lox/primitives/token.h"
+#include "lox/resolver/resolution.h"
+#include "lox/resolver/resolver.h"
+#include "lox/scanner/scanner.h"
+
+// One benchmark per hot entry point of a component, each over a range of input sizes; Complexity() fits the timings to
+// a curve so that a change in how a component scales shows up as well as a change in its constant factor.
+namespace {
+
+lox::Token identifier(const std::string &name) {
+  return lox::Token{lox::TokenKind::Identifier, name, nullptr, 1};
+}
+
+std::string name(const std::size_t i) {
+  return "name" + std::to_string(i);
+}
+
+std::vector<lox::Stmt> parse(const std::string &source) {
+  lox::Scanner scanner{source};
+  lox::Parser parser{scanner.scan()};
+  return parser.parse();
+}
+
+// ---- Scanner ----
+
+// Statements of the kind most programs are made of: keywords, identifiers, numbers and operators.
+std::string statements(const std::size_t count) {
+  std::string source;
+  for (std::size_t i = 0; i < count; i++) {
+    source.append("var ").append(name(i)).append(" = ").append(name(i / 2)).append(" * 2.5 + ").append(std::to_string(i));
+    source.append(i % 4 == 3 ? ";\n" : "; ");
+  }
+  return source;
+}
+
+std::string strings(const std::size_t count) {
+  std::string source;
+  for (std::size_t i = 0; i < count; i++)
+    source.append("print \"a string literal of some length, number ").append(std::to_string(i)).append("\";\n");
+  return source;
+}
+
+void scan(benchmark::State &state, const std::string &source) {
+  for (auto _ : state) {
+    lox::Scanner scanner{source};
+    benchmark::DoNotOptimize(scanner.scan());
+  }
+
+  state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() * source.size()));
+  state.SetComplexityN(state.range(0));
+}
+
+void BM_ScanStatements(benchmark::State &state) {
+  scan(state, statements(static_cast<std::size_t>(state.range(0))));
+}
+
+void BM_ScanStrings(benchmark::State &state) {
+  scan(state, strings(static_cast<std::size_t>(state.range(0))));
+}
+
+// ---- Parser ----
+
+void parseTokens(benchmark::State &state, const std::string &source) {
+  lox::Scanner scanner{source};
+  const std::vector<lox::Token> tokens = scanner.scan();
+
+  for (auto _ : state) {
+    lox::Parser parser{tokens};
+    benchmark::DoNotOptimize(parser.parse());
+  }
+
+  state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * tokens.size()));
+  state.SetComplexityN(state.range(0));
+}
+
+// print (1 + (1 + (... + 1))); nested `depth` levels, every level a full descent of the grammar.
+void BM_ParseDeepExpression(benchmark::State &state) {
+  const auto depth = static_cast<std::size_t>(state.range(0));
+  std::string source = "print ";
+  for (std::size_t i = 0; i < depth; i++)
+    source.append("(1 + ");
+  source.append("1").append(depth, ')').append(";");
+
+  parseTokens(state, source);
+}
+
+// print 1 + 2 * 3 - 4 ...; with `width` operands in one flat expression.
+void BM_ParseWideExpression(benchmark::State &state) {
+  const auto width = static_cast<std::size_t>(state.range(0));
+  const char operators[] = {'+', '*', '-', '/'};
+  std::string source = "print 0";
+  for (std::size_t i = 1; i < width; i++)
+    source.append(" ").append(1, operators[i % 4]).append(" ").append(std::to_string(i));
+  source.append(";");
+
+  parseTokens(state, source);
+}
+
+// ---- Resolver ----
+
+// A function with `depth` nested blocks; each declares a variable and reads the one of the enclosing block and one
+// halfway up, so lookups walk further up the scopes the deeper they are.
+void BM_ResolveNestedScopes(benchmark::State &state) {
+  const auto depth = static_cast<std::size_t>(state.range(0));
+  std::string source = "fun f() { var " + name(0) + " = 0;";
+  for (std::size_t i = 1; i < depth; i++)
+    source.append(" { var ").append(name(i)).append(" = ").append(name(i - 1)).append(" + ").append(name(i / 2)).append(";");
+  source.append(std::string(depth - 1, '}')).append(" }");
+
+  const std::vector<lox::Stmt> program = parse(source);
+
+  for (auto _ : state) {
+    lox::Resolution resolution;
+    lox::Resolver resolver{resolution};
+    resolver.resolve(program);
+    benchmark::DoNotOptimize(resolution.locals.size());
+  }
+
+  state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * state.range(0)));
+  state.SetComplexityN(state.range(0));
+}
+
+// ---- Environment ----
+
+// A chain of `depth` environments, the innermost last, each holding a few variables of its own.
+std::vector<std::shared_ptr<lox::Environment>> chain(const std::size_t depth) {
+  std::vector<std::shared_ptr<lox::Environment>> environments{std::make_shared<lox::Environment>()};
+  environments.front()->define(identifier("global"), lox::Literal{1.0});
+
+  for (std::size_t i = 1; i < depth; i++) {
+    environments.push_back(std::make_shared<lox::Environment>(environments.back()));
+    for (std::size_t j = 0; j < 4; j++)
+      environments.back()->define(identifier(name(j)), lox::Literal{static_cast<double>(j)});
+  }
+
+  return environments;
+}
+
+void BM_EnvironmentDefine(benchmark::State &state) {
+  const auto count = static_cast<std::size_t>(state.range(0));
+  std::vector<lox::Token> names;
+  for (std::size_t i = 0; i < count; i++)
+    names.push_back(identifier(name(i)));
+
+  for (auto _ : state) {
+    lox::Environment environment;
+    for (const lox::Token &token : names)
+      environment.define(token, lox::Literal{1.0});
+    benchmark::DoNotOptimize(environment);
+  }
+
+  state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * state.range(0)));
+  state.SetComplexityN(state.range(0));
+}
+
+// Looks a global up by name from `depth` environments down: a hash lookup that misses in every one on the way.
+void BM_EnvironmentGet(benchmark::State &state) {
+  const auto environments = chain(static_cast<std::size_t>(state.range(0)));
+  const lox::Token global = identifier("global");
+
+  for (auto _ : state)
+    benchmark::DoNotOptimize(environments.back()->get(global));
+
+  state.SetComplexityN(state.range(0));
+}
+
+// The same lookup with the distance the resolver computed: a walk up the chain and one hash lookup.
+void BM_EnvironmentGetAt(benchmark::State &state) {
+  const auto depth = static_cast<std::size_t>(state.range(0));
+  const auto environments = chain(depth);
+  const lox::Token global = identifier("global");
+
+  for (auto _ : state)
+    benchmark::DoNotOptimize(environments.back()->getAt(global, depth - 1));
+
+  state.SetComplexityN(state.range(0));
+}
+
+// ---- Literal ----
+
+lox::Literal text(const std::size_t length) {
+  return lox::Literal{std::string(length, 'x')};
+}
+
+void BM_LiteralCopyString(benchmark::State &state) {
+  const lox::Literal literal = text(static_cast<std::size_t>(state.range(0)));
+
+  for (auto _ : state) {
+    lox::Literal copy = literal;
+    benchmark::DoNotOptimize(copy);
+  }
+
+  state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() * state.range(0)));
+  state.SetComplexityN(state.range(0));
+}
+
+// Equal strings, so the comparison has to look at every character.
+void BM_LiteralCompareString(benchmark::State &state) {
+  const lox::Literal left = text(static_cast<std::size_t>(state.range(0)));
+  const lox::Literal right = text(static_cast<std::size_t>(state.range(0)));
+
+  for (auto _ : state)
+    benchmark::DoNotOptimize(left == right);
+
+  state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() * state.range(0)));
+  state.SetComplexityN(state.range(0));
+}
+
+void BM_LiteralCopyNumber(benchmark::State &state) {
+  const lox::Literal literal{3.25};
+
+  for (auto _ : state) {
+    lox::Literal copy = literal;
+    benchmark::DoNotOptimize(copy);
+  }
+}
+
+void BM_LiteralCompareNumber(benchmark::State &state) {
+  const lox::Literal left{3.25};
+  const lox::Literal right{3.25};
+
+  for (auto _ : state)
+    benchmark::DoNotOptimize(left == right);
+}
+
+// What print does to a number: integral values print without a fraction, the others in full.
+void BM_LiteralStringifyNumber(benchmark::State &state) {
+  std::vector<lox::Literal> numbers;
+  for (std::size_t i = 0; i < 64; i++)
+    numbers.emplace_back(i % 2 == 0 ? static_cast<double>(i) : static_cast<double>(i) / 7);
+
+  std::size_t i = 0;
+  for (auto _ : state)
+    benchmark::DoNotOptimize(static_cast<std::string>(numbers[i++ % numbers.size()]));
+}
+
+void BM_LiteralStringifyString(benchmark::State &state) {
+  const lox::Literal literal = text(static_cast<std::size_t>(state.range(0)));
+
+  for (auto _ : state)
+    benchmark::DoNotOptimize(static_cast<std::string>(literal));
+
+  state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() * state.range(0)));
+  state.SetComplexityN(state.range(0));
+}
+
+// ---- Instance ----
+
+std::shared_ptr<lox::Instance> instance(const std::size_t fields) {
+  auto object = std::make_shared<lox::Instance>(lox::Class{"Object", std::nullopt, {}});
+  for (std::size_t i = 0; i < fields; i++)
+    object->set(identifier(name(i)), lox::Literal{static_cast<double>(i)});
+  return object;
+}
+
+void BM_InstanceGet(benchmark::State &state) {
+  const auto fields = static_cast<std::size_t>(state.range(0));
+  const auto object = instance(fields);
+  const lox::Token field = identifier(name(fields / 2));
+
+  for (auto _ : state)
+    benchmark::DoNotOptimize(object->get(field));
+
+  state.SetComplexityN(state.range(0));
+}
+
+void BM_InstanceSet(benchmark::State &state) {
+  const auto fields = static_cast<std::size_t>(state.range(0));
+  const auto object = instance(fields);
+  const lox::Token field = identifier(name(fields / 2));
+  const std::any value = lox::Literal{2.0};
+
+  for (auto _ : state)
+    object->set(field, value);
+
+  state.SetComplexityN(state.range(0));
+}
+
+}
+
+BENCHMARK(BM_ScanStatements)->RangeMultiplier(8)->Range(64, 64 << 12)->Complexity();
+BENCHMARK(BM_ScanStrings)->RangeMultiplier(8)->Range(64, 64 << 12)->Complexity();
+
+BENCHMARK(BM_ParseDeepExpression)->RangeMultiplier(4)->Range(4, 1024)->Complexity();
+BENCHMARK(BM_ParseWideExpression)->RangeMultiplier(8)->Range(8, 8 << 9)->Complexity();
+
+BENCHMARK(BM_ResolveNestedScopes)->RangeMultiplier(4)->Range(4, 1024)->Complexity();
+
+BENCHMARK(BM_EnvironmentDefine)->RangeMultiplier(8)->Range(1, 4096)->Complexity();
+BENCHMARK(BM_EnvironmentGet)->RangeMultiplier(4)->Range(1, 1024)->Complexity();
+BENCHMARK(BM_EnvironmentGetAt)->RangeMultiplier(4)->Range(1, 1024)->Complexity();
+
+BENCHMARK(BM_LiteralCopyNumber);
+BENCHMARK(BM_LiteralCompareNumber);
+BENCHMARK(BM_LiteralStringifyNumber);
+BENCHMARK(BM_LiteralCopyString)->RangeMultiplier(8)->Range(8, 8 << 12)->Complexity();
+BENCHMARK(BM_LiteralCompareString)->RangeMultiplier(8)->Range(8, 8 << 12)->Complexity();
+BENCHMARK(BM_LiteralStringifyString)->RangeMultiplier(8)->Range(8, 8 << 12)->Complexity();
+
+BENCHMARK(BM_InstanceGet)->RangeMultiplier(8)->Range(1, 4096)->Complexity();
+BENCHMARK(BM_InstanceSet)->RangeMultiplier(8)->Range(1, 4096)->Complexity();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,53 @@
+#include <benchmark/benchmark.h>
+
+#include "lox/profiler/profiler.h"
+#include "lox/program/program.h"
+#include "lox/script/script.h"
+
+namespace {
+
+// Call heavy, so keeping the call stack costs as much as it ever does relative to the work.
+const char *const source = R"(
+  fun fib(n) { if (n < 2) return n; return fib(n - 2) + fib(n - 1); }
+)";
+
+void BM_Unprofiled(benchmark::State &state) {
+  lox::Script script{lox::Program::compile(source)};
+  const lox::Script::Function fib = script.function("fib");
+
+  for (auto _ : state)
+    benchmark::DoNotOptimize(fib(20));
+}
+
+// The interpreter records its calls but nothing samples them.
+void BM_CallStack(benchmark::State &state) {
+  lox::Script script{lox::Program::compile(source)};
+  const lox::Script::Function fib = script.function("fib");
+  lox::Profiler profiler;
+  script.interpreter().setCallStack(&profiler.callStack());
+
+  for (auto _ : state)
+    benchmark::DoNotOptimize(fib(20));
+}
+
+void BM_Profiled(benchmark::State &state) {
+  lox::Script script{lox::Program::compile(source)};
+  const lox::Script::Function fib = script.function("fib");
+  lox::Profiler profiler;
+  script.interpreter().setCallStack(&profiler.callStack());
+  profiler.start();
+
+  for (auto _ : state)
+    benchmark::DoNotOptimize(fib(20));
+
+  profiler.stop();
+  state.counters["samples"] = static_cast<double>(profiler.samples());
+}
+
+}
+
+BENCHMARK(BM_Unprofiled);
+BENCHMARK(BM_CallStack);
+BENCHMARK(BM_Profiled);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,39 @@
+#include <benchmark/benchmark.h>
+
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+#include "lox/scanner/scanner.h"
+
+namespace {
+
+// One million numeric literals, alternating integral and fractional forms, laid out like a generated data file.
+std::string numericLiterals(const std::size_t count) {
+  std::string source;
+  for (std::size_t i = 0; i < count; ++i) {
+    source.append(std::to_string(i * 7919 % 1000003));
+    if (i % 2 != 0)
+      source.append(".").append(std::to_string(i % 997));
+    source.append(i % 16 == 15 ? ";\n" : ", ");
+  }
+  return source;
+}
+
+void BM_ScanNumericLiterals(benchmark::State &state) {
+  const std::string source = numericLiterals(1'000'000);
+
+  for (auto _ : state) {
+    lox::Scanner scanner{source};
+    benchmark::DoNotOptimize(scanner.scan());
+  }
+
+  state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() * source.size()));
+  state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * 1'000'000));
+}
+
+}
+
+BENCHMARK(BM_ScanNumericLiterals)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
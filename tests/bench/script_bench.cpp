@@ -0,0 +1,63 @@
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "lox/interpreter/interpreter.h"
+#include "lox/parser/parser.h"
+#include "lox/program/program.h"
+#include "lox/resolver/resolver.h"
+#include "lox/scanner/scanner.h"
+#include "lox/script/script.h"
+
+namespace {
+
+// A per-request rule of the kind a service evaluates: a couple of comparisons on the request's fields.
+const std::string rule = R"(
+  var limit = 1000;
+
+  fun allow(amount, country) {
+    if (country == "XX") return false;
+    return amount <= limit;
+  }
+)";
+
+// Compiled once, then called through the embedding API.
+void BM_CallCompiledRule(benchmark::State &state) {
+  lox::Script script{lox::Program::compile(rule)};
+  const lox::Script::Function allow = script.function("allow");
+
+  double amount = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(allow(amount, "FR"));
+    amount = amount < 2000 ? amount + 1 : 0;
+  }
+
+  state.SetItemsProcessed(state.iterations());
+}
+
+// What an embedder had to do before: scan, parse, resolve and run the whole source for every evaluation.
+void BM_RecompileRule(benchmark::State &state) {
+  const std::string source = rule + "allow(500, \"FR\");";
+
+  for (auto _ : state) {
+    lox::Scanner scanner{source};
+    lox::Parser parser{scanner.scan()};
+    const std::vector<lox::Stmt> statements = parser.parse();
+
+    lox::Interpreter interpreter{statements};
+    lox::Resolver resolver{interpreter};
+    resolver.resolve(statements);
+    interpreter.interpret();
+  }
+
+  state.SetItemsProcessed(state.iterations());
+}
+
+}
+
+BENCHMARK(BM_CallCompiledRule);
+BENCHMARK(BM_RecompileRule);
+
+BENCHMARK_MAIN();
@@ -1,36 +1,395 @@
 #include <lox/scanner/scanner.h>
 #include <lox/parser/parser.h>
 #include <lox/resolver/resolver.h>
+#include <lox/optimizer/passmanager.h>
 #include <lox/interpreter/interpreter.h>
+#include <lox/interpreter/heapsnapshot.h>
 #include <lox/astprinter/astprinter.h>
+#include <lox/batch/batch.h>
+#include <lox/concurrency/concurrency.h>
+#include <lox/profiler/profiler.h>
+#include <lox/profiler/tracer.h>
+#include <lox/ast/nodecounter.h>
+#include <lox/ast/statementlines.h>
+#include <lox/memory/memory.h>
 
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <optional>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <system_error>
 #include <iterator>
 #include <fstream>
 #include <cassert>
 #include <iostream>
+#include <map>
+#include <memory>
 #include <algorithm>
+#include <utility>
 #include <vector>
 
 namespace {
 
 bool prettyprint = false;
+bool optimize = false;
+bool optimizerStatistics = false;
+bool adaptive = false;
+bool jit = false;
+bool explicitStack = false;
+std::size_t maxDepth = lox::Machine::defaultMaxDepth;
+lox::Interpreter::Budget budget;
+std::optional<std::chrono::milliseconds> timeout;
+std::optional<std::string> profile;
+std::optional<std::string> trace;
+std::size_t hotspots = 0; // lines to report, none without --hotspots
+std::chrono::microseconds traceThreshold = std::chrono::duration_cast<std::chrono::microseconds>(lox::Tracer::defaultThreshold);
+enum class StatsFormat { None, Text, Json } stats = StatsFormat::None;
+bool memoryStatistics = false;
+std::optional<std::string> heapSnapshot;
+std::optional<std::string> heapDiff; // the snapshot to compare the heap at the end of the run with
+
+// Wall time, allocations and peak heap of each phase of run(), one after the other.
+class Phases {
+public:
+  struct Phase {
+    std::string name;
+    std::chrono::nanoseconds wall{};
+    std::uint64_t allocations = 0;
+    std::int64_t peakBytes = 0; // in use at the high point of the phase
+  };
+
+private:
+  std::vector<Phase> m_phases;
+  std::chrono::steady_clock::time_point m_start;
+  std::uint64_t m_allocations = 0;
+
+public:
+  // Ends the phase running, if any.
+  void start(const std::string &name) {
+    stop();
+    m_phases.push_back(Phase{name});
+    if (stats != StatsFormat::None)
+      lox::memory::resetPeaks();
+    m_allocations = lox::memory::statistics().total.allocations;
+    m_start = std::chrono::steady_clock::now();
+  }
+
+  void stop() {
+    if (m_phases.empty() || m_phases.back().wall.count() != 0)
+      return;
+
+    Phase &phase = m_phases.back();
+    phase.wall = std::max(std::chrono::steady_clock::now() - m_start, std::chrono::nanoseconds(1));
+    const lox::memory::Usage usage = lox::memory::statistics().total;
+    phase.allocations = usage.allocations - m_allocations;
+    phase.peakBytes = usage.peakBytes;
+  }
+
+  const std::vector<Phase> &phases() const {
+    return m_phases;
+  }
+};
+
+struct Statistics {
+  Phases phases;
+  std::size_t tokens = 0;
+  std::size_t nodes = 0;
+  std::size_t resolvedLocals = 0;
+  lox::Interpreter::Counters counters;
+};
+
+// The value of a numeric option: digits and nothing else, in the range of T; no sign, even where T has one.
+template <class T>
+std::optional<T> parseCount(const std::string_view text) {
+  T value{};
+  const char *last = text.data() + text.size();
+  if (text.empty() || text.front() == '-')
+    return std::nullopt;
+  if (const auto [end, error] = std::from_chars(text.data(), last, value); error != std::errc{} || end != last)
+    return std::nullopt;
+  return value;
+}
+
+double milliseconds(const std::chrono::nanoseconds duration) {
+  return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+// Everything before the interpreter runs is startup; the interpreter phase is execution.
+void printStatistics(const Statistics &statistics) {
+  const auto &phases = statistics.phases.phases();
+  const auto &counters = statistics.counters;
+
+  double startup = 0;
+  double execution = 0;
+  for (const auto &phase : phases)
+    (phase.name == "interpret" ? execution : startup) += milliseconds(phase.wall);
+
+  if (stats == StatsFormat::Json) {
+    std::fprintf(stderr, "{\n  \"phases\": [");
+    const char *separator = "\n";
+    for (const auto &phase : phases) {
+      std::fprintf(stderr, "%s    {\"name\": \"%s\", \"wall_ms\": %.3f, \"allocations\": %llu, \"peak_heap_bytes\": %lld}", separator,
+                   phase.name.c_str(), milliseconds(phase.wall), static_cast<unsigned long long>(phase.allocations),
+                   static_cast<long long>(phase.peakBytes));
+      separator = ",\n";
+    }
+    std::fprintf(stderr, "\n  ],\n  \"startup_ms\": %.3f,\n  \"execution_ms\": %.3f,\n", startup, execution);
+    std::fprintf(stderr, "  \"tokens\": %zu,\n  \"ast_nodes\": %zu,\n  \"resolved_locals\": %zu,\n", statistics.tokens, statistics.nodes,
+                 statistics.resolvedLocals);
+    std::fprintf(stderr, "  \"runtime\": {\"calls\": %zu, \"property_gets\": %zu, \"property_sets\": %zu, \"string_allocations\": %zu, ",
+                 counters.calls, counters.propertyGets, counters.propertySets, counters.stringAllocations);
+    std::fprintf(stderr, "\"global_lookups\": %zu, \"local_lookups_by_depth\": [", counters.globalLookups);
+    for (std::size_t depth = 0; depth < counters.localLookups.size(); depth++)
+      std::fprintf(stderr, "%s%zu", depth == 0 ? "" : ", ", counters.localLookups[depth]);
+    std::fprintf(stderr, "]}\n}\n");
+    return;
+  }
+
+  std::fprintf(stderr, "stats: %-10s %12s %12s %14s\n", "phase", "wall ms", "allocations", "peak heap kB");
+  for (const auto &phase : phases)
+    std::fprintf(stderr, "stats: %-10s %12.3f %12llu %14.1f\n", phase.name.c_str(), milliseconds(phase.wall),
+                 static_cast<unsigned long long>(phase.allocations), static_cast<double>(phase.peakBytes) / 1024);
+
+  const double total = std::max(startup + execution, 1e-9);
+  std::fprintf(stderr, "stats: startup %.3f ms (%.0f%%), execution %.3f ms (%.0f%%)\n", startup, 100 * startup / total, execution,
+               100 * execution / total);
+  std::fprintf(stderr, "stats: %zu tokens, %zu AST nodes, %zu resolved locals\n", statistics.tokens, statistics.nodes,
+               statistics.resolvedLocals);
+  std::fprintf(stderr, "stats: %zu calls, %zu property gets, %zu property sets, %zu string allocations\n", counters.calls,
+               counters.propertyGets, counters.propertySets, counters.stringAllocations);
+  std::fprintf(stderr, "stats: variable lookups: %zu global; local by depth", counters.globalLookups);
+  for (std::size_t depth = 0; depth < counters.localLookups.size(); depth++)
+    std::fprintf(stderr, " %zu%s: %zu", depth, depth + 1 == counters.localLookups.size() ? "+" : "", counters.localLookups[depth]);
+  std::fprintf(stderr, "\n");
+}
+
+// Live bytes are those still allocated at the end of the run, the program's AST and globals among them. With --stats the
+// peaks are those of the last phase, which starts them over.
+void printMemoryStatistics(const lox::memory::Statistics &statistics) {
+  const auto print = [](const char *name, const lox::memory::Usage &usage) {
+    std::fprintf(stderr, "memory: %-12s %12.1f %12.1f %12llu\n", name, static_cast<double>(usage.liveBytes) / 1024,
+                 static_cast<double>(usage.peakBytes) / 1024, static_cast<unsigned long long>(usage.allocations));
+  };
+
+  std::fprintf(stderr, "memory: %-12s %12s %12s %12s\n", "tag", "live kB", "peak kB", "allocations");
+  for (std::size_t tag = 0; tag < lox::memory::tagCount; tag++)
+    print(lox::memory::name(static_cast<lox::memory::Tag>(tag)), statistics.tags[tag]);
+  print("total", statistics.total);
+}
+
+// The entries that changed the most, growth first.
+void printHeapDiff(const std::vector<lox::HeapSnapshot::Change> &changes) {
+  constexpr std::size_t shown = 20;
+
+  std::fprintf(stderr, "heap diff: %-12s %-24s %10s %12s\n", "kind", "name", "count", "bytes");
+  for (std::size_t i = 0; i < std::min(changes.size(), shown); i++) {
+    const auto &change = changes[i];
+    std::fprintf(stderr, "heap diff: %-12s %-24s %+10lld %+12lld\n", lox::name(change.kind), change.name.empty() ? "-" : change.name.c_str(),
+                 static_cast<long long>(change.count), static_cast<long long>(change.bytes));
+  }
+  if (changes.size() > shown)
+    std::fprintf(stderr, "heap diff: %zu more entries changed\n", changes.size() - shown);
+}
+
+// The lines whose statements ran most often, with their text. A line counts as often as the statement on it that ran
+// most, so a loop on one line counts its iterations once and not once per statement of the loop.
+void printHotspots(const std::string &source, const std::vector<lox::Stmt> &statements, const std::vector<std::uint64_t> &counts) {
+  const std::vector<std::size_t> lines = lox::StatementLines{statements}.lines();
+
+  std::map<std::size_t, std::uint64_t> executions;
+  for (std::size_t id = 1; id < std::min(counts.size(), lines.size()); id++) {
+    if (counts[id] != 0)
+      executions[lines[id]] = std::max(executions[lines[id]], counts[id]);
+  }
+
+  std::vector<std::pair<std::size_t, std::uint64_t>> hottest(executions.begin(), executions.end());
+  std::stable_sort(hottest.begin(), hottest.end(), [](const auto &left, const auto &right) { return left.second > right.second; });
+  hottest.resize(std::min(hottest.size(), hotspots));
+
+  std::vector<std::string_view> text;
+  for (std::size_t start = 0; start <= source.size();) {
+    const std::size_t end = std::min(source.find('\n', start), source.size());
+    text.emplace_back(source.data() + start, end - start);
+    start = end + 1;
+  }
+
+  std::fprintf(stderr, "hotspots: %12s %6s\n", "executions", "line");
+  for (const auto &[line, count] : hottest) {
+    const std::string_view code = line >= 1 && line <= text.size() ? text[line - 1] : std::string_view{};
+    const std::size_t indent = std::min(code.find_first_not_of(" \t"), code.size());
+    std::fprintf(stderr, "hotspots: %12llu %6zu | %.*s\n", static_cast<unsigned long long>(count), line,
+                 static_cast<int>(code.size() - indent), code.data() + indent);
+  }
+}
 
 void run(const std::string &source) {
+  Statistics report;
+
+  std::ofstream traceFile;
+  std::unique_ptr<lox::Tracer> tracer;
+  if (trace) {
+    traceFile.open(*trace);
+    tracer = std::make_unique<lox::Tracer>(traceFile, traceThreshold);
+    tracer->nameThread("main");
+  }
+  std::optional<lox::Tracer::Span> span; // of the phase running
+
+  report.phases.start("scan");
+  span.emplace(tracer.get(), "Scanner");
   lox::Scanner scanner{source};
   std::vector<lox::Token> tokens = scanner.scan();
 
+  report.phases.start("parse");
+  span.emplace(tracer.get(), "Parser");
   lox::Parser parser{tokens};
   std::vector<lox::Stmt> statements = parser.parse();
 
+  // The passes only run on a tree the resolver accepts, as they drop branches that could hold an error it would report;
+  // otherwise the tree runs as written, in the resolution that found the errors.
+  std::optional<lox::Resolution> unoptimized;
+  if (optimize) {
+    report.phases.start("optimize");
+    span.emplace(tracer.get(), "Optimizer");
+    const std::size_t errors = lox::reportedErrors();
+    lox::Resolution resolution;
+    lox::Resolver resolver{resolution};
+    resolver.resolve(statements);
+
+    if (lox::reportedErrors() != errors) {
+      unoptimized = std::move(resolution);
+    } else {
+      lox::PassManager passManager;
+      passManager.run(statements);
+
+      if (optimizerStatistics)
+        passManager.printStatistics(std::cerr);
+    }
+  }
+
+  report.phases.stop();
+  span.reset();
+
   if (prettyprint) {
     lox::ASTPrinter astprinter{statements};
     astprinter.print(std::cout);
   } else {
+    report.phases.start("resolve");
+    span.emplace(tracer.get(), "Resolver");
     lox::Interpreter interpreter{statements};
-    lox::Resolver resolver{interpreter};
-    resolver.resolve(statements);
+    if (unoptimized) {
+      interpreter.resolution() = std::move(*unoptimized);
+    } else {
+      lox::Resolver resolver{interpreter};
+      resolver.resolve(statements);
+    }
+    report.phases.stop();
+    span.reset();
+    interpreter.setAdaptive(adaptive);
+    interpreter.setJit(jit);
+    interpreter.setExplicitStack(explicitStack, maxDepth);
+    if (timeout)
+      budget.deadline = std::chrono::steady_clock::now() + *timeout;
+    interpreter.setBudget(budget);
+    lox::Concurrency concurrency{interpreter};
+
+    std::optional<lox::Profiler> profiler;
+    if (profile) {
+      profiler.emplace();
+      interpreter.setCallStack(&profiler->callStack());
+      profiler->start();
+    }
+
+    if (stats != StatsFormat::None)
+      interpreter.setCounters(&report.counters);
+
+    interpreter.setTracer(tracer.get());
+
+    report.phases.start("interpret");
     interpreter.interpret();
+    report.phases.stop();
+
+    if (profiler) {
+      profiler->stop();
+      std::ofstream out{*profile};
+      profiler->writeFolded(out, statements);
+      std::cerr << "profile: " << profiler->samples() << " samples (" << profiler->dropped() << " dropped) written to " << *profile
+                << "\n";
+    }
+
+    if (adaptive) {
+      const auto &quickening = interpreter.quickeningStatistics();
+      std::cerr << "quickening: " << quickening.specialized << " specialized, " << quickening.deoptimized << " deoptimized, "
+                << quickening.generic << " generic sites\n";
+    }
+
+    if (jit) {
+      if (const lox::Jit *compiler = interpreter.jit(); compiler != nullptr) {
+        const auto &statistics = compiler->statistics();
+        std::cerr << "jit: " << statistics.compiled << " compiled, " << statistics.rejected << " rejected, " << statistics.guardFailures
+                  << " guard failures, " << statistics.bailouts << " bailouts, " << statistics.codeSize << " bytes of code, "
+                  << std::chrono::duration<double, std::micro>(statistics.compileTime).count() << " us compiling\n";
+      } else {
+        std::cerr << "jit: not supported on this platform\n";
+      }
+    }
+
+    if (const lox::Machine *machine = interpreter.machine()) {
+      const auto &statistics = machine->statistics();
+      std::cerr << "explicit stack: peak " << statistics.peakFrames << " frames, " << statistics.peakTasks << " tasks, "
+                << statistics.peakValues << " values, " << statistics.bytesPerFrame() << " bytes per frame\n";
+    }
+
+    if (hotspots != 0) {
+      if constexpr (lox::Interpreter::countsStatements)
+        printHotspots(source, statements, interpreter.statementCounts());
+      else
+        std::cerr << "hotspots: not compiled in, configure with -DWITH_HOTSPOTS=ON\n";
+    }
+
+    if (heapSnapshot || heapDiff) {
+      const lox::HeapSnapshot snapshot = interpreter.heapSnapshot();
+      if (heapDiff) {
+        std::ifstream in{*heapDiff};
+        try {
+          printHeapDiff(snapshot.since(lox::HeapSnapshot::read(in)));
+        } catch (const std::runtime_error &e) {
+          std::cerr << "heap diff: " << *heapDiff << ": " << e.what() << "\n";
+        }
+      }
+      if (heapSnapshot) {
+        std::ofstream out{*heapSnapshot};
+        snapshot.write(out);
+        const lox::HeapSnapshot::Entry total = snapshot.total();
+        std::cerr << "heap snapshot: " << total.count << " objects, " << total.bytes << " bytes written to " << *heapSnapshot << "\n";
+      }
+    }
+
+    report.resolvedLocals = interpreter.resolution().locals.size();
+  }
+
+  // Only once the threads the program spawned are done.
+  if (tracer) {
+    const std::size_t events = tracer->finish();
+    std::cerr << "trace: " << events << " events written to " << *trace << "\n";
+  }
+
+  if (stats != StatsFormat::None) {
+    report.tokens = tokens.size();
+    lox::NodeCounter counter;
+    counter.count(statements);
+    report.nodes = counter.nodes();
+    std::cerr.flush();
+    printStatistics(report);
+  }
+
+  if (memoryStatistics) {
+    std::cerr.flush();
+    printMemoryStatistics(lox::memory::statistics());
   }
 }
 
@@ -43,6 +402,22 @@ void runFile(const std::string &sourceFile) {
   run(source);
 }
 
+int runBatch(const std::string &scripts, const std::size_t threads) {
+  const lox::Batch batch{lox::Batch::collect(scripts), lox::Batch::Options{threads, optimize}};
+  const lox::Batch::Statistics statistics = batch.run(stdout, stderr);
+
+  const auto milliseconds = [](const std::chrono::nanoseconds duration) {
+    return std::chrono::duration<double, std::milli>(duration).count();
+  };
+
+  std::fprintf(stderr, "batch: %zu scripts (%zu failed) in %.1f ms, %.1f scripts/s on %zu threads, %zu steals\n", statistics.scripts,
+               statistics.failed, milliseconds(statistics.wall), statistics.scriptsPerSecond(), statistics.threads, statistics.steals);
+  std::fprintf(stderr, "batch phases, summed over scripts: load %.1f ms, compile %.1f ms, run %.1f ms\n", milliseconds(statistics.load),
+               milliseconds(statistics.compile), milliseconds(statistics.run));
+
+  return statistics.failed == 0 ? 0 : 1;
+}
+
 void runREPL() {
   const std::string prompt = ">>> ";
   const std::vector<std::string> exit_words{"exit", "quit", "wq"};
@@ -70,7 +445,26 @@ int main(int argc, const char *const argv[]) {
   else {
     const std::string menu = R"(usage: lox-cli [option] [file]
 Options:
--p     : pretty print and exit
+-p          : pretty print and exit
+-O          : optimize the program before running (inlining, constant folding, dead code elimination)
+--opt-stats : like -O, and print what each optimization pass did to stderr
+--adaptive  : specialize operators on the operand types they see, report the sites to stderr
+--jit       : compile hot numeric functions to machine code (x86-64 Linux), report what was compiled to stderr
+--explicit-stack : keep Lox calls on a heap allocated stack, report its peak size to stderr
+--max-depth=N    : with --explicit-stack, fail with a stack overflow error past N nested calls (default 100000)
+--batch <dir|list> : run every *.lox file under dir, or every file listed in list, concurrently; report timings to stderr
+--threads=N        : with --batch, run on N threads (default: one per hardware thread)
+--max-steps=N      : fail with a runtime error after N loop iterations and calls
+--timeout=MS       : fail with a runtime error once the program has run for MS milliseconds
+--profile=FILE     : sample the Lox call stack while the program runs, write folded stacks (flamegraph.pl) to FILE
+--trace=FILE       : write Chrome trace events (Perfetto, chrome://tracing) of the phases, calls and allocations to FILE
+--trace-threshold=US : with --trace, leave out calls shorter than US microseconds (default 100)
+--hotspots[=N]     : report the N (default 10) source lines run most often to stderr; needs a build with WITH_HOTSPOTS
+--stats            : report time, allocations and peak heap per phase, AST size and runtime counters on stderr
+--stats=json       : the same report as JSON
+--mem-stats        : report live bytes, peak bytes and allocations per subsystem (scanner, parser, ...) on stderr
+--heap-snapshot=FILE : write the count and bytes of the objects alive at the end of the run, per class, to FILE
+--heap-diff=FILE     : report how the objects alive at the end of the run differ from the snapshot in FILE on stderr
 )";
 
     const bool prinMenuAndExit =
@@ -85,6 +479,106 @@ Options:
       prettyprint = true;
     }
 
+    if (std::find(cbegin(arguments), cend(arguments), "-O") != cend(arguments)) {
+      optimize = true;
+    }
+
+    if (std::find(cbegin(arguments), cend(arguments), "--opt-stats") != cend(arguments)) {
+      optimize = true;
+      optimizerStatistics = true;
+    }
+
+    if (std::find(cbegin(arguments), cend(arguments), "--adaptive") != cend(arguments)) {
+      adaptive = true;
+    }
+
+    if (std::find(cbegin(arguments), cend(arguments), "--jit") != cend(arguments)) {
+      jit = true;
+    }
+
+    if (std::find(cbegin(arguments), cend(arguments), "--explicit-stack") != cend(arguments)) {
+      explicitStack = true;
+    }
+
+    if (std::find(cbegin(arguments), cend(arguments), "--stats") != cend(arguments)) {
+      stats = StatsFormat::Text;
+    }
+
+    if (std::find(cbegin(arguments), cend(arguments), "--stats=json") != cend(arguments)) {
+      stats = StatsFormat::Json;
+    }
+
+    if (std::find(cbegin(arguments), cend(arguments), "--mem-stats") != cend(arguments)) {
+      memoryStatistics = true;
+    }
+
+    if (std::find(cbegin(arguments), cend(arguments), "--hotspots") != cend(arguments)) {
+      hotspots = 10;
+    }
+
+    const std::string_view depthOption = "--max-depth=";
+    const std::string_view threadsOption = "--threads=";
+    const std::string_view stepsOption = "--max-steps=";
+    const std::string_view timeoutOption = "--timeout=";
+    const std::string_view profileOption = "--profile=";
+    const std::string_view traceOption = "--trace=";
+    const std::string_view hotspotsOption = "--hotspots=";
+    const std::string_view traceThresholdOption = "--trace-threshold=";
+    const std::string_view heapSnapshotOption = "--heap-snapshot=";
+    const std::string_view heapDiffOption = "--heap-diff=";
+    std::size_t threads = 0;
+    std::optional<std::string> malformed; // the last numeric option whose value doesn't parse
+    // The number after the option, 0 if it is malformed, which is noted.
+    const auto count = [&malformed](const std::string &argument, const std::string_view option) {
+      const std::optional<std::int64_t> value = parseCount<std::int64_t>(std::string_view{argument}.substr(option.size()));
+      if (!value)
+        malformed = argument;
+      return value.value_or(0);
+    };
+    // Durations are added to the time of the clock, in nanoseconds, which a longer one would overflow.
+    constexpr auto longest = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::duration::max()) / 2;
+    for (const std::string &argument : arguments) {
+      if (argument.starts_with(depthOption))
+        maxDepth = static_cast<std::size_t>(count(argument, depthOption));
+      if (argument.starts_with(threadsOption))
+        threads = static_cast<std::size_t>(count(argument, threadsOption));
+      if (argument.starts_with(stepsOption))
+        budget.steps = static_cast<std::uint64_t>(count(argument, stepsOption));
+      if (argument.starts_with(timeoutOption)) {
+        timeout = std::chrono::milliseconds(count(argument, timeoutOption));
+        if (*timeout > longest)
+          malformed = argument;
+      }
+      if (argument.starts_with(profileOption))
+        profile = argument.substr(profileOption.size());
+      if (argument.starts_with(hotspotsOption))
+        hotspots = static_cast<std::size_t>(count(argument, hotspotsOption));
+      if (argument.starts_with(traceOption))
+        trace = argument.substr(traceOption.size());
+      if (argument.starts_with(traceThresholdOption)) {
+        traceThreshold = std::chrono::microseconds(count(argument, traceThresholdOption));
+        if (traceThreshold > longest)
+          malformed = argument;
+      }
+      if (argument.starts_with(heapSnapshotOption))
+        heapSnapshot = argument.substr(heapSnapshotOption.size());
+      if (argument.starts_with(heapDiffOption))
+        heapDiff = argument.substr(heapDiffOption.size());
+    }
+
+    if (malformed) {
+      std::cerr << "Malformed option " << *malformed << "\n" << menu;
+      return 1;
+    }
+
+    if (const auto batch = std::find(cbegin(arguments), cend(arguments), "--batch"); batch != cend(arguments)) {
+      if (std::next(batch) == cend(arguments)) {
+        std::cerr << menu;
+        return 1;
+      }
+      return runBatch(*std::next(batch), threads);
+    }
+
     runFile(arguments.back());
   }
 
@@ -0,0 +1,131 @@
+#include <catch2/catch.hpp>
+
+#include <boost/variant/get.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <thread>
+#include <vector>
+
+#include "lox/memory/arena.h"
+#include "lox/memory/memory.h"
+#include "lox/program/program.h"
+#include "lox/script/script.h"
+
+TEST_CASE("Memory", "Account allocations per subsystem") {
+  using namespace lox;
+
+  SECTION("A tagged resource charges its tag") {
+    const memory::Usage before = memory::statistics().tags[static_cast<std::size_t>(memory::Tag::Objects)];
+    {
+      std::pmr::vector<int> numbers{memory::resource(memory::Tag::Objects)};
+      numbers.resize(1000);
+
+      const memory::Usage during = memory::statistics().tags[static_cast<std::size_t>(memory::Tag::Objects)];
+      REQUIRE(during.allocations == before.allocations + 1);
+      REQUIRE(during.liveBytes == before.liveBytes + 1000 * static_cast<std::int64_t>(sizeof(int)));
+      REQUIRE(during.peakBytes >= during.liveBytes);
+    }
+    REQUIRE(memory::statistics().tags[static_cast<std::size_t>(memory::Tag::Objects)].liveBytes == before.liveBytes);
+  }
+
+  SECTION("Running a program charges environments and objects") {
+    const memory::Statistics before = memory::statistics();
+    Script script{Program::compile(R"(
+      class Point { init(x, y) { this.x = x; this.y = y; } }
+      fun make(n) { var p = Point(n, n); return p.x + p.y; }
+    )")};
+    script.function("make")(3);
+
+    const memory::Statistics after = memory::statistics();
+    for (const memory::Tag tag : {memory::Tag::Environments, memory::Tag::Objects})
+      REQUIRE(after.tags[static_cast<std::size_t>(tag)].allocations > before.tags[static_cast<std::size_t>(tag)].allocations);
+  }
+
+  SECTION("With the hook linked, a scope charges what its thread allocates") {
+    REQUIRE(memory::statistics().hooked);
+
+    const memory::Usage before = memory::statistics().tags[static_cast<std::size_t>(memory::Tag::Parser)];
+    {
+      const memory::Scope scope{memory::Tag::Parser};
+      auto block = std::make_unique<char[]>(4096);
+      REQUIRE(memory::statistics().tags[static_cast<std::size_t>(memory::Tag::Parser)].liveBytes >= before.liveBytes + 4096);
+
+      // Freed on another thread, it's still credited to the tag it was charged to.
+      std::thread{[block = std::move(block)] {}}.join();
+    }
+    REQUIRE(memory::statistics().tags[static_cast<std::size_t>(memory::Tag::Parser)].liveBytes == before.liveBytes);
+    REQUIRE(memory::currentTag() == memory::Tag::Other);
+  }
+
+  SECTION("The peak is that of the process when one thread frees what another allocates") {
+    constexpr std::size_t size = 256 * 1024;
+    memory::resetPeaks();
+    const memory::Usage before = memory::statistics().tags[static_cast<std::size_t>(memory::Tag::Parser)];
+
+    for (int i = 0; i < 10; i++) {
+      std::unique_ptr<char[]> block;
+      std::thread{[&block] {
+        const memory::Scope scope{memory::Tag::Parser};
+        block = std::make_unique<char[]>(size);
+      }}.join();
+      std::thread{[block = std::move(block)] {}}.join();
+    }
+
+    const memory::Usage after = memory::statistics().tags[static_cast<std::size_t>(memory::Tag::Parser)];
+    REQUIRE(after.liveBytes == before.liveBytes);
+    REQUIRE(after.peakBytes >= before.liveBytes + static_cast<std::int64_t>(size) - memory::slack);
+    REQUIRE(after.peakBytes < before.liveBytes + static_cast<std::int64_t>(2 * size));
+  }
+}
+
+TEST_CASE("FrameArena", "Keep the environments no closure can keep on an arena") {
+  using namespace lox;
+
+  SECTION("Leaving a frame makes its memory the next one's") {
+    memory::FrameArena arena;
+    void *first = nullptr;
+    {
+      const memory::FrameArena::Frame frame{arena};
+      first = arena.allocate(64);
+      REQUIRE(arena.allocate(64) != first);
+    }
+    const memory::FrameArena::Frame frame{arena};
+    REQUIRE(arena.allocate(64) == first);
+    REQUIRE(arena.reserved() == memory::FrameArena::chunkSize);
+  }
+
+  SECTION("What doesn't fit in a chunk takes one of its own, and is aligned") {
+    memory::FrameArena arena;
+    const memory::FrameArena::Frame frame{arena};
+    void *odd = arena.allocate(100, 1);
+    void *aligned = arena.allocate(32, 32);
+    REQUIRE(aligned != odd);
+    REQUIRE(reinterpret_cast<std::uintptr_t>(aligned) % 32 == 0);
+
+    void *large = arena.allocate(2 * memory::FrameArena::chunkSize);
+    REQUIRE(large != nullptr);
+    REQUIRE(arena.reserved() > 2 * memory::FrameArena::chunkSize);
+  }
+
+  SECTION("Only the blocks and calls around a closure are captured") {
+    const auto program = Program::compile(R"(
+      fun plain(n) { { var twice = n * 2; print twice; } return n; }
+      fun outer() { { var y = 1; { fun inner() { return y; } return inner; } } }
+    )");
+    const auto &plain = boost::get<FunctionStmt>(program->statements()[0]);
+    const auto &outer = boost::get<FunctionStmt>(program->statements()[1]);
+    const auto &block = boost::get<BlockStmt>(outer.body[0]);
+    const Resolution &resolution = program->resolution();
+
+    REQUIRE(resolution.isScoped(plain.id));
+    REQUIRE(resolution.isScoped(boost::get<BlockStmt>(plain.body[0]).id));
+    REQUIRE_FALSE(resolution.isScoped(outer.id));
+    REQUIRE_FALSE(resolution.isScoped(block.id));
+    REQUIRE_FALSE(resolution.isScoped(boost::get<BlockStmt>(block.statements[1]).id));
+    REQUIRE(resolution.isScoped(boost::get<FunctionStmt>(boost::get<BlockStmt>(block.statements[1]).statements[0]).id));
+    REQUIRE_FALSE(resolution.isScoped(0));
+  }
+}
@@ -0,0 +1,271 @@
+#include <catch2/catch.hpp>
+
+#include <boost/property_tree/json_parser.hpp>
+#include <boost/property_tree/ptree.hpp>
+#include <boost/variant/get.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "lox/ast/statementlines.h"
+#include "lox/callable/class/instance.h"
+#include "lox/interpreter/heapsnapshot.h"
+#include "lox/profiler/profiler.h"
+#include "lox/profiler/tracer.h"
+#include "lox/program/program.h"
+#include "lox/script/script.h"
+
+TEST_CASE("Profiler", "Sample the Lox call stack") {
+  using namespace lox;
+
+  const auto program = Program::compile(R"(
+    class Counter {
+      add(n) { var sum = 0; for (var i = 0; i < n; i = i + 1) sum = sum + i; return sum; }
+    }
+    fun spin(n) { var sum = Counter().add(n); return sum; }
+    fun fail() { return -"a"; }
+  )");
+
+  SECTION("Folded stacks name functions and methods with their lines") {
+    Script script{program};
+    Profiler profiler{2000};
+    script.interpreter().setCallStack(&profiler.callStack());
+
+    profiler.start();
+    script.function("spin")(200'000);
+    profiler.stop();
+
+    REQUIRE(profiler.samples() > 0);
+    REQUIRE(profiler.callStack().depth() == 0);
+
+    std::ostringstream folded;
+    profiler.writeFolded(folded, program->statements());
+    REQUIRE_THAT(folded.str(), Catch::Contains("<script>;spin:5;Counter.add:3 "));
+  }
+
+  SECTION("A runtime error unwinds the call stack") {
+    Script script{program};
+    Profiler profiler;
+    script.interpreter().setCallStack(&profiler.callStack());
+
+    REQUIRE_THROWS(script.function("fail")());
+    REQUIRE(profiler.callStack().depth() == 0);
+  }
+
+  SECTION("One profiler at a time") {
+    Profiler first;
+    Profiler second;
+    first.start();
+    REQUIRE_THROWS_AS(second.start(), std::logic_error);
+    first.stop();
+    second.start();
+  }
+}
+
+TEST_CASE("Tracer", "Write Chrome trace events") {
+  using namespace lox;
+
+  const std::string source = R"(
+    class Counter {
+      add(n) { var sum = 0; for (var i = 0; i < n; i = i + 1) sum = sum + i; return sum; }
+    }
+    fun spin(n) { var sum = Counter().add(n); return sum; }
+  )";
+
+  const auto events = [](const std::string &json) {
+    boost::property_tree::ptree trace;
+    std::istringstream in{json};
+    boost::property_tree::read_json(in, trace);
+    return trace.get_child("traceEvents");
+  };
+
+  SECTION("Phases, calls and allocations") {
+    std::ostringstream out;
+    Tracer tracer{out, std::chrono::nanoseconds(0)};
+    {
+      Script script{Program::compile(source, Program::Options{.tracer = &tracer})};
+      script.interpreter().setTracer(&tracer);
+      script.function("spin")(100);
+    }
+    const std::size_t written = tracer.finish();
+
+    std::multiset<std::string> names;
+    for (const auto &[key, event] : events(out.str()))
+      names.insert(event.get<std::string>("name"));
+
+    REQUIRE(written > 0);
+    REQUIRE(names.count("Scanner") == 1);
+    REQUIRE(names.count("Parser") == 1);
+    REQUIRE(names.count("Resolver") == 1);
+    REQUIRE(names.count("spin") == 1);
+    REQUIRE(names.count("add") == 1);
+    REQUIRE_THAT(out.str(), Catch::Contains(R"("instances": 1)"));
+  }
+
+  SECTION("Calls shorter than the threshold are left out") {
+    std::ostringstream out;
+    Tracer tracer{out, std::chrono::hours(1)};
+    Script script{Program::compile(source)};
+    script.interpreter().setTracer(&tracer);
+    script.function("spin")(100);
+    tracer.finish();
+
+    REQUIRE_THAT(out.str(), !Catch::Contains(R"("cat": "call")"));
+  }
+
+  SECTION("Every thread records into a buffer of its own") {
+    constexpr std::size_t threads = 4;
+    constexpr std::size_t spans = Tracer::bufferSize + 10; // one full buffer each and then some
+
+    std::ostringstream out;
+    Tracer tracer{out};
+    std::vector<std::thread> workers;
+    for (std::size_t i = 0; i < threads; i++) {
+      workers.emplace_back([&tracer] {
+        for (std::size_t j = 0; j < spans; j++)
+          const Tracer::Span span{&tracer, "work"};
+      });
+    }
+    for (std::thread &worker : workers)
+      worker.join();
+
+    REQUIRE(tracer.finish() == threads * spans);
+
+    std::set<int> tids;
+    for (const auto &[key, event] : events(out.str())) {
+      if (event.get<std::string>("name") == "work")
+        tids.insert(event.get<int>("tid"));
+    }
+    REQUIRE(tids.size() == threads);
+  }
+}
+
+TEST_CASE("Hotspots", "Count the statements executed") {
+  using namespace lox;
+
+  const auto program = Program::compile(R"(var total = 0;
+fun add(n) {
+  for (var i = 0; i < n; i = i + 1)
+    total = total + i;
+  return total;
+})");
+
+  SECTION("Statements are numbered densely from 1") {
+    const std::vector<std::size_t> lines = StatementLines{program->statements()}.lines();
+
+    REQUIRE(statementId(program->statements()[0]) == 1);
+    REQUIRE(lines[1] == 1);
+    REQUIRE(lines[statementId(program->statements()[1])] == 2);
+    REQUIRE(std::count(lines.begin() + 1, lines.end(), 0) == 0);
+    REQUIRE(std::count(lines.begin(), lines.end(), 4) == 1);
+  }
+
+  SECTION("Every execution counts, if counting is compiled in") {
+    Script script{program};
+    script.function("add")(10);
+
+    const std::vector<std::uint64_t> &counts = script.interpreter().statementCounts();
+    if constexpr (!Interpreter::countsStatements) {
+      REQUIRE(counts.empty());
+      return;
+    }
+
+    const auto &add = boost::get<FunctionStmt>(program->statements()[1]);
+    const auto &loop = boost::get<BlockStmt>(add.body[0]);
+    const auto &body = boost::get<WhileStmt>(loop.statements[1]);
+    REQUIRE(counts.at(add.id) == 1);
+    REQUIRE(counts.at(loop.id) == 1);
+    REQUIRE(counts.at(body.id) == 1);
+    REQUIRE(counts.at(statementId(body.body)) == 10);
+  }
+}
+
+TEST_CASE("HeapSnapshot", "Count the live objects per class") {
+  using namespace lox;
+
+  Script script{Program::compile(R"(
+    class Point { init(x, y) { this.x = x; this.y = y; this.label = "a point, with a label too long to be short"; } }
+    class Pair { init(first, second) { this.first = first; this.second = second; } }
+    var points = nil;
+    fun grow(n) { for (var i = 0; i < n; i = i + 1) points = Pair(Point(i, i), points); }
+    fun cycle() { var pair = Pair(nil, nil); pair.first = pair; }
+    fun drop() { points = nil; }
+  )")};
+
+  SECTION("Instances count by class, and everything they hold by kind") {
+    script.function("grow")(5);
+    const HeapSnapshot snapshot = script.interpreter().heapSnapshot();
+
+    REQUIRE(snapshot.entry(HeapSnapshot::Kind::Instance, "Point").count == 5);
+    REQUIRE(snapshot.entry(HeapSnapshot::Kind::Instance, "Pair").count == 5);
+    REQUIRE(snapshot.entry(HeapSnapshot::Kind::Instance, "Point").bytes > 5 * sizeof(Instance));
+    REQUIRE(snapshot.entry(HeapSnapshot::Kind::Class, "Point").count == 1);
+    REQUIRE(snapshot.entry(HeapSnapshot::Kind::Function, "grow").count == 1);
+    REQUIRE(snapshot.entry(HeapSnapshot::Kind::String).count == 5);
+    REQUIRE(snapshot.entry(HeapSnapshot::Kind::String).bytes > 5 * 40);
+    REQUIRE(snapshot.total(HeapSnapshot::Kind::Environment).count >= 1);
+  }
+
+  SECTION("Instances nothing reaches still count") {
+    script.function("cycle")();
+    REQUIRE(script.interpreter().heapSnapshot().entry(HeapSnapshot::Kind::Instance, "Pair").count == 1);
+  }
+
+  SECTION("Two snapshots tell what grew") {
+    script.function("grow")(2);
+    std::stringstream before;
+    script.interpreter().heapSnapshot().write(before);
+
+    script.function("grow")(3);
+    const HeapSnapshot after = script.interpreter().heapSnapshot();
+    const std::vector<HeapSnapshot::Change> changes = after.since(HeapSnapshot::read(before));
+
+    REQUIRE(changes.front().bytes >= changes.back().bytes);
+    const auto points = std::find_if(changes.begin(), changes.end(), [](const HeapSnapshot::Change &change) {
+      return change.kind == HeapSnapshot::Kind::Instance && change.name == "Point";
+    });
+    REQUIRE(points != changes.end());
+    REQUIRE(points->count == 3);
+
+    script.function("drop")();
+    REQUIRE(script.interpreter().heapSnapshot().since(after).front().count <= 0);
+  }
+
+  SECTION("The environments of callers and of suspended coroutines are roots too") {
+    Script nested{Program::compile(R"(
+      fun inner() { return heapStats().strings; }
+      fun outer() {
+        var first = "a string only the caller holds";
+        var second = "another string only the caller holds";
+        var strings = inner(); // not a tail call, which would leave this call first
+        return strings;
+      }
+      fun holder() { var held = "a string only a suspended coroutine holds"; yield; }
+      fun park() { var coroutine = holder(); resume(coroutine); schedule(coroutine); }
+    )")};
+
+    REQUIRE(nested.function("outer")() == Literal{2.0});
+
+    nested.function("park")();
+    REQUIRE(nested.interpreter().heapSnapshot().entry(HeapSnapshot::Kind::String).count == 1);
+  }
+
+  SECTION("A snapshot reads back as it was written") {
+    script.function("grow")(4);
+    const HeapSnapshot snapshot = script.interpreter().heapSnapshot();
+    std::stringstream text;
+    snapshot.write(text);
+
+    REQUIRE(HeapSnapshot::read(text).entries() == snapshot.entries());
+
+    std::stringstream garbage{"not a snapshot\n"};
+    REQUIRE_THROWS_AS(HeapSnapshot::read(garbage), std::runtime_error);
+  }
+}
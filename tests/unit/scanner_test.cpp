@@ -243,6 +243,31 @@ TEST_CASE("Scanner", "Test individual elements") {
     REQUIRE(tokens[1].kind == TokenKind::EndOfFile);
   }
 
+  SECTION("Number forms") {
+    const std::string input = "123 0.5 007 18446744073709551616 12.";
+
+    Scanner scanner(input);
+    const std::vector tokens = scanner.scan();
+
+    REQUIRE(tokens.size() == 7);
+
+    REQUIRE(std::get<double>(tokens[0].literal.data()) == 123.0);
+    REQUIRE(tokens[0].lexeme == "123");
+
+    REQUIRE(std::get<double>(tokens[1].literal.data()) == 0.5);
+    REQUIRE(tokens[1].lexeme == "0.5");
+
+    REQUIRE(std::get<double>(tokens[2].literal.data()) == 7.0);
+
+    REQUIRE(std::get<double>(tokens[3].literal.data()) == 18446744073709551616.0);
+
+    REQUIRE(std::get<double>(tokens[4].literal.data()) == 12.0);
+    REQUIRE(tokens[4].lexeme == "12");
+    REQUIRE(tokens[5].kind == TokenKind::Dot);
+
+    REQUIRE(tokens[6].kind == TokenKind::EndOfFile);
+  }
+
   SECTION("for loop") {
     const std::string input = "for (var i = 0; true; i = i+i)";
 
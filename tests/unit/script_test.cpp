@@ -0,0 +1,205 @@
+#include <catch2/catch.hpp>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <variant>
+#include <vector>
+
+#include "lox/error/error.h"
+#include "lox/jit/jit.h"
+#include "lox/memory/memory.h"
+#include "lox/primitives/literal.h"
+#include "lox/program/program.h"
+#include "lox/script/script.h"
+
+TEST_CASE("Script", "Call global functions of a compiled program from C++") {
+  using namespace lox;
+
+  SECTION("Arguments and results") {
+    const auto program = Program::compile(R"(
+      fun add(a, b) { return a + b; }
+      fun greet(name) { return "hello " + name; }
+      fun isAdult(age) { return age >= 18; }
+      fun nothing() {}
+    )");
+
+    Script script{program};
+
+    const Script::Function add = script.function("add");
+    REQUIRE(add.arity() == 2);
+    REQUIRE(add(1, 2.5) == Literal{3.5});
+    REQUIRE(script.function("greet")("lox") == Literal{std::string("hello lox")});
+    REQUIRE(script.function("isAdult")(17) == Literal{false});
+    REQUIRE(script.function("nothing")() == Literal{nullptr});
+  }
+
+  SECTION("Globals persist between calls") {
+    const auto program = Program::compile(R"(
+      var count = 0;
+      fun next() { count = count + 1; return count; }
+    )");
+
+    Script script{program};
+    const Script::Function next = script.function("next");
+
+    next();
+    next();
+    REQUIRE(next() == Literal{3.0});
+  }
+
+  SECTION("One program, independent scripts") {
+    const auto program = Program::compile("var total = 0; fun add(n) { total = total + n; return total; }");
+
+    Script first{program};
+    Script second{program};
+
+    first.function("add")(10);
+    REQUIRE(first.function("add")(1) == Literal{11.0});
+    REQUIRE(second.function("add")(1) == Literal{1.0});
+  }
+
+  SECTION("Isolates on several threads share the program") {
+    const auto program = Program::compile(R"(
+      class Counter {
+        init() { this.count = 0; }
+        add(n) { this.count = this.count + n; return this.count; }
+      }
+      var counter = Counter();
+      fun fib(n) { if (n < 2) return n; return fib(n - 2) + fib(n - 1); }
+      fun step(n) { return counter.add(fib(n)); }
+    )");
+
+    constexpr std::size_t threads = 4;
+    std::vector<Literal> results(threads);
+    std::vector<std::thread> workers;
+
+    for (std::size_t i = 0; i < threads; i++) {
+      workers.emplace_back([&program, &results, i] {
+        Script script{program};
+        const Script::Function step = script.function("step");
+        for (int n = 0; n < 200; n++)
+          results[i] = step(10);
+      });
+    }
+
+    for (std::thread &worker : workers)
+      worker.join();
+
+    for (const Literal &result : results)
+      REQUIRE(result == Literal{200.0 * 55});
+  }
+
+  SECTION("Budgets") {
+    const auto program = Program::compile(R"(
+      fun count(n) { var i = 0; while (i < n) i = i + 1; return i; }
+      fun spin() { while (true) {} }
+    )");
+
+    Script script{program};
+    const Script::Function count = script.function("count");
+
+    Interpreter::Budget budget;
+    budget.steps = 100;
+    script.interpreter().setBudget(budget);
+    REQUIRE(count(50) == Literal{50.0});
+    REQUIRE_THROWS_AS(count(100), LimitError);
+
+    // The host decides what happens after a limit: here it grants a new budget and goes on.
+    budget.steps = 10'000;
+    script.interpreter().setBudget(budget);
+    REQUIRE(count(100) == Literal{100.0});
+
+    budget = {};
+    budget.deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(20);
+    script.interpreter().setBudget(budget);
+    try {
+      script.function("spin")();
+      FAIL("spin() returned");
+    } catch (const LimitError &e) {
+      REQUIRE(e.reason() == LimitError::Reason::Deadline);
+    }
+
+    script.interpreter().setBudget({});
+    std::thread watchdog{[&script] {
+      std::this_thread::sleep_for(std::chrono::milliseconds(20));
+      script.interpreter().interrupt();
+    }};
+    try {
+      script.function("spin")();
+      FAIL("spin() returned");
+    } catch (const LimitError &e) {
+      REQUIRE(e.reason() == LimitError::Reason::Interrupt);
+    }
+    watchdog.join();
+  }
+
+  SECTION("Interrupting compiled code") {
+    if (!Jit::isSupported())
+      return;
+
+    const auto program = Program::compile(R"(
+      fun count(n) { var i = 0; while (i < n) i = i + 1; return i; }
+    )");
+
+    Script script{program};
+    script.interpreter().setJit(true);
+    const Script::Function count = script.function("count");
+    for (std::size_t i = 0; i <= Jit::threshold; i++)
+      REQUIRE(count(10) == Literal{10.0});
+    REQUIRE(script.interpreter().jit()->statistics().compiled == 1);
+
+    std::thread watchdog{[&script] {
+      std::this_thread::sleep_for(std::chrono::milliseconds(20));
+      script.interpreter().interrupt();
+    }};
+    try {
+      count(1e12);
+      FAIL("count() returned");
+    } catch (const LimitError &e) {
+      REQUIRE(e.reason() == LimitError::Reason::Interrupt);
+    }
+    watchdog.join();
+
+    // The interrupt is spent, and the function still runs as compiled code.
+    REQUIRE(count(10) == Literal{10.0});
+    REQUIRE(script.interpreter().jit()->statistics().bailouts == 1);
+    REQUIRE(script.interpreter().jit()->statistics().rejected == 0);
+  }
+
+  SECTION("A destroyed script leaves nothing behind") {
+    // A global function closes over the globals that hold it, and the method stored in a field keeps its instance.
+    const auto program = Program::compile(R"(
+      class Node { init() { this.self = this.same; } same(other) { return this == other; } }
+      var node = Node();
+      fun check() { return node.self(node); }
+    )");
+    const auto live = [](const memory::Tag tag) { return memory::statistics().tags[static_cast<std::size_t>(tag)].liveBytes; };
+    const std::int64_t environments = live(memory::Tag::Environments);
+    const std::int64_t objects = live(memory::Tag::Objects);
+
+    for (int i = 0; i < 10; i++) {
+      Script script{program};
+      REQUIRE(script.function("check")() == Literal{true});
+    }
+
+    REQUIRE(live(memory::Tag::Environments) == environments);
+    REQUIRE(live(memory::Tag::Objects) == objects);
+  }
+
+  SECTION("Errors") {
+    REQUIRE_THROWS_AS(Program::compile("fun broken( {"), CompileError);
+    REQUIRE_THROWS_AS(Program::compile("print false and this;", {.optimize = true}), CompileError);
+
+    const auto program = Program::compile("fun fail(x) { return -x; } fun instance() { class A {} return A(); } var x = 1;");
+    Script script{program};
+
+    REQUIRE_THROWS_AS(script.function("missing"), std::invalid_argument);
+    REQUIRE_THROWS_AS(script.function("x"), std::invalid_argument);
+    REQUIRE_THROWS_AS(script.function("fail")(), RuntimeError);
+    REQUIRE_THROWS_AS(script.function("instance")(), RuntimeError);
+  }
+}
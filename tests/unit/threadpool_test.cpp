@@ -0,0 +1,50 @@
+#include <catch2/catch.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+#include "lox/batch/threadpool.h"
+
+TEST_CASE("ThreadPool", "Run tasks on several threads") {
+  using namespace lox;
+
+  SECTION("Every task runs once") {
+    ThreadPool pool{4};
+    REQUIRE(pool.threads() == 4);
+
+    std::vector<std::atomic<int>> runs(1000);
+    for (std::size_t i = 0; i < runs.size(); ++i) {
+      pool.submit([&runs, i] { ++runs[i]; });
+    }
+    pool.wait();
+
+    for (const auto &count : runs) {
+      REQUIRE(count == 1);
+    }
+  }
+
+  SECTION("Waiting again after more work") {
+    ThreadPool pool{2};
+    std::atomic<std::size_t> sum = 0;
+
+    for (std::size_t round = 1; round <= 3; ++round) {
+      for (std::size_t i = 0; i < 100; ++i) {
+        pool.submit([&sum] { ++sum; });
+      }
+      pool.wait();
+      REQUIRE(sum == round * 100);
+    }
+  }
+
+  SECTION("Queued tasks finish before the pool goes away") {
+    std::atomic<std::size_t> done = 0;
+    {
+      ThreadPool pool{3};
+      for (std::size_t i = 0; i < 50; ++i) {
+        pool.submit([&done] { ++done; });
+      }
+    }
+    REQUIRE(done == 50);
+  }
+}